@@ -806,6 +806,7 @@ INT32 BurnByteswap(UINT8* pMem, INT32 nLen)
 
 // Application-defined rom loading function:
 INT32 (__cdecl *BurnExtLoadRom)(UINT8 *Dest, INT32 *pnWrote, INT32 i) = NULL;
+INT32 (__cdecl *BurnExtLoadRomSink)(struct BurnRomSink* pSink, INT32 *pnWrote, INT32 i) = NULL;
 
 // ----------------------------------------------------------------------------
 // Colour-depth independant image transfer
@@ -31,6 +31,7 @@
 
 extern TCHAR szAppHiscorePath[MAX_PATH];
 extern TCHAR szAppSamplesPath[MAX_PATH];
+extern TCHAR szAppCachePath[MAX_PATH];
 
 // Enable the MAME logerror() function in debug builds
 // #define MAME_USE_LOGERROR
@@ -92,6 +93,14 @@ enum BurnCartrigeCommand
 // Application-defined rom loading function
 extern INT32 (__cdecl *BurnExtLoadRom)(UINT8* Dest, INT32* pnWrote, INT32 i);
 
+// Destination of a streamed rom: byte n goes to pDest[n * nGap]
+struct BurnRomSink { UINT8* pDest; INT32 nGap; INT32 nLen; INT32 nPos; };
+void BurnRomSinkWrite(struct BurnRomSink* pSink, const UINT8* pSrc, INT32 nLen);
+
+// Optional application-defined streaming rom loading function, used for roms
+// loaded with a gap so they don't need a temporary copy
+extern INT32 (__cdecl *BurnExtLoadRomSink)(struct BurnRomSink* pSink, INT32* pnWrote, INT32 i);
+
 // Application-defined progress indicator functions
 extern INT32 (__cdecl *BurnExtProgressRangeCallback)(double dProgressRange);
 extern INT32 (__cdecl *BurnExtProgressUpdateCallback)(double dProgress, const TCHAR* pszText, BOOL bAbs);
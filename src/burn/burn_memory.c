@@ -9,12 +9,19 @@
 #define MAX_MEM_PTR	0x400 // more than 1024 malloc calls should be insane...
 
 static UINT8 *memptr[MAX_MEM_PTR]; // pointer to allocated memory
+static INT32 memsize[MAX_MEM_PTR];
+
+// bytes currently allocated, and the most there has been (for the start-up profiler)
+UINT64 nBurnMallocBytes = 0;
+UINT64 nBurnMallocPeak = 0;
 
 // this should be called early on... BurnDrvInit?
 
 void BurnInitMemoryManager(void)
 {
    memset (memptr, 0, MAX_MEM_PTR * sizeof(UINT8 **));	
+   memset (memsize, 0, sizeof(memsize));
+   nBurnMallocBytes = nBurnMallocPeak = 0;
 }
 
 // should we pass the pointer as a variable here so that we can save a pointer to it
@@ -35,6 +42,11 @@ UINT8 *BurnMalloc(INT32 size)
 
          memset (memptr[i], 0, size); // set contents to 0
 
+         memsize[i] = size;
+         nBurnMallocBytes += size;
+         if (nBurnMallocBytes > nBurnMallocPeak)
+            nBurnMallocPeak = nBurnMallocBytes;
+
          return memptr[i];
       }
    }
@@ -53,6 +65,8 @@ void _BurnFree(void *ptr)
 		if (memptr[i] == mptr) {
 			free (memptr[i]);
 			memptr[i] = NULL;
+			nBurnMallocBytes -= memsize[i];
+			memsize[i] = 0;
 
 			break;
 		}
@@ -69,6 +83,9 @@ void BurnExitMemoryManager(void)
 #endif
 			free (memptr[i]);
 			memptr[i] = NULL;
+			memsize[i] = 0;
 		}
 	}
+
+	nBurnMallocBytes = 0;
 }
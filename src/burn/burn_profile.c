@@ -0,0 +1,165 @@
+// Burn - start-up profiler
+
+#include "burnint.h"
+#include "burn_profile.h"
+
+#if defined _WIN32
+ #include <windows.h>
+#elif defined __unix__ || defined __APPLE__ || defined __HAIKU__
+ #include <time.h>
+ #include <sys/time.h>
+ #include <sys/resource.h>
+ #define BURN_PROFILE_POSIX
+#else
+ #include <time.h>
+#endif
+
+bool bBurnProfile = false;
+
+static struct BurnProfilePhase ProfilePhase[BURN_PROFILE_MAX_PHASES];
+static INT32 nProfilePhases = 0;
+
+// Phases that have been started but not stopped. nBurnMallocPeak is restarted
+// from the current allocation at every BurnProfileStart, so at BurnProfileStop
+// it holds the peak within the phase; the enclosing phase's peak is kept here.
+#define BURN_PROFILE_MAX_OPEN	(16)
+
+struct BurnProfileOpen {
+	UINT64 nStart;
+	UINT64 nOuterPeak;
+};
+
+static struct BurnProfileOpen ProfileOpen[BURN_PROFILE_MAX_OPEN];
+static INT32 nProfileOpen = 0;
+
+static UINT64 BurnProfileTime(void)
+{
+#if defined _WIN32
+	LARGE_INTEGER nCount, nFrequency;
+	QueryPerformanceCounter(&nCount);
+	QueryPerformanceFrequency(&nFrequency);
+	return (UINT64)(nCount.QuadPart / nFrequency.QuadPart) * 1000000 + (UINT64)(nCount.QuadPart % nFrequency.QuadPart) * 1000000 / nFrequency.QuadPart;
+#elif defined BURN_PROFILE_POSIX && defined CLOCK_MONOTONIC
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (UINT64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#elif defined BURN_PROFILE_POSIX
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (UINT64)tv.tv_sec * 1000000 + tv.tv_usec;
+#else
+	return (UINT64)clock() * 1000000 / CLOCKS_PER_SEC;
+#endif
+}
+
+static UINT64 BurnProfilePeakRSS(void)
+{
+#if defined BURN_PROFILE_POSIX
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru))
+		return 0;
+ #if defined __APPLE__
+	return (UINT64)ru.ru_maxrss;							// Bytes
+ #else
+	return (UINT64)ru.ru_maxrss * 1024;						// Kilobytes
+ #endif
+#else
+	return 0;
+#endif
+}
+
+void BurnProfileReset(void)
+{
+	memset(ProfilePhase, 0, sizeof(ProfilePhase));
+	nProfilePhases = 0;
+	nProfileOpen = 0;
+}
+
+UINT64 BurnProfileStart(void)
+{
+	if (!bBurnProfile)
+		return 0;
+
+	UINT64 nStart = BurnProfileTime();
+
+	if (nProfileOpen < BURN_PROFILE_MAX_OPEN) {
+		ProfileOpen[nProfileOpen].nStart = nStart;
+		ProfileOpen[nProfileOpen].nOuterPeak = nBurnMallocPeak;
+		nProfileOpen++;
+
+		nBurnMallocPeak = nBurnMallocBytes;
+	}
+
+	return nStart;
+}
+
+// Peak allocation since the phase started at nStart, and hand the peak back to
+// the enclosing phase. Phases started inside it that were never stopped (an
+// error return) are closed along with it.
+static UINT64 BurnProfileClose(UINT64 nStart)
+{
+	UINT64 nPeak = nBurnMallocPeak;
+	INT32 i;
+
+	for (i = nProfileOpen - 1; i >= 0; i--) {
+		if (ProfileOpen[i].nStart == nStart)
+			break;
+	}
+	if (i < 0)
+		return nPeak;
+
+	for (INT32 j = nProfileOpen - 1; j > i; j--) {
+		if (ProfileOpen[j].nOuterPeak > nPeak)
+			nPeak = ProfileOpen[j].nOuterPeak;
+	}
+
+	nBurnMallocPeak = ProfileOpen[i].nOuterPeak > nPeak ? ProfileOpen[i].nOuterPeak : nPeak;
+	nProfileOpen = i;
+
+	return nPeak;
+}
+
+void BurnProfileStop(const char* szName, UINT64 nStart, UINT64 nBytes)
+{
+	struct BurnProfilePhase* pPhase = NULL;
+
+	if (!bBurnProfile || nStart == 0)
+		return;
+
+	UINT64 nTime = BurnProfileTime() - nStart;
+	UINT64 nPeak = BurnProfileClose(nStart);
+
+	for (INT32 i = 0; i < nProfilePhases; i++) {
+		if (strcmp(ProfilePhase[i].szName, szName) == 0) {
+			pPhase = &ProfilePhase[i];
+			break;
+		}
+	}
+	if (pPhase == NULL) {
+		if (nProfilePhases >= BURN_PROFILE_MAX_PHASES)
+			return;
+
+		pPhase = &ProfilePhase[nProfilePhases++];
+		pPhase->szName = szName;
+	}
+
+	pPhase->nCalls++;
+	pPhase->nTime += nTime;
+	pPhase->nBytes += nBytes;
+	if (nPeak > pPhase->nPeakAlloc)
+		pPhase->nPeakAlloc = nPeak;
+	pPhase->nPeakRSS = BurnProfilePeakRSS();
+}
+
+INT32 BurnProfileCount(void)
+{
+	return nProfilePhases;
+}
+
+const struct BurnProfilePhase* BurnProfileGetPhase(INT32 nPhase)
+{
+	if (nPhase < 0 || nPhase >= nProfilePhases)
+		return NULL;
+
+	return &ProfilePhase[nPhase];
+}
@@ -0,0 +1,35 @@
+// Start-up profiler: wall time, bytes processed and memory high-water marks of
+// the phases of loading a game. Phases may nest and may run more than once,
+// repeated runs add up. Only call it from the thread that loads the game.
+
+#include <boolean.h>
+
+#define BURN_PROFILE_MAX_PHASES	(32)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct BurnProfilePhase {
+	const char* szName;
+	INT32 nCalls;
+	UINT64 nTime;											// Microseconds
+	UINT64 nBytes;
+	UINT64 nPeakAlloc;										// Most BurnMalloc bytes while the phase ran
+	UINT64 nPeakRSS;										// Peak resident size after the phase (0 if unknown)
+};
+
+extern bool bBurnProfile;
+
+void BurnProfileReset(void);
+
+// Returns the start time to pass to BurnProfileStop (0 while profiling is off)
+UINT64 BurnProfileStart(void);
+void BurnProfileStop(const char* szName, UINT64 nStart, UINT64 nBytes);
+
+INT32 BurnProfileCount(void);
+const struct BurnProfilePhase* BurnProfileGetPhase(INT32 nPhase);
+
+#ifdef __cplusplus
+}
+#endif
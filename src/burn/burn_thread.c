@@ -0,0 +1,424 @@
+// Burn - small worker pool
+
+#include "burnint.h"
+#include "burn_thread.h"
+#include <boolean.h>
+
+#if defined HAVE_THREADS
+
+#if defined _WIN32
+ #include <windows.h>
+
+ typedef HANDLE				BurnThreadHandle;
+ typedef CRITICAL_SECTION	BurnThreadMutex;
+ typedef CONDITION_VARIABLE	BurnThreadCond;
+
+ #define MUTEX_INIT(m)		InitializeCriticalSection(&m)
+ #define MUTEX_EXIT(m)		DeleteCriticalSection(&m)
+ #define MUTEX_LOCK(m)		EnterCriticalSection(&m)
+ #define MUTEX_UNLOCK(m)	LeaveCriticalSection(&m)
+ #define COND_INIT(c)		InitializeConditionVariable(&c)
+ #define COND_EXIT(c)
+ #define COND_WAIT(c,m)		SleepConditionVariableCS(&c, &m, INFINITE)
+ #define COND_SIGNAL(c)		WakeConditionVariable(&c)
+ #define COND_BROADCAST(c)	WakeAllConditionVariable(&c)
+#else
+ #include <pthread.h>
+
+ typedef pthread_t			BurnThreadHandle;
+ typedef pthread_mutex_t	BurnThreadMutex;
+ typedef pthread_cond_t		BurnThreadCond;
+
+ #define MUTEX_INIT(m)		pthread_mutex_init(&m, NULL)
+ #define MUTEX_EXIT(m)		pthread_mutex_destroy(&m)
+ #define MUTEX_LOCK(m)		pthread_mutex_lock(&m)
+ #define MUTEX_UNLOCK(m)	pthread_mutex_unlock(&m)
+ #define COND_INIT(c)		pthread_cond_init(&c, NULL)
+ #define COND_EXIT(c)		pthread_cond_destroy(&c)
+ #define COND_WAIT(c,m)		pthread_cond_wait(&c, &m)
+ #define COND_SIGNAL(c)		pthread_cond_signal(&c)
+ #define COND_BROADCAST(c)	pthread_cond_broadcast(&c)
+#endif
+
+static BurnThreadHandle ThreadHandle[BURN_THREAD_MAX];
+static BurnThreadMutex ThreadLock;
+static BurnThreadCond ThreadWake, ThreadDone;
+
+static INT32 nThreadWorkers = 0;							// Not counting the calling thread
+static bool bThreadQuit;
+
+// Jobs passed to one BurnThreadRun call, lives on the caller's stack
+struct BurnThreadSet {
+	BurnThreadJob pJob;
+	void* pParam;
+	INT32 nNextJob, nJobs, nJobsDone;
+	struct BurnThreadSet* pNext;
+};
+
+static struct BurnThreadSet* pThreadSets;					// Sets with jobs left to hand out, newest first
+
+// Hand out the next job of pSet, called with ThreadLock held
+static void BurnThreadWork(struct BurnThreadSet* pSet)
+{
+	INT32 nJob = pSet->nNextJob++;
+
+	// Every job is handed out, so take the set off the list
+	if (pSet->nNextJob == pSet->nJobs) {
+		struct BurnThreadSet** ppSet = &pThreadSets;
+		while (*ppSet != pSet)
+			ppSet = &(*ppSet)->pNext;
+		*ppSet = pSet->pNext;
+	}
+
+	MUTEX_UNLOCK(ThreadLock);
+	pSet->pJob(pSet->pParam, nJob);
+	MUTEX_LOCK(ThreadLock);
+
+	if (++pSet->nJobsDone == pSet->nJobs)
+		COND_BROADCAST(ThreadDone);
+}
+
+#if defined _WIN32
+static DWORD WINAPI BurnThreadMain(LPVOID pArg)
+#else
+static void* BurnThreadMain(void* pArg)
+#endif
+{
+	(void)pArg;
+
+	MUTEX_LOCK(ThreadLock);
+	for (;;) {
+		while (!bThreadQuit && pThreadSets == NULL)
+			COND_WAIT(ThreadWake, ThreadLock);
+
+		if (bThreadQuit)
+			break;
+
+		BurnThreadWork(pThreadSets);
+	}
+	MUTEX_UNLOCK(ThreadLock);
+
+	return 0;
+}
+
+INT32 BurnThreadInit(INT32 nThreads)
+{
+	BurnThreadExit();
+
+	if (nThreads > BURN_THREAD_MAX)
+		nThreads = BURN_THREAD_MAX;
+	if (nThreads <= 1)
+		return 0;
+
+	MUTEX_INIT(ThreadLock);
+	COND_INIT(ThreadWake);
+	COND_INIT(ThreadDone);
+
+	bThreadQuit = false;
+	pThreadSets = NULL;
+
+	for (nThreadWorkers = 0; nThreadWorkers < nThreads - 1; nThreadWorkers++) {
+#if defined _WIN32
+		ThreadHandle[nThreadWorkers] = CreateThread(NULL, 0, BurnThreadMain, NULL, 0, NULL);
+		if (ThreadHandle[nThreadWorkers] == NULL)
+			break;
+#else
+		if (pthread_create(&ThreadHandle[nThreadWorkers], NULL, BurnThreadMain, NULL))
+			break;
+#endif
+	}
+
+	if (nThreadWorkers == 0) {
+		COND_EXIT(ThreadDone);
+		COND_EXIT(ThreadWake);
+		MUTEX_EXIT(ThreadLock);
+		return 1;
+	}
+
+	return 0;
+}
+
+void BurnThreadExit(void)
+{
+	if (nThreadWorkers == 0)
+		return;
+
+	MUTEX_LOCK(ThreadLock);
+	bThreadQuit = true;
+	COND_BROADCAST(ThreadWake);
+	MUTEX_UNLOCK(ThreadLock);
+
+	for (INT32 i = 0; i < nThreadWorkers; i++) {
+#if defined _WIN32
+		WaitForSingleObject(ThreadHandle[i], INFINITE);
+		CloseHandle(ThreadHandle[i]);
+#else
+		pthread_join(ThreadHandle[i], NULL);
+#endif
+	}
+	nThreadWorkers = 0;
+
+	COND_EXIT(ThreadDone);
+	COND_EXIT(ThreadWake);
+	MUTEX_EXIT(ThreadLock);
+}
+
+INT32 BurnThreadCount(void)
+{
+	return nThreadWorkers + 1;
+}
+
+void BurnThreadRun(BurnThreadJob pJob, void* pParam, INT32 nJobs)
+{
+	struct BurnThreadSet Set;
+
+	if (nThreadWorkers == 0 || nJobs <= 1) {
+		for (INT32 i = 0; i < nJobs; i++)
+			pJob(pParam, i);
+		return;
+	}
+
+	Set.pJob = pJob;
+	Set.pParam = pParam;
+	Set.nNextJob = Set.nJobsDone = 0;
+	Set.nJobs = nJobs;
+
+	MUTEX_LOCK(ThreadLock);
+
+	// Workers take jobs from the newest set, so a short set submitted while a
+	// long one is running gets the next free workers
+	Set.pNext = pThreadSets;
+	pThreadSets = &Set;
+	COND_BROADCAST(ThreadWake);
+
+	// The caller only takes its own jobs, jobs from other sets may wait on it
+	while (Set.nNextJob < Set.nJobs)
+		BurnThreadWork(&Set);
+	while (Set.nJobsDone < Set.nJobs)
+		COND_WAIT(ThreadDone, ThreadLock);
+	MUTEX_UNLOCK(ThreadLock);
+}
+
+// Background task
+
+static BurnThreadHandle TaskHandle;
+static BurnThreadMutex TaskLock;
+static BurnThreadCond TaskWake, TaskDone;
+
+static bool bTaskRunning = false;						// Thread exists
+static bool bTaskQuit, bTaskBusy;
+
+static BurnTaskFunction pTaskFunction;
+static void* pTaskParam;
+
+#if defined _WIN32
+static DWORD WINAPI BurnTaskMain(LPVOID pArg)
+#else
+static void* BurnTaskMain(void* pArg)
+#endif
+{
+	(void)pArg;
+
+	MUTEX_LOCK(TaskLock);
+	for (;;) {
+		while (!bTaskQuit && pTaskFunction == NULL)
+			COND_WAIT(TaskWake, TaskLock);
+
+		if (bTaskQuit)
+			break;
+
+		MUTEX_UNLOCK(TaskLock);
+		pTaskFunction(pTaskParam);
+		MUTEX_LOCK(TaskLock);
+
+		pTaskFunction = NULL;
+		bTaskBusy = false;
+		COND_SIGNAL(TaskDone);
+	}
+	MUTEX_UNLOCK(TaskLock);
+
+	return 0;
+}
+
+void BurnTaskStart(BurnTaskFunction pTask, void* pParam)
+{
+	if (!bTaskRunning) {
+		MUTEX_INIT(TaskLock);
+		COND_INIT(TaskWake);
+		COND_INIT(TaskDone);
+
+		bTaskQuit = bTaskBusy = false;
+		pTaskFunction = NULL;
+
+#if defined _WIN32
+		TaskHandle = CreateThread(NULL, 0, BurnTaskMain, NULL, 0, NULL);
+		bTaskRunning = TaskHandle != NULL;
+#else
+		bTaskRunning = pthread_create(&TaskHandle, NULL, BurnTaskMain, NULL) == 0;
+#endif
+
+		if (!bTaskRunning) {
+			COND_EXIT(TaskDone);
+			COND_EXIT(TaskWake);
+			MUTEX_EXIT(TaskLock);
+
+			pTask(pParam);
+			return;
+		}
+	}
+
+	MUTEX_LOCK(TaskLock);
+	while (bTaskBusy)
+		COND_WAIT(TaskDone, TaskLock);
+
+	pTaskFunction = pTask;
+	pTaskParam = pParam;
+	bTaskBusy = true;
+	COND_SIGNAL(TaskWake);
+	MUTEX_UNLOCK(TaskLock);
+}
+
+void BurnTaskWait(void)
+{
+	if (!bTaskRunning)
+		return;
+
+	MUTEX_LOCK(TaskLock);
+	while (bTaskBusy)
+		COND_WAIT(TaskDone, TaskLock);
+	MUTEX_UNLOCK(TaskLock);
+}
+
+void BurnTaskExit(void)
+{
+	if (!bTaskRunning)
+		return;
+
+	MUTEX_LOCK(TaskLock);
+	while (bTaskBusy)
+		COND_WAIT(TaskDone, TaskLock);
+	bTaskQuit = true;
+	COND_SIGNAL(TaskWake);
+	MUTEX_UNLOCK(TaskLock);
+
+#if defined _WIN32
+	WaitForSingleObject(TaskHandle, INFINITE);
+	CloseHandle(TaskHandle);
+#else
+	pthread_join(TaskHandle, NULL);
+#endif
+	bTaskRunning = false;
+
+	COND_EXIT(TaskDone);
+	COND_EXIT(TaskWake);
+	MUTEX_EXIT(TaskLock);
+}
+
+// Shared lock and event
+
+static BurnThreadMutex SyncLock;
+static BurnThreadCond SyncEvent;
+static bool bSyncInit = false;
+
+void BurnSyncInit(void)
+{
+	if (bSyncInit)
+		return;
+
+	MUTEX_INIT(SyncLock);
+	COND_INIT(SyncEvent);
+	bSyncInit = true;
+}
+
+void BurnSyncExit(void)
+{
+	if (!bSyncInit)
+		return;
+
+	COND_EXIT(SyncEvent);
+	MUTEX_EXIT(SyncLock);
+	bSyncInit = false;
+}
+
+void BurnSyncLock(void)
+{
+	MUTEX_LOCK(SyncLock);
+}
+
+void BurnSyncUnlock(void)
+{
+	MUTEX_UNLOCK(SyncLock);
+}
+
+void BurnSyncWait(void)
+{
+	COND_WAIT(SyncEvent, SyncLock);
+}
+
+void BurnSyncSignal(void)
+{
+	COND_BROADCAST(SyncEvent);
+}
+
+#else
+
+INT32 BurnThreadInit(INT32 nThreads)
+{
+	(void)nThreads;
+
+	return 0;
+}
+
+void BurnThreadExit(void)
+{
+}
+
+INT32 BurnThreadCount(void)
+{
+	return 1;
+}
+
+void BurnThreadRun(BurnThreadJob pJob, void* pParam, INT32 nJobs)
+{
+	for (INT32 i = 0; i < nJobs; i++)
+		pJob(pParam, i);
+}
+
+void BurnTaskStart(BurnTaskFunction pTask, void* pParam)
+{
+	pTask(pParam);
+}
+
+void BurnTaskWait(void)
+{
+}
+
+void BurnTaskExit(void)
+{
+}
+
+void BurnSyncInit(void)
+{
+}
+
+void BurnSyncExit(void)
+{
+}
+
+void BurnSyncLock(void)
+{
+}
+
+void BurnSyncUnlock(void)
+{
+}
+
+void BurnSyncWait(void)
+{
+}
+
+void BurnSyncSignal(void)
+{
+}
+
+#endif
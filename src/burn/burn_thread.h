@@ -0,0 +1,53 @@
+// Small worker pool used to split rendering work over several cores.
+// Without HAVE_THREADS every job simply runs on the calling thread.
+
+#if defined HAVE_THREADS
+ #if defined _MSC_VER
+  #define BURN_THREAD_LOCAL	__declspec(thread)
+ #else
+  #define BURN_THREAD_LOCAL	__thread
+ #endif
+#else
+ #define BURN_THREAD_LOCAL
+#endif
+
+#define BURN_THREAD_MAX		(8)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Called once for every job number 0 - (nJobs - 1), jobs may run in any order
+typedef void (*BurnThreadJob)(void* pParam, INT32 nJob);
+
+// nThreads includes the calling thread, 1 (or less) disables the pool
+INT32 BurnThreadInit(INT32 nThreads);
+void BurnThreadExit(void);
+
+// Number of threads that take part in BurnThreadRun (at least 1)
+INT32 BurnThreadCount(void);
+
+// Run all jobs and wait for them to complete, the caller takes jobs as well.
+// Several threads can run jobs at the same time, they share the workers.
+void BurnThreadRun(BurnThreadJob pJob, void* pParam, INT32 nJobs);
+
+// A single background task on its own thread, so work can overlap with emulation.
+// BurnTaskStart waits for the previous task first.
+typedef void (*BurnTaskFunction)(void* pParam);
+
+void BurnTaskStart(BurnTaskFunction pTask, void* pParam);
+void BurnTaskWait(void);
+void BurnTaskExit(void);
+
+// One lock and event for handing results between threads (e.g. from jobs
+// running in the background task to the emulation thread)
+void BurnSyncInit(void);
+void BurnSyncExit(void);
+void BurnSyncLock(void);
+void BurnSyncUnlock(void);
+void BurnSyncWait(void);								// Lock must be held
+void BurnSyncSignal(void);								// Wakes all waiting threads
+
+#ifdef __cplusplus
+}
+#endif
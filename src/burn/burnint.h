@@ -135,6 +135,7 @@ UINT8 *BurnMalloc(INT32 size);
 void _BurnFree(void *ptr);
 #define BurnFree(x)		_BurnFree(x); x = NULL;
 void BurnExitMemoryManager();
+extern UINT64 nBurnMallocBytes, nBurnMallocPeak;
 
 // ---------------------------------------------------------------------------
 // Sound clipping macro
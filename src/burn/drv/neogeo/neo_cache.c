@@ -0,0 +1,305 @@
+// Neo Geo -- pre-decoded ROM cache
+//
+// Decrypting and converting the C ROMs of the large sets takes most of the
+// loading time. After a cartridge has been loaded, LoadRoms hands the final
+// ROM images (sprites, fix layer, 68K, Z80 and ADPCM data), the sprite tile
+// opacity table and the ROM sizes as left by the driver's init callback (sbp
+// shrinks its fix layer, for instance) to NeoCacheSave, which writes them to
+// <szAppCachePath><driver>.neocache. The file is keyed by the CRCs and sizes
+// of the ROM set, so a different set, driver or layout makes NeoCacheLoad
+// ignore it and the ROMs are loaded normally again.
+//
+// On a hit the sizes are restored and the file is mapped into memory and the ROM pointers point straight
+// into the mapping. The mapping is private (copy-on-write), so the few places
+// that patch ROM data at runtime still work. Where mapping files is not
+// available, the file is read into a single block instead.
+//
+// Clean pages of the mapping can be dropped again with NeoCacheDiscard, which
+// the sprite code uses to keep large sprite ROMs within a memory budget.
+
+#include "neogeo.h"
+#include <stddef.h>
+
+#if defined _WIN32
+ #include <windows.h>
+ #define NEO_CACHE_WIN32
+#elif defined __unix__ || defined __APPLE__ || defined __HAIKU__
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #define NEO_CACHE_MMAP
+#endif
+
+#define NEO_CACHE_MAGIC			"FBANEOC"
+#define NEO_CACHE_VERSION		(3)
+#define NEO_CACHE_ALIGN			(0x1000)				// Keep every region page aligned
+#define NEO_CACHE_REGIONS		(8)
+#define NEO_CACHE_SIZES			(8)
+
+struct NeoCacheHeader {
+   char szMagic[8];
+   UINT32 nVersion;
+   UINT32 nEndian;										// Catches files written on a different host
+   UINT32 nKey;
+   UINT32 nRegions;
+   char szDriver[32];
+   UINT32 nLen[NEO_CACHE_REGIONS];
+   UINT32 nOffset[NEO_CACHE_REGIONS];
+   UINT32 nSizes;										// Everything from here on isn't part of the key
+   UINT32 nSize[NEO_CACHE_SIZES];
+};
+
+#define NEO_CACHE_KEYLEN		(offsetof(struct NeoCacheHeader, nSizes))
+
+static void* NeoCacheMap[MAX_SLOT];
+static UINT32 nNeoCacheMapSize[MAX_SLOT];
+#if defined NEO_CACHE_WIN32
+static HANDLE NeoCacheMapping[MAX_SLOT];
+#endif
+
+static void NeoCacheName(TCHAR* pszName)
+{
+   _stprintf(pszName, _T("%s%s.neocache"), szAppCachePath, BurnDrvGetText(DRV_NAME));
+}
+
+// FNV-1a over the CRC and length of every ROM in the set, plus the hardware
+// code and the size of each region
+static UINT32 NeoCacheKey(struct NeoCacheRegion* pRegion, INT32 nRegions)
+{
+   struct BurnRomInfo ri;
+   UINT32 nKey = 0x811C9DC5;
+
+#define NEO_CACHE_HASH(v) { UINT32 n = (v); for (INT32 b = 0; b < 32; b += 8) { nKey ^= (n >> b) & 0xFF; nKey *= 0x01000193; } }
+
+   for (INT32 i = 0; i < 0x100 && BurnDrvGetRomInfo(&ri, i) == 0; i++) {
+      NEO_CACHE_HASH(ri.nCrc);
+      NEO_CACHE_HASH(ri.nLen);
+   }
+
+   NEO_CACHE_HASH(BurnDrvGetHardwareCode());
+
+   for (INT32 i = 0; i < nRegions; i++)
+      NEO_CACHE_HASH(pRegion[i].nLen);
+
+#undef NEO_CACHE_HASH
+
+   return nKey;
+}
+
+static void NeoCacheFillHeader(struct NeoCacheHeader* pHeader, struct NeoCacheRegion* pRegion, INT32 nRegions)
+{
+   UINT32 nOffset = (sizeof(struct NeoCacheHeader) + NEO_CACHE_ALIGN - 1) & ~(NEO_CACHE_ALIGN - 1);
+
+   memset(pHeader, 0, sizeof(struct NeoCacheHeader));
+   memcpy(pHeader->szMagic, NEO_CACHE_MAGIC, sizeof(pHeader->szMagic));
+   pHeader->nVersion = NEO_CACHE_VERSION;
+   pHeader->nEndian = 0x01020304;
+   pHeader->nKey = NeoCacheKey(pRegion, nRegions);
+   pHeader->nRegions = nRegions;
+   strncpy(pHeader->szDriver, BurnDrvGetTextA(DRV_NAME), sizeof(pHeader->szDriver) - 1);
+
+   for (INT32 i = 0; i < nRegions; i++) {
+      pHeader->nLen[i] = pRegion[i].nLen;
+      pHeader->nOffset[i] = nOffset;
+      nOffset += (pRegion[i].nLen + NEO_CACHE_ALIGN - 1) & ~(NEO_CACHE_ALIGN - 1);
+   }
+}
+
+static UINT32 NeoCacheFileSize(struct NeoCacheHeader* pHeader)
+{
+   INT32 nLast = pHeader->nRegions - 1;
+
+   return pHeader->nOffset[nLast] + ((pHeader->nLen[nLast] + NEO_CACHE_ALIGN - 1) & ~(NEO_CACHE_ALIGN - 1));
+}
+
+// Map (or read) the whole file, returns NULL if it can't be used
+static UINT8* NeoCacheOpen(const TCHAR* pszName, UINT32 nSize)
+{
+   UINT8* pMap = NULL;
+
+#if defined NEO_CACHE_MMAP
+   struct stat st;
+   INT32 nFile = open(pszName, O_RDONLY);
+   if (nFile < 0)
+      return NULL;
+
+   if (fstat(nFile, &st) == 0 && (UINT32)st.st_size == nSize) {
+      pMap = (UINT8*)mmap(NULL, nSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, nFile, 0);
+      if (pMap == (UINT8*)MAP_FAILED)
+         pMap = NULL;
+   }
+   close(nFile);
+#elif defined NEO_CACHE_WIN32
+   LARGE_INTEGER nFileSize;
+   HANDLE hFile = CreateFile(pszName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   if (hFile == INVALID_HANDLE_VALUE)
+      return NULL;
+
+   if (GetFileSizeEx(hFile, &nFileSize) && nFileSize.QuadPart == nSize) {
+      NeoCacheMapping[nNeoActiveSlot] = CreateFileMapping(hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+      if (NeoCacheMapping[nNeoActiveSlot]) {
+         pMap = (UINT8*)MapViewOfFile(NeoCacheMapping[nNeoActiveSlot], FILE_MAP_COPY, 0, 0, 0);
+         if (pMap == NULL) {
+            CloseHandle(NeoCacheMapping[nNeoActiveSlot]);
+            NeoCacheMapping[nNeoActiveSlot] = NULL;
+         }
+      }
+   }
+   CloseHandle(hFile);
+#else
+   FILE* fp = _tfopen(pszName, _T("rb"));
+   if (fp == NULL)
+      return NULL;
+
+   fseek(fp, 0, SEEK_END);
+   if ((UINT32)ftell(fp) == nSize) {
+      pMap = (UINT8*)malloc(nSize);
+      fseek(fp, 0, SEEK_SET);
+      if (pMap && fread(pMap, 1, nSize, fp) != nSize) {
+         free(pMap);
+         pMap = NULL;
+      }
+   }
+   fclose(fp);
+#endif
+
+   if (pMap) {
+      NeoCacheMap[nNeoActiveSlot] = pMap;
+      nNeoCacheMapSize[nNeoActiveSlot] = nSize;
+   }
+
+   return pMap;
+}
+
+// Point the regions into the cache file and restore the sizes, returns 0 on success
+INT32 NeoCacheLoad(struct NeoCacheRegion* pRegion, INT32 nRegions, UINT32** pSize, INT32 nSizes)
+{
+   struct NeoCacheHeader Header, FileHeader;
+   TCHAR szName[MAX_PATH + 64];
+   UINT8* pMap;
+
+   if (szAppCachePath[0] == 0 || nRegions > NEO_CACHE_REGIONS || nSizes > NEO_CACHE_SIZES)
+      return 1;
+
+   NeoCacheFillHeader(&Header, pRegion, nRegions);
+   NeoCacheName(szName);
+
+   // Check the header before mapping anything
+   {
+      FILE* fp = _tfopen(szName, _T("rb"));
+      if (fp == NULL)
+         return 1;
+
+      INT32 nRead = fread(&FileHeader, sizeof(FileHeader), 1, fp);
+      fclose(fp);
+
+      if (nRead != 1 || memcmp(&Header, &FileHeader, NEO_CACHE_KEYLEN) || FileHeader.nSizes != (UINT32)nSizes)
+         return 1;
+   }
+
+   pMap = NeoCacheOpen(szName, NeoCacheFileSize(&Header));
+   if (pMap == NULL)
+      return 1;
+
+   for (INT32 i = 0; i < nRegions; i++) {
+      if (pRegion[i].nLen)
+         *pRegion[i].ppData = pMap + Header.nOffset[i];
+   }
+   for (INT32 i = 0; i < nSizes; i++)
+      *pSize[i] = FileHeader.nSize[i];
+
+   bprintf(PRINT_NORMAL, _T("  - Using pre-decoded ROM cache.\n"));
+
+   return 0;
+}
+
+// Write the loaded regions and the current sizes to the cache file
+void NeoCacheSave(struct NeoCacheRegion* pRegion, INT32 nRegions, UINT32** pSize, INT32 nSizes)
+{
+   struct NeoCacheHeader Header;
+   TCHAR szName[MAX_PATH + 64], szTemp[MAX_PATH + 72];
+   static const UINT8 Padding[NEO_CACHE_ALIGN] = { 0, };
+   bool bOkay = true;
+   FILE* fp;
+
+   if (szAppCachePath[0] == 0 || nRegions > NEO_CACHE_REGIONS || nSizes > NEO_CACHE_SIZES)
+      return;
+
+   NeoCacheFillHeader(&Header, pRegion, nRegions);
+   Header.nSizes = nSizes;
+   for (INT32 i = 0; i < nSizes; i++)
+      Header.nSize[i] = *pSize[i];
+   NeoCacheName(szName);
+   _stprintf(szTemp, _T("%s.tmp"), szName);
+
+   fp = _tfopen(szTemp, _T("wb"));
+   if (fp == NULL)
+      return;
+
+   bOkay = fwrite(&Header, sizeof(Header), 1, fp) == 1;
+   for (INT32 i = 0; i < nRegions && bOkay; i++) {
+      UINT32 nPad = Header.nOffset[i] - ftell(fp);
+      if (pRegion[i].nLen && *pRegion[i].ppData == NULL)
+         bOkay = false;
+      if (nPad && fwrite(Padding, 1, nPad, fp) != nPad)
+         bOkay = false;
+      if (pRegion[i].nLen && fwrite(*pRegion[i].ppData, 1, pRegion[i].nLen, fp) != pRegion[i].nLen)
+         bOkay = false;
+   }
+   if (bOkay) {
+      UINT32 nPad = NeoCacheFileSize(&Header) - ftell(fp);
+      if (nPad && fwrite(Padding, 1, nPad, fp) != nPad)
+         bOkay = false;
+   }
+
+   if (fclose(fp))
+      bOkay = false;
+
+   // Only a complete file gets the real name, so a half-written one is never used
+   if (bOkay) {
+      remove(szName);
+      bOkay = rename(szTemp, szName) == 0;
+   }
+   if (!bOkay)
+      remove(szTemp);
+}
+
+// Whether pData lies in the cache file mapped for a slot
+bool NeoCacheMapped(INT32 nSlot, const UINT8* pData)
+{
+   const UINT8* pMap = (const UINT8*)NeoCacheMap[nSlot];
+
+   return pMap && pData >= pMap && pData < pMap + nNeoCacheMapSize[nSlot];
+}
+
+// Give mapped pages back to the system, they are read from the file again on
+// the next access. The pages must not have been written to. Returns 1 where
+// this isn't possible.
+INT32 NeoCacheDiscard(UINT8* pData, UINT32 nLen)
+{
+#if defined NEO_CACHE_MMAP && defined MADV_DONTNEED
+   return madvise(pData, nLen, MADV_DONTNEED) != 0;
+#else
+   return 1;
+#endif
+}
+
+void NeoCacheExit(INT32 nSlot)
+{
+   if (NeoCacheMap[nSlot] == NULL)
+      return;
+
+#if defined NEO_CACHE_MMAP
+   munmap(NeoCacheMap[nSlot], nNeoCacheMapSize[nSlot]);
+#elif defined NEO_CACHE_WIN32
+   UnmapViewOfFile(NeoCacheMap[nSlot]);
+   CloseHandle(NeoCacheMapping[nSlot]);
+   NeoCacheMapping[nSlot] = NULL;
+#else
+   free(NeoCacheMap[nSlot]);
+#endif
+
+   NeoCacheMap[nSlot] = NULL;
+   nNeoCacheMapSize[nSlot] = 0;
+}
@@ -2,13 +2,106 @@
 // Neo Geo -- palette functions
 
 UINT8* NeoPalSrc[2];		// Pointer to input palettes
-UINT32* NeoPalette;
+UINT16* NeoPalette;
 INT32 nNeoPaletteBank;				// Selected palette bank
 
-static UINT32* NeoPaletteData[2] = {NULL, NULL};
-static UINT16* NeoPaletteCopy[2] = {NULL, NULL};
+static UINT16* NeoPaletteData[2] = {NULL, NULL};
+
+// Entries written since the last NeoUpdatePalette, one bit per colour
+static UINT32 NeoPaletteDirty[2][4096 / 32];
+static bool bNeoPaletteDirty;
 
 UINT8 NeoRecalcPalette;
+UINT32 nNeoPaletteGeneration;		// Bumped on every change to the converted palettes
+
+// CalcCol below only uses the 4 main bits of each component, so for the
+// usual BurnHighCol formats a colour converts with three masks and shifts.
+// NeoInitPalette checks that against CalcCol and sets up the shifts.
+
+#if !defined MSB_FIRST
+ #if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define NEO_PALETTE_SIMD_SSE2
+ #elif defined __ARM_NEON__ || defined __ARM_NEON
+  #include <arm_neon.h>
+  #define NEO_PALETTE_SIMD_NEON
+ #endif
+#endif
+
+static bool bNeoPaletteShift = false;
+static INT32 nNeoPaletteShift[3];					// Red, green, blue
+
+static inline UINT32 CalcCol(UINT16 nColour)
+{
+   INT32 r = ((nColour & 0x0F00) >> 4) | (((nColour >> 11) & 8) >> 5);
+   INT32 g = ((nColour & 0x00F0)     ) | (((nColour >> 10) & 8) >> 5);
+   INT32 b = ((nColour & 0x000F) << 4) | (((nColour >> 9) & 8)  >> 5);
+
+   return BurnHighCol(r, g, b, 0);
+}
+
+static inline UINT16 CalcColShift(UINT16 nColour)
+{
+   return (UINT16)(((nColour & 0x0F00) << nNeoPaletteShift[0]) | ((nColour & 0x00F0) << nNeoPaletteShift[1]) | ((nColour & 0x000F) << nNeoPaletteShift[2]));
+}
+
+static void NeoPaletteInitShift(void)
+{
+   INT32 i;
+
+   bNeoPaletteShift = false;
+
+   for (i = 0; i < 3; i++) {
+      UINT32 nColour = CalcCol(0x0100 >> (i << 2));
+      nNeoPaletteShift[i] = 0;
+      if (nColour == 0 || (nColour & (nColour - 1)))
+         return;
+      while ((1u << (nNeoPaletteShift[i] + 8 - (i << 2))) != nColour)
+         if (++nNeoPaletteShift[i] > 8)
+            return;
+   }
+
+   for (i = 0; i < 0x10000; i++)
+      if (CalcCol(i) != CalcColShift(i))
+         return;
+
+   bNeoPaletteShift = true;
+}
+
+// Convert the 8 colours at nIndex in bank nBank
+static void NeoPaletteConvert8(INT32 nBank, INT32 nIndex)
+{
+   UINT16* ps = (UINT16*)NeoPalSrc[nBank] + nIndex;
+   UINT16* pd = NeoPaletteData[nBank] + nIndex;
+
+#if defined NEO_PALETTE_SIMD_SSE2
+   if (bNeoPaletteShift) {
+      __m128i c = _mm_loadu_si128((const __m128i*)ps);
+      __m128i r = _mm_sll_epi16(_mm_and_si128(c, _mm_set1_epi16(0x0F00)), _mm_cvtsi32_si128(nNeoPaletteShift[0]));
+      __m128i g = _mm_sll_epi16(_mm_and_si128(c, _mm_set1_epi16(0x00F0)), _mm_cvtsi32_si128(nNeoPaletteShift[1]));
+      __m128i b = _mm_sll_epi16(_mm_and_si128(c, _mm_set1_epi16(0x000F)), _mm_cvtsi32_si128(nNeoPaletteShift[2]));
+      _mm_storeu_si128((__m128i*)pd, _mm_or_si128(_mm_or_si128(r, g), b));
+      return;
+   }
+#elif defined NEO_PALETTE_SIMD_NEON
+   if (bNeoPaletteShift) {
+      uint16x8_t c = vld1q_u16(ps);
+      uint16x8_t r = vshlq_u16(vandq_u16(c, vdupq_n_u16(0x0F00)), vdupq_n_s16(nNeoPaletteShift[0]));
+      uint16x8_t g = vshlq_u16(vandq_u16(c, vdupq_n_u16(0x00F0)), vdupq_n_s16(nNeoPaletteShift[1]));
+      uint16x8_t b = vshlq_u16(vandq_u16(c, vdupq_n_u16(0x000F)), vdupq_n_s16(nNeoPaletteShift[2]));
+      vst1q_u16(pd, vorrq_u16(vorrq_u16(r, g), b));
+      return;
+   }
+#endif
+
+   if (bNeoPaletteShift) {
+      for (INT32 i = 0; i < 8; i++)
+         pd[i] = CalcColShift(BURN_ENDIAN_SWAP_INT16(ps[i]));
+   } else {
+      for (INT32 i = 0; i < 8; i++)
+         pd[i] = (UINT16)CalcCol(BURN_ENDIAN_SWAP_INT16(ps[i]));
+   }
+}
 
 INT32 NeoInitPalette(void)
 {
@@ -18,12 +111,11 @@ INT32 NeoInitPalette(void)
    {
       if (NeoPaletteData[i])
          BurnFree(NeoPaletteData[i]);
-      if (NeoPaletteCopy[i])
-         BurnFree(NeoPaletteCopy[i]);
-      NeoPaletteData[i] = (UINT32*)BurnMalloc(4096 * sizeof(UINT32));
-      NeoPaletteCopy[i] = (UINT16*)BurnMalloc(4096 * sizeof(UINT16));
+      NeoPaletteData[i] = (UINT16*)BurnMalloc(4096 * sizeof(UINT16));
    }
 
+   NeoPaletteInitShift();
+
    NeoRecalcPalette = 1;
 
    return 0;
@@ -35,42 +127,47 @@ void NeoExitPalette(void)
 	for (i = 0; i < 2; i++)
    {
 		BurnFree(NeoPaletteData[i]);
-		BurnFree(NeoPaletteCopy[i]);
 	}
 }
 
-static inline UINT32 CalcCol(UINT16 nColour)
-{
-   INT32 r = ((nColour & 0x0F00) >> 4) | (((nColour >> 11) & 8) >> 5);
-   INT32 g = ((nColour & 0x00F0)     ) | (((nColour >> 10) & 8) >> 5);
-   INT32 b = ((nColour & 0x000F) << 4) | (((nColour >> 9) & 8)  >> 5);
-
-   return BurnHighCol(r, g, b, 0);
-}
-
+// Convert the colours written since the last call, everything if NeoRecalcPalette is set.
+// Called before anything is drawn, so palette writes show up right away.
 INT32 NeoUpdatePalette(void)
 {
-	if (NeoRecalcPalette)
-   {
-      INT32 i, j;
-      UINT16* ps;
-      UINT16* pc;
-      UINT32* pd;
+   INT32 i, j, k;
 
+   if (NeoRecalcPalette)
+   {
       // Update both palette banks
-      for (j = 0; j < 2; j++)
+      memset(NeoPaletteDirty, 0xFF, sizeof(NeoPaletteDirty));
+      bNeoPaletteDirty = true;
+
+      NeoRecalcPalette = 0;
+      nNeoPaletteGeneration++;
+   }
+
+   if (!bNeoPaletteDirty)
+      return 0;
+
+   for (j = 0; j < 2; j++)
+   {
+      for (i = 0; i < 4096 / 32; i++)
       {
-         for (i = 0, ps = (UINT16*)NeoPalSrc[j], pc = NeoPaletteCopy[j], pd = NeoPaletteData[j]; i < 4096; i++, ps++, pc++, pd++)
+         UINT32 nDirty = NeoPaletteDirty[j][i];
+         if (nDirty == 0)
+            continue;
+
+         NeoPaletteDirty[j][i] = 0;
+         for (k = 0; k < 4; k++)
          {
-            *pc = *ps;
-            *pd = CalcCol(BURN_ENDIAN_SWAP_INT16(*ps));
+            if (nDirty & (0xFF << (k << 3)))
+               NeoPaletteConvert8(j, (i << 5) + (k << 3));
          }
       }
-
-      NeoRecalcPalette = 0;
-
    }
 
+   bNeoPaletteDirty = false;
+
 	return 0;
 }
 
@@ -79,18 +176,23 @@ void NeoSetPalette(void)
 	NeoPalette = NeoPaletteData[nNeoPaletteBank];
 }
 
-// Update the PC copy of the palette on writes to the palette memory
+static inline void NeoPaletteSetDirty(UINT32 nEntry)
+{
+	NeoPaletteDirty[nNeoPaletteBank][nEntry >> 5] |= 1 << (nEntry & 31);
+	bNeoPaletteDirty = true;
+	nNeoPaletteGeneration++;
+}
+
+// Mark changed entries of the palette memory, NeoUpdatePalette converts them
 void __fastcall NeoPalWriteByte(UINT32 nAddress, UINT8 byteValue)
 {
 	nAddress &= 0x1FFF;
 	nAddress ^= 1;
 
-	NeoPalSrc[nNeoPaletteBank][nAddress] = byteValue;							// write byte
-
-	if (*((UINT8*)(NeoPaletteCopy[nNeoPaletteBank] + nAddress)) != byteValue)
+	if (NeoPalSrc[nNeoPaletteBank][nAddress] != byteValue)
    {
-		*((UINT8*)(NeoPaletteCopy[nNeoPaletteBank] + nAddress)) = byteValue;
-		NeoPaletteData[nNeoPaletteBank][nAddress >> 1] = CalcCol(*(UINT16*)(NeoPalSrc[nNeoPaletteBank] + (nAddress & ~0x01)));
+		NeoPalSrc[nNeoPaletteBank][nAddress] = byteValue;						// write byte
+		NeoPaletteSetDirty(nAddress >> 1);
 	}
 }
 
@@ -99,12 +201,9 @@ void __fastcall NeoPalWriteWord(UINT32 nAddress, UINT16 wordValue)
 	nAddress &= 0x1FFF;
 	nAddress >>= 1;
 
-	((UINT16*)NeoPalSrc[nNeoPaletteBank])[nAddress] = BURN_ENDIAN_SWAP_INT16(wordValue);		// write word
-
-	if (NeoPaletteCopy[nNeoPaletteBank][nAddress] != BURN_ENDIAN_SWAP_INT16(wordValue))
+	if (((UINT16*)NeoPalSrc[nNeoPaletteBank])[nAddress] != BURN_ENDIAN_SWAP_INT16(wordValue))
    {
-		NeoPaletteCopy[nNeoPaletteBank][nAddress] = BURN_ENDIAN_SWAP_INT16(wordValue);
-		NeoPaletteData[nNeoPaletteBank][nAddress] = CalcCol(wordValue);
+		((UINT16*)NeoPalSrc[nNeoPaletteBank])[nAddress] = BURN_ENDIAN_SWAP_INT16(wordValue);	// write word
+		NeoPaletteSetDirty(nAddress);
 	}
 }
-
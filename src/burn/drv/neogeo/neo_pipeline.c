@@ -0,0 +1,335 @@
+// Neo Geo -- render pipeline
+//
+// The sprite and fix layer renderers draw from the render state below instead
+// of the live machine. Normally it points at the live video RAM, palette and
+// frame buffer. With bNeoRenderPipeline set, NeoFrame records a command list
+// instead (clear, sprite slices, fix layer), each with a copy of the state it
+// needs, and a background thread draws it while the next frame is emulated.
+// The finished image is handed to the frontend one frame later.
+//
+// With bNeoRenderSkipUnchanged set, a frame that is drawn in one go is only
+// drawn at its end, and not at all if nothing it depends on changed since the
+// previous one. bNeoRenderUnchanged then tells the frontend to show the
+// previous image again.
+
+#include "neogeo.h"
+
+UINT8* pNeoRenderDraw;
+UINT8* NeoRenderVRAM;
+UINT16* NeoRenderPalette;
+INT32 nNeoRenderSpriteFrame, nNeoRenderSpriteStart;
+bool bNeoRenderTextBIOS;
+
+bool bNeoRenderPipeline = false;
+bool bNeoRenderSkipUnchanged = false;
+bool bNeoRenderUnchanged = false;
+
+#define NEO_PIPE_VRAM_SIZE		(0x10C00)				// SCB1, fix map and SCB2-4
+#define NEO_PIPE_COMMANDS		(32)
+
+#define NEO_PIPE_CLEAR			(0)
+#define NEO_PIPE_SPRITES		(1)
+#define NEO_PIPE_TEXT			(2)
+
+struct NeoPipeState {
+   UINT8 VRAM[NEO_PIPE_VRAM_SIZE];
+   UINT16 Palette[4096];
+   INT32 nSpriteFrame, nSpriteStart;
+   bool bTextBIOS;
+};
+
+struct NeoPipeCommand {
+   INT32 nType;
+   INT32 nSliceStart, nSliceEnd;
+   UINT32 nColour;
+   struct NeoPipeState* pState;
+};
+
+struct NeoPipeFrame {
+   INT32 nCommands;
+   struct NeoPipeCommand Command[NEO_PIPE_COMMANDS];
+   INT32 nStates;
+   struct NeoPipeState* pState[NEO_PIPE_COMMANDS];		// Allocated on first use, kept between frames
+};
+
+static struct NeoPipeFrame NeoPipe[2];
+static INT32 nNeoPipeRecord = 0;						// Frame being recorded, the other one may be drawn
+static bool bNeoPipeActive = false;						// The current frame is recorded
+static bool bNeoPipePending = false;					// A frame was handed to the render thread
+static INT32 nNeoPipeCycles;							// 68K cycles when the last state was taken
+
+static UINT8* NeoPipeDraw = NULL;						// Frame buffer used by the render thread
+
+// Everything the image of a frame depends on
+struct NeoRenderSignature {
+   UINT32 nGraphicsGeneration, nPaletteGeneration;
+   INT32 nPaletteBank, nSpriteFrame, nSpriteStart, nLayer;
+   bool bEnableGraphics, bTextBIOS, bText;
+};
+
+static struct NeoRenderSignature NeoLastSignature;
+static bool bNeoLastSignatureValid = false;				// The last image was drawn from NeoLastSignature
+
+static bool bNeoRenderDeferred;							// Nothing drawn yet in this frame
+static bool bNeoDeferredSlice;
+static INT32 nNeoDeferredSliceStart, nNeoDeferredSliceEnd;
+
+static UINT32 nNeoRenderBackdrop;						// Backdrop colour at the start of the frame
+
+static void NeoRenderUseLive(void)
+{
+   pNeoRenderDraw        = pBurnDraw;
+   NeoRenderVRAM         = NeoGraphicsRAM;
+   NeoRenderPalette      = NeoPalette;
+   nNeoRenderSpriteFrame = nNeoSpriteFrame;
+   bNeoRenderTextBIOS    = bBIOSTextROMEnabled;
+}
+
+static void NeoPipeRender(void* pParam)
+{
+   struct NeoPipeFrame* pFrame = (struct NeoPipeFrame*)pParam;
+
+   pNeoRenderDraw = NeoPipeDraw;
+
+   for (INT32 i = 0; i < pFrame->nCommands; i++) {
+      struct NeoPipeCommand* pCommand = &pFrame->Command[i];
+      struct NeoPipeState* pState = pCommand->pState;
+
+      if (pState) {
+         NeoRenderVRAM         = pState->VRAM;
+         NeoRenderPalette      = pState->Palette;
+         nNeoRenderSpriteFrame = pState->nSpriteFrame;
+         nNeoRenderSpriteStart = pState->nSpriteStart;
+         bNeoRenderTextBIOS    = pState->bTextBIOS;
+      }
+
+      switch (pCommand->nType) {
+         case NEO_PIPE_CLEAR:
+            NeoClearScreen(pCommand->nColour);
+            break;
+         case NEO_PIPE_SPRITES:
+            nSliceStart = pCommand->nSliceStart;
+            nSliceEnd   = pCommand->nSliceEnd;
+            nSliceSize  = nSliceEnd - nSliceStart;
+            NeoRenderSprites();
+            break;
+         case NEO_PIPE_TEXT:
+            NeoRenderText();
+            break;
+      }
+   }
+}
+
+// Copy the machine state the renderers need, unless the 68K has not run since the last copy
+static struct NeoPipeState* NeoPipeCapture(bool bReuse)
+{
+   struct NeoPipeFrame* pFrame = &NeoPipe[nNeoPipeRecord];
+   struct NeoPipeState* pState;
+
+   if (bReuse && pFrame->nStates && nNeoPipeCycles == SekTotalCycles())
+      return pFrame->pState[pFrame->nStates - 1];
+
+   if (pFrame->pState[pFrame->nStates] == NULL)
+      pFrame->pState[pFrame->nStates] = (struct NeoPipeState*)BurnMalloc(sizeof(struct NeoPipeState));
+
+   pState = pFrame->pState[pFrame->nStates++];
+
+   memcpy(pState->VRAM, NeoGraphicsRAM, NEO_PIPE_VRAM_SIZE);
+   memcpy(pState->Palette, NeoPalette, sizeof(pState->Palette));
+   pState->nSpriteFrame = nNeoSpriteFrame;
+   pState->nSpriteStart = bReuse ? NeoSpriteStart() : 0;
+   pState->bTextBIOS    = bBIOSTextROMEnabled;
+
+   nNeoPipeCycles = bReuse ? SekTotalCycles() : -1;
+
+   return pState;
+}
+
+static void NeoPipeAdd(INT32 nType, bool bReuse)
+{
+   struct NeoPipeFrame* pFrame = &NeoPipe[nNeoPipeRecord];
+   struct NeoPipeCommand* pCommand;
+
+   // Keep the last entry for the fix layer, merge further slices into the previous one
+   if (nType == NEO_PIPE_SPRITES && pFrame->nCommands >= NEO_PIPE_COMMANDS - 1) {
+      pCommand = &pFrame->Command[pFrame->nCommands - 1];
+      if (pCommand->nType == NEO_PIPE_SPRITES)
+         pCommand->nSliceEnd = nSliceEnd;
+      return;
+   }
+
+   pCommand = &pFrame->Command[pFrame->nCommands++];
+   pCommand->nType       = nType;
+   pCommand->nSliceStart = nSliceStart;
+   pCommand->nSliceEnd   = nSliceEnd;
+   pCommand->nColour     = nNeoRenderBackdrop;
+   pCommand->pState      = (nType == NEO_PIPE_CLEAR) ? NULL : NeoPipeCapture(bReuse);
+}
+
+// Wait until the render thread is idle, so the renderers can be used directly
+void NeoRenderFlush(void)
+{
+   if (bNeoPipePending) {
+      BurnTaskWait();
+      bNeoPipePending = false;
+   }
+}
+
+static void NeoRenderBegin(bool bPipeline)
+{
+   bNeoPipeActive = bPipeline && bNeoRenderPipeline && !bNeoLineRenderer;
+
+   if (bNeoPipeActive) {
+      if (NeoPipeDraw == NULL)
+         NeoPipeDraw = (UINT8*)BurnMalloc(320 * 224 * 4);
+
+      NeoPipe[nNeoPipeRecord].nCommands = 0;
+      NeoPipe[nNeoPipeRecord].nStates   = 0;
+
+      NeoPipeAdd(NEO_PIPE_CLEAR, false);
+      return;
+   }
+
+   NeoRenderFlush();
+   NeoRenderUseLive();
+   NeoClearScreen(nNeoRenderBackdrop);
+}
+
+static void NeoRenderGetSignature(struct NeoRenderSignature* pSignature, bool bText)
+{
+   memset(pSignature, 0, sizeof(*pSignature));
+
+   pSignature->nGraphicsGeneration = nNeoGraphicsGeneration;
+   pSignature->nPaletteGeneration  = nNeoPaletteGeneration;
+   pSignature->nPaletteBank        = nNeoPaletteBank;
+   pSignature->nSpriteFrame        = nNeoSpriteFrame;
+   pSignature->nSpriteStart        = NeoSpriteStart();
+   pSignature->nLayer              = nBurnLayer;
+   pSignature->bEnableGraphics     = bNeoEnableGraphics;
+   pSignature->bTextBIOS           = bBIOSTextROMEnabled;
+   pSignature->bText               = bText;
+}
+
+// Start of a frame that is displayed: fill the screen with the backdrop colour.
+// bPipeline is false when the image is needed right away (redraws).
+void NeoRenderClear(bool bPipeline)
+{
+   nNeoRenderBackdrop  = NeoPalette[0x0FFF];
+   bNeoRenderUnchanged = false;
+
+   bNeoRenderDeferred = bPipeline && bNeoRenderSkipUnchanged;
+   bNeoDeferredSlice  = false;
+
+   if (bNeoRenderDeferred) {
+      bNeoPipeActive = false;
+      return;
+   }
+
+   NeoRenderBegin(bPipeline);
+}
+
+// Draw the sprites for nSliceStart - nSliceEnd
+void NeoRenderSlice(void)
+{
+   NeoUpdatePalette();
+
+   if (bNeoRenderDeferred) {
+      // A single slice covering the screen can wait for NeoRenderFinish,
+      // raster effects mean the frame has to be drawn as it goes
+      if (nSliceStart <= 0x10 && nSliceEnd >= 0xF0) {
+         bNeoDeferredSlice      = true;
+         nNeoDeferredSliceStart = nSliceStart;
+         nNeoDeferredSliceEnd   = nSliceEnd;
+         return;
+      }
+
+      bNeoRenderDeferred = false;
+      NeoRenderBegin(true);
+   }
+
+   if (bNeoPipeActive) {
+      NeoPipeAdd(NEO_PIPE_SPRITES, true);
+      return;
+   }
+
+   NeoRenderUseLive();
+   nNeoRenderSpriteStart = NeoSpriteStart();
+   NeoRenderSprites();
+}
+
+// End of a displayed frame: draw the fix layer and, when pipelined, present the
+// previous frame and hand this one to the render thread
+void NeoRenderFinish(bool bText)
+{
+   NeoUpdatePalette();
+
+   if (bNeoRenderDeferred) {
+      struct NeoRenderSignature Signature;
+
+      bNeoRenderDeferred = false;
+
+      NeoRenderGetSignature(&Signature, bText);
+      if (bNeoLastSignatureValid && memcmp(&Signature, &NeoLastSignature, sizeof(Signature)) == 0) {
+         if (bNeoPipePending) {
+            // The frame the render thread is drawing looks the same, show it
+            NeoRenderFlush();
+            memcpy(pBurnDraw, NeoPipeDraw, nNeoScreenWidth * 224 * nBurnBpp);
+         } else {
+            bNeoRenderUnchanged = true;
+         }
+         return;
+      }
+
+      NeoLastSignature       = Signature;
+      bNeoLastSignatureValid = true;
+
+      NeoRenderBegin(true);
+      if (bNeoDeferredSlice) {
+         nSliceStart = nNeoDeferredSliceStart;
+         nSliceEnd   = nNeoDeferredSliceEnd;
+         nSliceSize  = nSliceEnd - nSliceStart;
+         NeoRenderSlice();
+      }
+   } else {
+      bNeoLastSignatureValid = false;
+   }
+
+   if (!bNeoPipeActive) {
+      if (bText) {
+         NeoRenderUseLive();
+         NeoRenderText();
+      }
+      return;
+   }
+
+   if (bText)
+      NeoPipeAdd(NEO_PIPE_TEXT, true);
+
+   NeoRenderFlush();
+   memcpy(pBurnDraw, NeoPipeDraw, nNeoScreenWidth * 224 * nBurnBpp);
+
+   BurnTaskStart(NeoPipeRender, &NeoPipe[nNeoPipeRecord]);
+   bNeoPipePending = true;
+
+   nNeoPipeRecord ^= 1;
+}
+
+void NeoRenderExit(void)
+{
+   NeoRenderFlush();
+   bNeoPipeActive = false;
+   bNeoRenderDeferred = bNeoLastSignatureValid = false;
+
+   for (INT32 i = 0; i < 2; i++) {
+      for (INT32 j = 0; j < NEO_PIPE_COMMANDS; j++) {
+         if (NeoPipe[i].pState[j]) {
+            BurnFree(NeoPipe[i].pState[j]);
+         }
+      }
+      NeoPipe[i].nCommands = NeoPipe[i].nStates = 0;
+   }
+
+   if (NeoPipeDraw) {
+      BurnFree(NeoPipeDraw);
+   }
+}
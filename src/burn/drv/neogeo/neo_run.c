@@ -177,6 +177,7 @@ static UINT16 NeoGraphicsRAMPointer;
 static INT32 nNeoGraphicsModulo;
 
 INT32 nNeoSpriteFrame;
+UINT32 nNeoGraphicsGeneration;							// Bumped whenever the displayed graphics may have changed
 
 static INT32 nSpriteFrameSpeed;
 static INT32 nSpriteFrameTimer;
@@ -403,6 +404,9 @@ static INT32 NeoLoad68KBIOS(INT32 nNewBIOS)
 	
 	NeoUpdateVector();
 
+	// The BIOS and the vector table are mapped at the same place as before
+	SekFlushCodeCache();
+
 	return 0;
 }
 
@@ -677,12 +681,58 @@ static INT32 LoadRoms(void)
    //	if (nSpriteSize[nNeoActiveSlot] > 0x4000000) {
    //		nSpriteSize[nNeoActiveSlot] = 0x5000000;
    //	}
+   // The final ROM images, as stored in the pre-decoded ROM cache, and the tile
+   // opacity table built while decoding the sprites (so a cache hit doesn't
+   // read the whole sprite ROM to build it again)
+   struct NeoCacheRegion CacheRegion[] = {
+      { &NeoSpriteROM[nNeoActiveSlot],    nSpriteSize[nNeoActiveSlot] < (nNeoTileMask[nNeoActiveSlot] << 7) ? ((nNeoTileMask[nNeoActiveSlot] + 1) << 7) : nSpriteSize[nNeoActiveSlot] },
+      { &NeoTextROM[nNeoActiveSlot],      nNeoTextROMSize[nNeoActiveSlot] },
+      { &Neo68KROM[nNeoActiveSlot],       nCodeSize[nNeoActiveSlot] },
+      { &NeoZ80ROM[nNeoActiveSlot],       0x080000 },
+      { &YM2610ADPCMAROM[nNeoActiveSlot], pInfo->nADPCMANum ? nYM2610ADPCMASize[nNeoActiveSlot] : 0 },
+      { &YM2610ADPCMBROM[nNeoActiveSlot], pInfo->nADPCMBNum ? nYM2610ADPCMBSize[nNeoActiveSlot] : 0 },
+      { (UINT8**)&NeoTileAttrib[nNeoActiveSlot], (nNeoTileMask[nNeoActiveSlot] + 1) * sizeof(UINT32) },
+   };
+   INT32 nCacheRegions = sizeof(CacheRegion) / sizeof(CacheRegion[0]);
+
+   // The sizes the driver's callback may still change (sbp shrinks its fix
+   // layer), stored with the images as they are after the callback has run
+   UINT32* CacheSize[] = {
+      (UINT32*)&nNeoTextROMSize[nNeoActiveSlot],
+      &nSpriteSize[nNeoActiveSlot],
+      &nCodeSize[nNeoActiveSlot],
+      (UINT32*)&nYM2610ADPCMASize[nNeoActiveSlot],
+      (UINT32*)&nYM2610ADPCMBSize[nNeoActiveSlot],
+   };
+   INT32 nCacheSizes = sizeof(CacheSize) / sizeof(CacheSize[0]);
+
+#ifndef GEKKO
+   UINT64 nProfile = BurnProfileStart();
+   INT32 nCacheMiss = NeoCacheLoad(CacheRegion, nCacheRegions, CacheSize, nCacheSizes);
+   BurnProfileStop("NeoCacheLoad", nProfile, 0);
+
+   // Everything below, including the driver's callback, only produces these
+   // images and the sizes restored with them, so a cache hit skips all of it
+   if (nCacheMiss == 0) {
+      Neo68KROMActive = Neo68KROM[nNeoActiveSlot];
+      Neo68KFix[nNeoActiveSlot] = Neo68KROM[nNeoActiveSlot];
+      NeoZ80ROMActive = NeoZ80ROM[nNeoActiveSlot];
+
+      if (pInfo->nADPCMBNum == 0) {
+         YM2610ADPCMBROM[nNeoActiveSlot] = YM2610ADPCMAROM[nNeoActiveSlot];
+         nYM2610ADPCMBSize[nNeoActiveSlot] = nYM2610ADPCMASize[nNeoActiveSlot];
+      }
+
+      return 0;
+   }
+#endif
+
 #ifdef GEKKO
 	InitCache();
 	if(!BurnUseCache)
 #endif
 	{
-		 NeoSpriteROM[nNeoActiveSlot] = (UINT8*)BurnMalloc(nSpriteSize[nNeoActiveSlot] < (nNeoTileMask[nNeoActiveSlot] << 7) ? ((nNeoTileMask[nNeoActiveSlot] + 1) << 7) : nSpriteSize[nNeoActiveSlot]);
+		 NeoSpriteROM[nNeoActiveSlot] = (UINT8*)BurnMalloc(CacheRegion[0].nLen);
 		 if (NeoSpriteROM[nNeoActiveSlot] == NULL) {
 		    return 1;
 		 }
@@ -767,10 +817,12 @@ static INT32 LoadRoms(void)
    {
       // Decode text data
       BurnUpdateProgress(0.0, _T("Preprocessing text layer graphics...")/*, BST_PROCESS_TXT*/, 0);
+      UINT64 nProfileText = BurnProfileStart();
       NeoDecodeText(0, nNeoTextROMSize[nNeoActiveSlot], NeoTextROM[nNeoActiveSlot], NeoTextROM[nNeoActiveSlot]);
+      BurnProfileStop("NeoDecodeText", nProfileText, nNeoTextROMSize[nNeoActiveSlot]);
 
-      // Decode sprite data
-      NeoDecodeSprites(NeoSpriteROM[nNeoActiveSlot], nSpriteSize[nNeoActiveSlot]);
+      // Decode sprite data, and build the tile opacity table in the same pass
+      NeoDecodeSprites(NeoSpriteROM[nNeoActiveSlot], nSpriteSize[nNeoActiveSlot], NeoAllocTileAttrib(nNeoActiveSlot));
    }
 
    if (pInfo->nADPCMANum) {
@@ -837,6 +889,10 @@ static INT32 LoadRoms(void)
       nYM2610ADPCMBSize[nNeoActiveSlot] = nYM2610ADPCMASize[nNeoActiveSlot];
    }
 
+#ifndef GEKKO
+   NeoCacheSave(CacheRegion, nCacheRegions, CacheSize, nCacheSizes);
+#endif
+
    return 0;
 }
 
@@ -1471,6 +1527,10 @@ INT32 NeoScan(INT32 nAction, INT32* pnMin)
 		}
 
 		SCAN_OFF(NeoGraphicsRAMBank, NeoGraphicsRAM, nAction);
+		if (nAction & ACB_WRITE) {
+			bNeoSpriteListDirty = true;
+			nNeoGraphicsGeneration++;
+		}
 
 		SCAN_VAR(nNeoSpriteFrame); SCAN_VAR(nSpriteFrameSpeed); SCAN_VAR(nSpriteFrameTimer);
 
@@ -2181,6 +2241,10 @@ void __fastcall neogeoWriteWordVideo(UINT32 sekAddress, UINT16 wordValue)
 		}
 		case 0x02: {
 			*((UINT16*)(NeoGraphicsRAMBank + NeoGraphicsRAMPointer)) = wordValue;
+			nNeoGraphicsGeneration++;
+			if (NeoGraphicsRAMBank != NeoGraphicsRAM && NeoGraphicsRAMPointer < 0x0C00) {
+				bNeoSpriteListDirty = true;							// SCB2-4 changed
+			}
 			NeoGraphicsRAMPointer += nNeoGraphicsModulo;
 
 #if 0
@@ -3553,6 +3617,8 @@ void wav_exit();
 
 static INT32 neogeoReset()
 {
+   NeoRenderFlush();
+
    if (nNeoSystemType & NEO_SYS_CART) {
       NeoLoad68KBIOS(NeoSystem & 0x1f);
 
@@ -3633,6 +3699,9 @@ static INT32 neogeoReset()
    nSpriteFrameTimer = 0;
    nNeoSpriteFrame = 0;
 
+   bNeoSpriteListDirty = true;
+   nNeoGraphicsGeneration++;
+
    nIRQAcknowledge = ~0;
    bIRQEnabled = false;
 
@@ -3744,6 +3813,12 @@ static void SwitchToMusashi(void)
 	}
 }
 
+// Loops the idle loop detection gets wrong, as { driver, address of the
+// branch back, SEK_IDLE_NEVER or SEK_IDLE_ALWAYS }
+static const struct { const char* szName; UINT32 nAddress; INT32 nType; } NeoIdleLoops[] = {
+	{ NULL, 0, 0 }
+};
+
 static INT32 NeoInitCommon()
 {
 	BurnSetRefreshRate(NEO_VREFRESH);
@@ -3788,6 +3863,17 @@ static INT32 NeoInitCommon()
 
 		SekSetCyclesScanline((INT32)(12000000.0 / NEO_HREFRESH));
 
+		// Cartridge code runs from ROM, and bankswitching only goes through SekMapMemory
+		SekSetCodeCache(1);
+
+		// Most games spin on a RAM flag set by the VBlank interrupt
+		SekSetIdleSkip(1);
+		for (INT32 i = 0; NeoIdleLoops[i].szName; i++) {
+			if (!strcmp(NeoIdleLoops[i].szName, BurnDrvGetTextA(DRV_NAME))) {
+				SekSetIdleLoop(NeoIdleLoops[i].nAddress, NeoIdleLoops[i].nType);
+			}
+		}
+
 		// Map 68000 memory:
 
 		if (nNeoSystemType & NEO_SYS_CART) {
@@ -4024,9 +4110,10 @@ INT32 NeoInit(void)
 {
 	if (recursing)
    {
-		if (LoadRoms())
-			return 1;
-		return 0;
+		UINT64 nProfile = BurnProfileStart();
+		INT32 nRet = LoadRoms();
+		BurnProfileStop("LoadRoms", nProfile, 0);
+		return nRet ? 1 : 0;
 	}
 
 	recursing = true;
@@ -4085,7 +4172,10 @@ INT32 NeoInit(void)
 	}
    else
    {
-		if (LoadRoms())
+		UINT64 nProfile = BurnProfileStart();
+		INT32 nRet = LoadRoms();
+		BurnProfileStop("LoadRoms", nProfile, 0);
+		if (nRet)
 			return 1;
 	}
 
@@ -4225,6 +4315,7 @@ INT32 NeoExit(void)
 	
 	uPD4990AExit();
 
+	NeoRenderExit();
 	NeoExitPalette();
 
 	BurnYM2610Exit();
@@ -4249,6 +4340,7 @@ INT32 NeoExit(void)
 			BurnFree(NeoZ80ROM[nNeoActiveSlot]);						// Z80 ROM
 			BurnFree(YM2610ADPCMAROM[nNeoActiveSlot]);
 			BurnFree(YM2610ADPCMBROM[nNeoActiveSlot]);
+			NeoCacheExit(nNeoActiveSlot);							// ROMs mapped from the cache
 		}
 	}
 #ifdef GEKKO
@@ -4308,7 +4400,7 @@ INT32 NeoExit(void)
 INT32 NeoRender(void)
 {
 	NeoUpdatePalette();							// Update the palette
-	NeoClearScreen();
+	NeoRenderClear(false);
 
 	if (bNeoEnableGraphics)
    {
@@ -4319,9 +4411,9 @@ INT32 NeoRender(void)
       bprintf(PRINT_NORMAL, _T(" -- Drawing slice: %3i - %3i.\n"), nSliceStart, nSliceEnd);
 #endif
 
-      NeoRenderSprites();						// Render sprites
-      NeoRenderText();						// Render text layer
+      NeoRenderSlice();						// Render sprites
    }
+   NeoRenderFinish(bNeoEnableGraphics);			// Render text layer
 
 	return 0;
 }
@@ -4561,7 +4653,7 @@ INT32 NeoFrame(void)
 
    if (pBurnDraw) {
       NeoUpdatePalette();											// Update the palette
-      NeoClearScreen();
+      NeoRenderClear(true);
    }
    nSliceEnd = 0x10;
 
@@ -4626,10 +4718,12 @@ INT32 NeoFrame(void)
    // Display starts here
 
    nCyclesVBlank = nSekCyclesScanline * 248;
-   if (bRenderLineByLine) {
+   if (bRenderLineByLine || bNeoLineRenderer) {
       INT32 nLastIRQ = nIRQCycles - 1;
       while (SekTotalCycles() < nCyclesVBlank)
       {
+         // The scanline renderer draws every line as the beam reaches it
+         bForcePartialRender |= bRenderImage && bNeoLineRenderer;
 
          if ((nIRQControl & 0x10) && (nIRQCycles < NO_IRQ_PENDING) && (nLastIRQ < nIRQCycles) && (SekTotalCycles() >= nIRQCycles)) {
             nLastIRQ = nIRQCycles;
@@ -4671,7 +4765,7 @@ INT32 NeoFrame(void)
                bprintf(PRINT_NORMAL, _T(" -- Drawing slice: %3i - %3i.\n"), nSliceStart, nSliceEnd);
 #endif
 
-               NeoRenderSprites();								// Render sprites
+               NeoRenderSlice();								// Render sprites
             }
          }
 
@@ -4730,7 +4824,7 @@ INT32 NeoFrame(void)
                   bprintf(PRINT_NORMAL, _T(" -- Drawing slice: %3i - %3i.\n"), nSliceStart, nSliceEnd);
 #endif
 
-                  NeoRenderSprites();								// Render sprites
+                  NeoRenderSlice();								// Render sprites
                }
             }
 
@@ -4759,10 +4853,12 @@ INT32 NeoFrame(void)
          bprintf(PRINT_NORMAL, _T(" -- Drawing slice: %3i - %3i.\n"), nSliceStart, nSliceEnd);
 #endif
 
-         NeoRenderSprites();										// Render sprites
+         NeoRenderSlice();										// Render sprites
       }
-      NeoRenderText();											// Render text layer
    }
+   if (pBurnDraw)
+      NeoRenderFinish(bRenderImage);								// Render text layer
+   NeoSpritePageTrim();
 
    nIRQAcknowledge &= ~4;
    SekSetIRQLine(nVBLankIRQ, SEK_IRQSTATUS_ACK);
@@ -14,67 +14,111 @@ static UINT8* NeoSpriteROMActive;
 static UINT32 nNeoTileMaskActive;
 static INT32 nNeoMaxTileActive;
 
-static UINT8* NeoTileAttrib[MAX_SLOT] = { NULL, };
-static UINT8* NeoTileAttribActive;
-
-INT32 nSliceStart, nSliceEnd, nSliceSize;
-
-static UINT32* pTileData;
-static UINT32* pTilePalette;
-
-static UINT16* pBank;
-
-static INT32 nBankSize;
-static INT32 nBankXPos, nBankYPos;
-static INT32 nBankXZoom, nBankYZoom;
+// Per tile opacity table, 2 bits for each of the 16 rows (row 0 in bits 0-1).
+// A value of 0 means the whole tile is transparent.
+#define NEO_TILEROW_TRANSPARENT	(0)
+#define NEO_TILEROW_OPAQUE		(1)
+#define NEO_TILEROW_MIXED		(2)
+
+UINT32* NeoTileAttrib[MAX_SLOT] = { NULL, };
+static UINT32* NeoTileAttribActive;
+
+// Sprite ROM paging. When the sprite ROM is mapped from the ROM cache and
+// nNeoSpriteROMBudget is set (in MB), the renderers stamp each 64KB page they
+// draw from with the current frame, and NeoSpritePageTrim hands the least
+// recently used pages back to the system once more than the budget is
+// resident. The mapping reads them back from the cache file when needed.
+INT32 nNeoSpriteROMBudget = 0;
+
+#define NEO_SPRITE_PAGE_SHIFT	(16)
+#define NEO_SPRITE_PAGE_TILES	(NEO_SPRITE_PAGE_SHIFT - 7)
+
+static UINT32* NeoSpritePage[MAX_SLOT] = { NULL, };		// Frame each page was last used in, 0 if not resident
+static INT32 nNeoSpritePages[MAX_SLOT];
+static UINT32* NeoSpritePageActive;
+static INT32 nNeoSpritePagesActive;
+static UINT32 nNeoSpritePageClock = 1;
+
+#define NEO_SPRITE_PAGE_TOUCH(nTile)										\
+	if (NeoSpritePageActive)												\
+		NeoSpritePageActive[(nTile) >> NEO_SPRITE_PAGE_TILES] = nNeoSpritePageClock;
+
+// Per thread, the render pipeline thread draws slices while the emulation thread sets up the next
+BURN_THREAD_LOCAL INT32 nSliceStart, nSliceEnd, nSliceSize;
+
+#define NEO_BAND_MIN_LINES		(32)					// Smaller slices are not worth splitting
+
+// Lines a band of the screen draws, handed to the tile rendering functions so
+// bands can be drawn in parallel without going through thread local state
+struct NeoSpriteBand {
+	INT32 nSliceStart, nSliceEnd;		// The whole slice, strips are walked over all of it
+	INT32 nBandStart, nBandEnd;			// The lines of it this band draws
+};
 
 static INT32 nNeoSpriteFrame04, nNeoSpriteFrame08;
 
 static INT32 nLastBPP = -1;
 
-typedef void (*RenderBankFunction)();
+struct NeoSpriteStrip;
 
-static 	UINT16 BankAttrib01, BankAttrib02, BankAttrib03;
+typedef void (*RenderBankFunction)(const struct NeoSpriteStrip* pStrip, const struct NeoSpriteBand* pBand);
 
+// Display list of the sprite strips that end up on screen, rebuilt when the
+// sprite control blocks (SCB2-4) are written to
+struct NeoSpriteStrip {
+	UINT16* pBank;
+	INT32 nXPos, nYPos;
+	INT32 nXZoom, nYZoom;
+	INT32 nSize;
+	INT32 nLines;						// Scanlines covered from nYPos on (wraps at 512)
+	RenderBankFunction pRender;
+};
 
-// Include the tile rendering functions
-#include "neo_sprite_func.h"
+static struct NeoSpriteStrip NeoSpriteList[0x17D];
+static struct NeoSpriteStrip NeoSpriteChainEnd;	// Chaining state left by the last SCB walk
+static INT32 nNeoSpriteListSize;
+static INT32 nNeoSpriteListStart = -1;
+static UINT8* NeoSpriteListVRAM = NULL;				// Video RAM the list was built from
 
-INT32 NeoRenderSprites(void)
-{
-   if (!NeoSpriteROMActive || !(nBurnLayer & 1))
-      return 0;
+bool bNeoSpriteListDirty = true;
 
-#if 0
-   UINT16 BankAttrib01, BankAttrib02, BankAttrib03;
-#endif
+// Scanline renderer: sprites are drawn into a line buffer of palette indices
+// (like the LSPC does) which is converted to RGB once the line is complete.
+// Strips are drawn front to back: a coverage bitmask of the line lets strips
+// whose pixels are all hidden be skipped without fetching their tiles, and the
+// line is done as soon as every visible pixel is covered. Pixels nothing
+// covers get the backdrop colour when the line is converted.
+bool bNeoLineRenderer = false;
 
-   nNeoSpriteFrame04 = nNeoSpriteFrame & 3;
-   nNeoSpriteFrame08 = nNeoSpriteFrame & 7;
+#define NEO_LINEBUFFER_BORDER	(16)						// Strips can start up to 15 pixels off screen
+#define NEO_LINEBUFFER_SIZE		(NEO_LINEBUFFER_BORDER + 320 + NEO_LINEBUFFER_BORDER)
+#define NEO_LINECOVERAGE_SIZE	((NEO_LINEBUFFER_SIZE + 31) / 32 + 1)
 
-   // ssrpg hack! - NeoCD/SDL
-   INT32 nStart = 0;
-   if (SekReadWord(0x108) == 0x0085)
-   {
-      UINT16 *vidram = (UINT16*)NeoGraphicsRAM;
 
-      if ((vidram[0x8202] & 0x40) == 0 && (vidram[0x8203] & 0x40) != 0)
-      {
-         nStart = 3;
+// Vectorised line plotting used by the tile rendering functions
+#include "neo_sprite_simd.h"
 
-         while ((vidram[0x8200 + nStart] & 0x40) != 0) nStart++;
+// Include the tile rendering functions
+#include "neo_sprite_func.h"
 
-         if (nStart == 3) nStart = 0;
-      }
-   }
+static void NeoBuildSpriteList(INT32 nStart)
+{
+   struct NeoSpriteStrip* pStrip = NeoSpriteList;
+
+   // A sticky first strip chains on to whatever the previous walk ended with
+   INT32 nBankXPos  = NeoSpriteChainEnd.nXPos;
+   INT32 nBankYPos  = NeoSpriteChainEnd.nYPos;
+   INT32 nBankXZoom = NeoSpriteChainEnd.nXZoom;
+   INT32 nBankYZoom = NeoSpriteChainEnd.nYZoom;
+   INT32 nBankSize  = NeoSpriteChainEnd.nSize;
 
    for (INT32 nBank = 0; nBank < 0x17D; nBank++) {
       INT32 zBank = (nBank + nStart) % 0x17d;
-      BankAttrib01 = *((UINT16*)(NeoGraphicsRAM + 0x010000 + (zBank << 1)));
-      BankAttrib02 = *((UINT16*)(NeoGraphicsRAM + 0x010400 + (zBank << 1)));
-      BankAttrib03 = *((UINT16*)(NeoGraphicsRAM + 0x010800 + (zBank << 1)));
+      UINT16 BankAttrib01 = *((UINT16*)(NeoRenderVRAM + 0x010000 + (zBank << 1)));
+      UINT16 BankAttrib02 = *((UINT16*)(NeoRenderVRAM + 0x010400 + (zBank << 1)));
+      UINT16 BankAttrib03 = *((UINT16*)(NeoRenderVRAM + 0x010800 + (zBank << 1)));
 
-      pBank = (UINT16*)(NeoGraphicsRAM + (zBank << 7));
+      UINT16* pBank = (UINT16*)(NeoRenderVRAM + (zBank << 7));
 
       if (BankAttrib02 & 0x40)
          nBankXPos += nBankXZoom + 1;
@@ -97,40 +141,437 @@ INT32 NeoRenderSprites(void)
          }
 
          if (nBankXPos >= 0 && nBankXPos < (nNeoScreenWidth - nBankXZoom - 1)) {
-            RenderBankFunctionTable[nBankXZoom]();
+            pStrip->pRender = RenderBankFunctionTable[nBankXZoom];
          } else {
             if (nBankXPos >= -nBankXZoom && nBankXPos < nNeoScreenWidth) {
-               RenderBankFunctionTable[nBankXZoom + 16]();
+               pStrip->pRender = RenderBankFunctionTable[nBankXZoom + 16];
+            } else {
+               continue;
             }
          }
+
+         pStrip->pBank  = pBank;
+         pStrip->nXPos  = nBankXPos;
+         pStrip->nYPos  = nBankYPos;
+         pStrip->nXZoom = nBankXZoom;
+         pStrip->nYZoom = nBankYZoom;
+         pStrip->nSize  = nBankSize;
+         pStrip->nLines = (nBankSize >= 0x20) ? 0x0200 : (nBankSize << 4);
+         pStrip++;
       }
    }
 
-   //	bprintf(PRINT_NORMAL, _T("\n"));
+   NeoSpriteChainEnd.nXPos  = nBankXPos;
+   NeoSpriteChainEnd.nYPos  = nBankYPos;
+   NeoSpriteChainEnd.nXZoom = nBankXZoom;
+   NeoSpriteChainEnd.nYZoom = nBankYZoom;
+   NeoSpriteChainEnd.nSize  = nBankSize;
 
-   return 0;
+   nNeoSpriteListSize  = pStrip - NeoSpriteList;
+   nNeoSpriteListStart = nStart;
+   NeoSpriteListVRAM   = NeoRenderVRAM;
+
+   // Only the live video RAM is tracked by the dirty flag
+   if (NeoRenderVRAM == NeoGraphicsRAM)
+      bNeoSpriteListDirty = false;
 }
 
-void NeoUpdateSprites(INT32 nOffset, INT32 nSize)
+// Work out which tile of a strip and which line of the zoom table are used for
+// the scanline nLinesWanted lines below the top of the strip. The tile renderer
+// walks a strip in segments and continues each one linearly, so the segments
+// are walked the same way here (for a full 0x10 - 0xF0 frame) to match it.
+static bool NeoStripLine(struct NeoSpriteStrip* pStrip, INT32 nLinesWanted, INT32* pnTile, INT32* pnZoomLine)
 {
-   int32_t i, j;
+   INT32 nYZoom = pStrip->nYZoom;
+   INT32 nLinesTotal = pStrip->nLines - 1;
+   INT32 nLinesDone = 0;
 
-   for (i = nOffset & ~127; i < nOffset + nSize; i += 128)
+   while (nLinesDone <= nLinesWanted)
    {
-      bool bTransparent = true;
-      for (j = i; j < i + 128; j++)
-      {
-         if (NeoSpriteROMActive[j])
-         {
-            bTransparent = false;
-            break;
+      INT32 nYPos = (pStrip->nYPos + nLinesDone) & 0x01FF;
+
+      if (nYPos < 0x10) {
+         nLinesDone += 0x10 - nYPos;
+         continue;
+      }
+      if (nYPos >= 0xF0) {
+         nLinesDone += 0x10 + 512 - nYPos;
+         continue;
+      }
+
+      INT32 nStartTile = (nLinesDone >= 0x0100) ? 0x10 : 0;
+      INT32 nStartLine = nLinesDone & 0xFF;
+      INT32 nEndLine   = (nLinesDone < 0x0100 && nLinesTotal >= 0x0100) ? 0xFF : nLinesTotal & 0xFF;
+
+      // Handle wraparound for full-size sprite strips
+      if (pStrip->nSize > 0x10 && nYZoom != 0xFF) {
+         if (pStrip->nSize <= 0x20) {
+
+            // normal wrap
+
+            if (nLinesDone >= 0x0100) {
+               if (nLinesDone < (0x01FF - nYZoom)) {
+                  nLinesDone = (0x01FF - nYZoom);
+                  continue;
+               }
+
+               nStartLine -= 0xFF - nYZoom;
+               nEndLine -= 0xFF - nYZoom;
+            }
+         } else {
+
+            // Full strip, full wrap
+
+            if (nLinesDone >= 0x0100) {
+               nStartLine -= 0xFF - nYZoom;
+               if (nStartLine < 0) {
+#if 1 && defined USE_SPEEDHACKS
+                  nStartLine += nYZoom + 1;
+                  if (nStartLine < 0) {
+                     nLinesDone = 0x200;
+                     continue;
+                  }
+#else
+                  nStartLine = nYZoom - (-nStartLine - 1) % (nYZoom + 1);
+#endif
+                  nStartTile = 0;
+               }
+            } else {
+               if (nStartLine > nYZoom) {
+#if 1 && defined USE_SPEEDHACKS
+                  nStartLine -= nYZoom + 1;
+                  if (nStartLine > nYZoom) {
+                     nLinesDone = 0x0100;
+                     continue;
+                  }
+#else
+                  nStartLine %= nYZoom + 1;
+#endif
+                  nStartTile = 0x10;
+               }
+            }
+
+            nEndLine = nYZoom;
          }
       }
-      if (bTransparent)
-         NeoTileAttribActive[i >> 7] = 1;
+
+      if (nLinesWanted <= nLinesDone + nEndLine - nStartLine) {
+         nStartLine += nLinesWanted - nLinesDone;
+
+#if 1 && defined USE_SPEEDHACKS
+         if (pStrip->nSize <= 0x20 && nStartLine > nYZoom)
+            return false;
+#endif
+
+         *pnTile = nStartTile;
+         *pnZoomLine = nStartLine;
+
+         return true;
+      }
+
+      nLinesDone += nEndLine - nStartLine + 1;
+   }
+
+   return false;
+}
+
+// Coverage bits for the nWidth line buffer pixels from nPos on
+static inline UINT32 NeoLineCovered(const UINT32* pCoverage, INT32 nPos, INT32 nWidth)
+{
+   UINT64 nBits = ((UINT64)pCoverage[(nPos >> 5) + 1] << 32) | pCoverage[nPos >> 5];
+
+   return (UINT32)(nBits >> (nPos & 31)) & ((1 << nWidth) - 1);
+}
+
+static void NeoRenderSpriteLine(INT32 nLine)
+{
+   UINT16 NeoLineBuffer[NEO_LINEBUFFER_SIZE];
+   UINT32 NeoLineCoverage[NEO_LINECOVERAGE_SIZE];
+   UINT16* pLine = NeoLineBuffer + NEO_LINEBUFFER_BORDER;
+   UINT16* pDest = (UINT16*)(pNeoRenderDraw + (nLine - 0x10) * 2 * nNeoScreenWidth);
+   UINT16 nBackdrop = NeoRenderPalette[0x0FFF];
+   INT32 nUncovered = nNeoScreenWidth;						// Visible pixels still showing the backdrop
+
+   memset(NeoLineBuffer, 0, sizeof(NeoLineBuffer));
+   memset(NeoLineCoverage, 0, sizeof(NeoLineCoverage));
+
+   // Later strips have priority, so walk the list backwards
+   for (INT32 i = nNeoSpriteListSize - 1; i >= 0 && nUncovered; i--) {
+      struct NeoSpriteStrip* pStrip = &NeoSpriteList[i];
+      INT32 nLinesDone = (nLine - pStrip->nYPos) & 0x01FF;
+      INT32 nPos = NEO_LINEBUFFER_BORDER + pStrip->nXPos;
+      INT32 nTile, nZoomLine, nTileNumber, nTileAttrib, nRow;
+      UINT32 nRowAttrib;
+      const UINT32* pRow;
+      const UINT8* pColumn;
+      UINT16 nPalette;
+
+      if (nLinesDone >= pStrip->nLines)
+         continue;
+
+      // Everything this strip could draw is hidden already
+      if (NeoLineCovered(NeoLineCoverage, nPos, pStrip->nXZoom + 1) == (1u << (pStrip->nXZoom + 1)) - 1)
+         continue;
+
+      if (!NeoStripLine(pStrip, nLinesDone, &nTile, &nZoomLine))
+         continue;
+
+      nZoomLine = NeoZoomROM[(pStrip->nYZoom << 8) + nZoomLine];
+      nTile += nZoomLine >> 4;
+
+      nTileNumber = pStrip->pBank[nTile << 1];
+      nTileAttrib = pStrip->pBank[(nTile << 1) + 1];
+
+      nTileNumber += (nTileAttrib & 0xF0) << 12;
+      nTileNumber &= nNeoTileMaskActive;
+
+      if (nTileAttrib & 8) {
+         nTileNumber &= ~7;
+         nTileNumber |= nNeoSpriteFrame08;
+      } else {
+         if (nTileAttrib & 4) {
+            nTileNumber &= ~3;
+            nTileNumber |= nNeoSpriteFrame04;
+         }
+      }
+
+      nRow = nZoomLine & 0x0F;
+      if (nTileAttrib & 2)	// Flip Y
+         nRow ^= 0x0F;
+
+      nRowAttrib = NeoTileAttribActive[nTileNumber];
+      if (((nRowAttrib >> (nRow << 1)) & 3) == NEO_TILEROW_TRANSPARENT)
+         continue;
+
+#ifdef GEKKO
+      if (BurnUseCache)
+         pRow = (nTileNumber < 0x40000) ? (UINT32*)&NeoSpriteROM[nNeoActiveSlot][nTileNumber << 7] : (UINT32*)&NeoSpriteROM_WIIVM[nNeoActiveSlot][(nTileNumber - 0x40000) << 7];
       else
-         NeoTileAttribActive[i >> 7] = 0;
+#endif
+      pRow = (UINT32*)(NeoSpriteROMActive + (nTileNumber << 7));
+      pRow += nRow << 1;
+      NEO_SPRITE_PAGE_TOUCH(nTileNumber);
+
+      // Write palette index | colour for the opaque pixels nothing in front covers
+      pColumn = NeoZoomColumn[pStrip->nXZoom][nTileAttrib & 1];
+      nPalette = (nTileAttrib & 0xFF00) >> 4;
+      for (INT32 x = 0; x <= pStrip->nXZoom; x++, nPos++) {
+         INT32 nPixel = pColumn[x];
+         INT32 nColour = (pRow[nPixel >> 3] >> ((nPixel & 7) << 2)) & 0x0F;
+         if (nColour && (NeoLineCoverage[nPos >> 5] & (1 << (nPos & 31))) == 0) {
+            NeoLineCoverage[nPos >> 5] |= 1 << (nPos & 31);
+            NeoLineBuffer[nPos] = nPalette | nColour;
+            if (nPos >= NEO_LINEBUFFER_BORDER && nPos < NEO_LINEBUFFER_BORDER + nNeoScreenWidth)
+               nUncovered--;
+         }
+      }
    }
+
+   for (INT32 x = 0; x < nNeoScreenWidth; x++)
+      pDest[x] = pLine[x] ? NeoRenderPalette[pLine[x]] : nBackdrop;
+}
+
+static void NeoDrawSpriteList(const struct NeoSpriteBand* pBand)
+{
+   if (bNeoLineRenderer) {
+      for (INT32 nLine = pBand->nBandStart; nLine < pBand->nBandEnd; nLine++)
+         NeoRenderSpriteLine(nLine);
+
+      return;
+   }
+
+   for (INT32 i = 0; i < nNeoSpriteListSize; i++) {
+      struct NeoSpriteStrip* pStrip = &NeoSpriteList[i];
+
+      // Only draw strips that cover part of the band
+      if (((pBand->nBandStart - pStrip->nYPos) & 0x01FF) >= pStrip->nLines && ((pStrip->nYPos - pBand->nBandStart) & 0x01FF) >= pBand->nBandEnd - pBand->nBandStart)
+         continue;
+
+      pStrip->pRender(pStrip, pBand);
+   }
+}
+
+// Each band walks the strips over the whole slice, so the wraparound segments
+// are the same as when the slice is drawn in one go, and only clips the output.
+static void NeoRenderSpriteBand(void* pParam, INT32 nBand)
+{
+   INT32* pSlice = (INT32*)pParam;					// Slice start, end and number of bands
+   INT32 nSize = pSlice[1] - pSlice[0];
+   struct NeoSpriteBand Band;
+
+   Band.nSliceStart = pSlice[0];
+   Band.nSliceEnd   = pSlice[1];
+   Band.nBandStart  = pSlice[0] + nSize * nBand / pSlice[2];
+   Band.nBandEnd    = pSlice[0] + nSize * (nBand + 1) / pSlice[2];
+
+   NeoDrawSpriteList(&Band);
+}
+
+// First sprite control block to draw, read from the live machine state
+INT32 NeoSpriteStart(void)
+{
+   // ssrpg hack! - NeoCD/SDL
+   INT32 nStart = 0;
+   if (SekReadWord(0x108) == 0x0085)
+   {
+      UINT16 *vidram = (UINT16*)NeoGraphicsRAM;
+
+      if ((vidram[0x8202] & 0x40) == 0 && (vidram[0x8203] & 0x40) != 0)
+      {
+         nStart = 3;
+
+         while ((vidram[0x8200 + nStart] & 0x40) != 0) nStart++;
+
+         if (nStart == 3) nStart = 0;
+      }
+   }
+
+   return nStart;
+}
+
+INT32 NeoRenderSprites(void)
+{
+   INT32 nBands;
+
+   if (!NeoSpriteROMActive || !(nBurnLayer & 1))
+      return 0;
+
+   nNeoSpriteFrame04 = nNeoRenderSpriteFrame & 3;
+   nNeoSpriteFrame08 = nNeoRenderSpriteFrame & 7;
+
+   // Snapshots from the render pipeline always get a fresh list
+   if (bNeoSpriteListDirty || nNeoRenderSpriteStart != nNeoSpriteListStart || NeoRenderVRAM != NeoGraphicsRAM || NeoSpriteListVRAM != NeoRenderVRAM)
+      NeoBuildSpriteList(nNeoRenderSpriteStart);
+
+   nBands = BurnThreadCount();
+   if (nBands > (nSliceEnd - nSliceStart) / NEO_BAND_MIN_LINES)
+      nBands = (nSliceEnd - nSliceStart) / NEO_BAND_MIN_LINES;
+
+   if (nBands > 1) {
+      INT32 nSlice[3] = { nSliceStart, nSliceEnd, nBands };
+
+      BurnThreadRun(NeoRenderSpriteBand, nSlice, nBands);
+   } else {
+      struct NeoSpriteBand Band = { nSliceStart, nSliceEnd, nSliceStart, nSliceEnd };
+
+      NeoDrawSpriteList(&Band);
+   }
+
+   return 0;
+}
+
+// Spread bit n of a 16-bit mask to bit 2n
+static inline UINT32 NeoTileAttribSpread(UINT32 n)
+{
+	n = (n | (n << 8)) & 0x00FF00FF;
+	n = (n | (n << 4)) & 0x0F0F0F0F;
+	n = (n | (n << 2)) & 0x33333333;
+	n = (n | (n << 1)) & 0x55555555;
+
+	return n;
+}
+
+// Every pixel (nibble) of a row is collapsed to its lowest bit, the row is
+// transparent if none are set and opaque if all are. Each row is a 64-bit
+// value, the SIMD versions do two rows at a time.
+UINT32 NeoCalcTileAttrib(const UINT8* pTile)
+{
+	UINT32 nUsed = 0, nOpaque = 0;
+
+#if defined NEO_SPRITE_SIMD_SSSE3 || defined NEO_SPRITE_SIMD_SSE2
+	const __m128i nMask = _mm_set1_epi8(0x11);
+
+	for (INT32 i = 0; i < 8; i++) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(pTile + (i << 4)));
+		INT32 nFull, nEmpty;
+
+		x = _mm_or_si128(x, _mm_srli_epi64(x, 2));
+		x = _mm_and_si128(_mm_or_si128(x, _mm_srli_epi64(x, 1)), nMask);
+
+		nFull  = _mm_movemask_epi8(_mm_cmpeq_epi8(x, nMask));
+		nEmpty = _mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_setzero_si128()));
+
+		nOpaque |= (((nFull  & 0x00FF) == 0x00FF) | (((nFull  & 0xFF00) == 0xFF00) << 1)) << (i << 1);
+		nUsed   |= (((nEmpty & 0x00FF) != 0x00FF) | (((nEmpty & 0xFF00) != 0xFF00) << 1)) << (i << 1);
+	}
+#elif defined NEO_SPRITE_SIMD_NEON
+	for (INT32 i = 0; i < 8; i++) {
+		uint64x2_t x = vreinterpretq_u64_u8(vld1q_u8(pTile + (i << 4)));
+		UINT64 a, b;
+
+		x = vorrq_u64(x, vshrq_n_u64(x, 2));
+		x = vandq_u64(vorrq_u64(x, vshrq_n_u64(x, 1)), vdupq_n_u64(0x1111111111111111ULL));
+
+		a = vgetq_lane_u64(x, 0);
+		b = vgetq_lane_u64(x, 1);
+
+		nOpaque |= ((a == 0x1111111111111111ULL) | ((b == 0x1111111111111111ULL) << 1)) << (i << 1);
+		nUsed   |= ((a != 0) | ((b != 0) << 1)) << (i << 1);
+	}
+#else
+	for (INT32 nRow = 0; nRow < 16; nRow++, pTile += 8) {
+		UINT64 x = ((UINT32*)pTile)[0] | ((UINT64)((UINT32*)pTile)[1] << 32);
+
+		x |= x >> 2;
+		x |= x >> 1;
+		x &= 0x1111111111111111ULL;
+
+		nOpaque |= (x == 0x1111111111111111ULL) << nRow;
+		nUsed   |= (x != 0) << nRow;
+	}
+#endif
+
+	return NeoTileAttribSpread(nOpaque) * NEO_TILEROW_OPAQUE | NeoTileAttribSpread(nUsed & ~nOpaque) * NEO_TILEROW_MIXED;
+}
+
+void NeoUpdateSprites(INT32 nOffset, INT32 nSize)
+{
+   int32_t i;
+
+   for (i = nOffset & ~127; i < nOffset + nSize; i += 128)
+      NeoTileAttribActive[i >> 7] = NeoCalcTileAttrib(NeoSpriteROMActive + i);
+
+   nNeoGraphicsGeneration++;
+}
+
+// Drop the least recently used sprite ROM pages until the budget is met,
+// called once per frame. Pages used in the current frame are kept.
+void NeoSpritePageTrim()
+{
+	INT32 nAgeCount[256];
+	INT32 nResident = 0, nDrop, nOldest;
+
+	if (NeoSpritePageActive == NULL)
+		return;
+
+	memset(nAgeCount, 0, sizeof(nAgeCount));
+	for (INT32 i = 0; i < nNeoSpritePagesActive; i++) {
+		if (NeoSpritePageActive[i]) {
+			UINT32 nAge = nNeoSpritePageClock - NeoSpritePageActive[i];
+			nAgeCount[nAge > 255 ? 255 : nAge]++;
+			nResident++;
+		}
+	}
+
+	nDrop = nResident - (nNeoSpriteROMBudget << (20 - NEO_SPRITE_PAGE_SHIFT));
+	if (nDrop > 0) {
+		// Find the age from which on everything goes
+		INT32 nCount = 0;
+		for (nOldest = 255; nOldest > 1 && nCount + nAgeCount[nOldest] < nDrop; nOldest--)
+			nCount += nAgeCount[nOldest];
+
+		for (INT32 i = 0; i < nNeoSpritePagesActive && nDrop > 0; i++) {
+			UINT32 nAge = nNeoSpritePageClock - NeoSpritePageActive[i];
+			if (NeoSpritePageActive[i] && nAge >= (UINT32)nOldest) {
+				NeoCacheDiscard(NeoSpriteROMActive + (i << NEO_SPRITE_PAGE_SHIFT), 1 << NEO_SPRITE_PAGE_SHIFT);
+				NeoSpritePageActive[i] = 0;
+				nDrop--;
+			}
+		}
+	}
+
+	if (++nNeoSpritePageClock == 0)
+		nNeoSpritePageClock = 1;
 }
 
 void NeoSetSpriteSlot(INT32 nSlot)
@@ -139,50 +580,84 @@ void NeoSetSpriteSlot(INT32 nSlot)
 	NeoSpriteROMActive  = NeoSpriteROM[nSlot];
 	nNeoTileMaskActive  = nNeoTileMask[nSlot];
 	nNeoMaxTileActive   = nNeoMaxTile[nSlot];
+	NeoSpritePageActive = NeoSpritePage[nSlot];
+	nNeoSpritePagesActive = nNeoSpritePages[nSlot];
+
+	nNeoGraphicsGeneration++;
+}
+
+// Create the table that indicates which rows of a tile are transparent / opaque,
+// LoadRoms hands it to NeoDecodeSprites to fill in while decoding
+UINT32* NeoAllocTileAttrib(INT32 nSlot)
+{
+	BurnFree(NeoTileAttrib[nSlot]);
+	NeoTileAttrib[nSlot] = (UINT32*)BurnMalloc((nNeoTileMask[nSlot] + 1) * sizeof(UINT32));
+
+	return NeoTileAttrib[nSlot];
 }
 
 INT32 NeoInitSprites(INT32 nSlot)
 {
-	// Create a table that indicates if a tile is transparent
-	NeoTileAttrib[nSlot] = (UINT8*)BurnMalloc(nNeoTileMask[nSlot] + 1);
+	bool bScan = NeoTileAttrib[nSlot] == NULL;
+	UINT64 nProfile = BurnProfileStart();
+
+	bNeoSpriteListDirty = true;
+
+	if (bScan)
+		NeoAllocTileAttrib(nSlot);
 #ifdef GEKKO
 	if(BurnUseCache)
 	{
 		char CacheFile[1024];
 		FILE *BurnCacheFile;
+		UINT8* pCacheInfo = (UINT8*)BurnMalloc(nNeoTileMask[nSlot] + 1);
 
-		// Read tile table cache
+		// Read tile table cache (transparent flag only, so treat all rows of visible tiles as mixed)
 		sprintf(CacheFile ,"%scache_info", CacheDir);
 		BurnCacheFile = fopen(CacheFile, "rb");
-		fread( NeoTileAttrib[nSlot], nNeoTileMask[nSlot] + 1, 1, BurnCacheFile);
+		fread(pCacheInfo, nNeoTileMask[nSlot] + 1, 1, BurnCacheFile);
 		fclose(BurnCacheFile);
+
+		for (UINT32 i = 0; i < nNeoTileMask[nSlot] + 1; i++)
+			NeoTileAttrib[nSlot][i] = pCacheInfo[i] ? 0 : 0xAAAAAAAA;
+
+		BurnFree(pCacheInfo);
 	}
 	else
 #endif
-	for (INT32 i = 0; i < nNeoMaxTile[nSlot]; i++)
-   {
-		bool bTransparent = true;
-		for (INT32 j = i << 7; j < (i + 1) << 7; j++)
-      {
-			if (NeoSpriteROM[nSlot][j])
-         {
-				bTransparent = false;
-				break;
-			}
+	{
+		// Page the sprite ROM if it comes from the ROM cache and the system can drop its pages
+		nNeoSpritePages[nSlot] = 0;
+		if (nNeoSpriteROMBudget > 0 && NeoCacheMapped(nSlot, NeoSpriteROM[nSlot]) && NeoCacheDiscard(NeoSpriteROM[nSlot], 1 << NEO_SPRITE_PAGE_SHIFT) == 0) {
+			nNeoSpritePages[nSlot] = (nNeoMaxTile[nSlot] + (1 << NEO_SPRITE_PAGE_TILES) - 1) >> NEO_SPRITE_PAGE_TILES;
+			NeoSpritePage[nSlot] = (UINT32*)BurnMalloc(nNeoSpritePages[nSlot] * sizeof(UINT32));
+			if (NeoSpritePage[nSlot] == NULL)
+				nNeoSpritePages[nSlot] = 0;
+		}
+
+		for (INT32 i = 0; i < nNeoMaxTile[nSlot] && bScan; i++) {
+			NeoTileAttrib[nSlot][i] = NeoCalcTileAttrib(NeoSpriteROM[nSlot] + (i << 7));
+
+			// Don't keep the whole ROM resident just for this
+			if (nNeoSpritePages[nSlot] && (((i + 1) & ((1 << NEO_SPRITE_PAGE_TILES) - 1)) == 0 || i + 1 == nNeoMaxTile[nSlot]))
+				NeoCacheDiscard(NeoSpriteROM[nSlot] + ((i >> NEO_SPRITE_PAGE_TILES) << NEO_SPRITE_PAGE_SHIFT), 1 << NEO_SPRITE_PAGE_SHIFT);
 		}
-		if (bTransparent)
-			NeoTileAttrib[nSlot][i] = 1;
-      else
-			NeoTileAttrib[nSlot][i] = 0;
 	}
 
-	for (UINT32 i = nNeoMaxTile[nSlot]; i < nNeoTileMask[nSlot] + 1; i++)
-		NeoTileAttrib[nSlot][i] = 1;
+	// A table from the ROM cache already has these cleared, don't dirty its pages
+	if (!NeoCacheMapped(nSlot, (UINT8*)NeoTileAttrib[nSlot])) {
+		for (UINT32 i = nNeoMaxTile[nSlot]; i < nNeoTileMask[nSlot] + 1; i++)
+			NeoTileAttrib[nSlot][i] = 0;
+	}
 
 	NeoTileAttribActive = NeoTileAttrib[nSlot];
 	NeoSpriteROMActive  = NeoSpriteROM[nSlot];
 	nNeoTileMaskActive  = nNeoTileMask[nSlot];
 	nNeoMaxTileActive   = nNeoMaxTile[nSlot];
+	NeoSpritePageActive = NeoSpritePage[nSlot];
+	nNeoSpritePagesActive = nNeoSpritePages[nSlot];
+
+	BurnProfileStop("NeoInitSprites", nProfile, bScan ? (UINT64)nNeoMaxTile[nSlot] << 7 : 0);
 
 	return 0;
 }
@@ -191,4 +666,9 @@ void NeoExitSprites(INT32 nSlot)
 {
 	BurnFree(NeoTileAttrib[nSlot]);
 	NeoTileAttribActive = NULL;
+
+	BurnFree(NeoSpritePage[nSlot]);
+	nNeoSpritePages[nSlot] = 0;
+	NeoSpritePageActive = NULL;
+	nNeoSpritePagesActive = 0;
 }
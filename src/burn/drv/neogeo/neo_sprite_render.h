@@ -20,437 +20,438 @@
 #endif
 
 #define PLOTPIXEL(a,b) if (TESTCOLOUR(b) && TESTCLIP(a)) *((UINT16*)pPixel) = (UINT16)pTilePalette[b];
+#define PLOTPIXEL_OPAQUE(a,b) if (TESTCLIP(a)) *((UINT16*)pPixel) = (UINT16)pTilePalette[b];
 
 #if XZOOM == 0
- #define PLOTLINE(OFFSET,ADVANCECOLUMN)		\
+ #define PLOTLINE(OFFSET,ADVANCECOLUMN,PLOT)		\
 	nColour = pTileData[nLine + 1];			\
-	PLOTPIXEL(OFFSET( 0),nColour & 0x0F);
+	PLOT(OFFSET( 0),nColour & 0x0F);
 #elif XZOOM == 1
- #define PLOTLINE(OFFSET,ADVANCECOLUMN)		\
+ #define PLOTLINE(OFFSET,ADVANCECOLUMN,PLOT)		\
 	nColour = pTileData[nLine];				\
 	nColour >>= 16;							\
-	PLOTPIXEL(OFFSET( 0),nColour & 0x0F);	\
+	PLOT(OFFSET( 0),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour = pTileData[nLine + 1];			\
-	PLOTPIXEL(OFFSET( 1),nColour & 0x0F);
+	PLOT(OFFSET( 1),nColour & 0x0F);
 #elif XZOOM == 2
- #define PLOTLINE(OFFSET,ADVANCECOLUMN)		\
+ #define PLOTLINE(OFFSET,ADVANCECOLUMN,PLOT)		\
 	nColour = pTileData[nLine];				\
 	nColour >>= 16;							\
-	PLOTPIXEL(OFFSET( 0),nColour & 0x0F);	\
+	PLOT(OFFSET( 0),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour = pTileData[nLine + 1];			\
-	PLOTPIXEL(OFFSET( 1),nColour & 0x0F);	\
+	PLOT(OFFSET( 1),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 16;							\
-	PLOTPIXEL(OFFSET( 2),nColour & 0x0F);
+	PLOT(OFFSET( 2),nColour & 0x0F);
 #elif XZOOM == 3
- #define PLOTLINE(OFFSET,ADVANCECOLUMN)		\
+ #define PLOTLINE(OFFSET,ADVANCECOLUMN,PLOT)		\
 	nColour = pTileData[nLine];				\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 0),nColour & 0x0F);	\
+	PLOT(OFFSET( 0),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 1),nColour & 0x0F);	\
+	PLOT(OFFSET( 1),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour = pTileData[nLine + 1];			\
-	PLOTPIXEL(OFFSET( 2),nColour & 0x0F);	\
+	PLOT(OFFSET( 2),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 16;							\
-	PLOTPIXEL(OFFSET( 3),nColour & 0x0F);
+	PLOT(OFFSET( 3),nColour & 0x0F);
 #elif XZOOM == 4
- #define PLOTLINE(OFFSET,ADVANCECOLUMN)		\
+ #define PLOTLINE(OFFSET,ADVANCECOLUMN,PLOT)		\
 	nColour = pTileData[nLine];				\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 0),nColour & 0x0F);	\
+	PLOT(OFFSET( 0),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 1),nColour & 0x0F);	\
+	PLOT(OFFSET( 1),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour = pTileData[nLine + 1];			\
-	PLOTPIXEL(OFFSET( 2),nColour & 0x0F);	\
+	PLOT(OFFSET( 2),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 16;							\
-	PLOTPIXEL(OFFSET( 3),nColour & 0x0F);	\
+	PLOT(OFFSET( 3),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 4),nColour & 0x0F);
+	PLOT(OFFSET( 4),nColour & 0x0F);
 #elif XZOOM == 5
- #define PLOTLINE(OFFSET,ADVANCECOLUMN)		\
+ #define PLOTLINE(OFFSET,ADVANCECOLUMN,PLOT)		\
 	nColour = pTileData[nLine];				\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 0),nColour & 0x0F);	\
+	PLOT(OFFSET( 0),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 1),nColour & 0x0F);	\
+	PLOT(OFFSET( 1),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 2),nColour & 0x0F);	\
+	PLOT(OFFSET( 2),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour = pTileData[nLine + 1];			\
-	PLOTPIXEL(OFFSET( 3),nColour & 0x0F);	\
+	PLOT(OFFSET( 3),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 16;							\
-	PLOTPIXEL(OFFSET( 4),nColour & 0x0F);	\
+	PLOT(OFFSET( 4),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 5),nColour & 0x0F);
+	PLOT(OFFSET( 5),nColour & 0x0F);
 #elif XZOOM == 6
- #define PLOTLINE(OFFSET,ADVANCECOLUMN)		\
+ #define PLOTLINE(OFFSET,ADVANCECOLUMN,PLOT)		\
 	nColour = pTileData[nLine];				\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 0),nColour & 0x0F);	\
+	PLOT(OFFSET( 0),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 1),nColour & 0x0F);	\
+	PLOT(OFFSET( 1),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 2),nColour & 0x0F);	\
+	PLOT(OFFSET( 2),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour = pTileData[nLine + 1];			\
-	PLOTPIXEL(OFFSET( 3),nColour & 0x0F);	\
+	PLOT(OFFSET( 3),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 4),nColour & 0x0F);	\
+	PLOT(OFFSET( 4),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 5),nColour & 0x0F);	\
+	PLOT(OFFSET( 5),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 6),nColour & 0x0F);
+	PLOT(OFFSET( 6),nColour & 0x0F);
 #elif XZOOM == 7
- #define PLOTLINE(OFFSET,ADVANCECOLUMN)		\
+ #define PLOTLINE(OFFSET,ADVANCECOLUMN,PLOT)		\
 	nColour = pTileData[nLine];				\
-	PLOTPIXEL(OFFSET( 0),nColour & 0x0F);	\
+	PLOT(OFFSET( 0),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 1),nColour & 0x0F);	\
+	PLOT(OFFSET( 1),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 2),nColour & 0x0F);	\
+	PLOT(OFFSET( 2),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 3),nColour & 0x0F);	\
+	PLOT(OFFSET( 3),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour = pTileData[nLine + 1];			\
-	PLOTPIXEL(OFFSET( 4),nColour & 0x0F);	\
+	PLOT(OFFSET( 4),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 5),nColour & 0x0F);	\
+	PLOT(OFFSET( 5),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 6),nColour & 0x0F);	\
+	PLOT(OFFSET( 6),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 7),nColour & 0x0F);
+	PLOT(OFFSET( 7),nColour & 0x0F);
 #elif XZOOM == 8
- #define PLOTLINE(OFFSET,ADVANCECOLUMN)		\
+ #define PLOTLINE(OFFSET,ADVANCECOLUMN,PLOT)		\
 	nColour = pTileData[nLine];				\
-	PLOTPIXEL(OFFSET( 0),nColour & 0x0F);	\
+	PLOT(OFFSET( 0),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 1),nColour & 0x0F);	\
+	PLOT(OFFSET( 1),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 2),nColour & 0x0F);	\
+	PLOT(OFFSET( 2),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 3),nColour & 0x0F);	\
+	PLOT(OFFSET( 3),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour = pTileData[nLine + 1];			\
-	PLOTPIXEL(OFFSET( 4),nColour & 0x0F);	\
+	PLOT(OFFSET( 4),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 5),nColour & 0x0F);	\
+	PLOT(OFFSET( 5),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 6),nColour & 0x0F);	\
+	PLOT(OFFSET( 6),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 7),nColour & 0x0F);	\
+	PLOT(OFFSET( 7),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 8),nColour & 0x0F);
+	PLOT(OFFSET( 8),nColour & 0x0F);
 #elif XZOOM == 9
- #define PLOTLINE(OFFSET,ADVANCECOLUMN)		\
+ #define PLOTLINE(OFFSET,ADVANCECOLUMN,PLOT)		\
 	nColour = pTileData[nLine];				\
-	PLOTPIXEL(OFFSET( 0),nColour & 0x0F);	\
+	PLOT(OFFSET( 0),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 1),nColour & 0x0F);	\
+	PLOT(OFFSET( 1),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 2),nColour & 0x0F);	\
+	PLOT(OFFSET( 2),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 3),nColour & 0x0F);	\
+	PLOT(OFFSET( 3),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 4),nColour & 0x0F);	\
+	PLOT(OFFSET( 4),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour = pTileData[nLine + 1];			\
-	PLOTPIXEL(OFFSET( 5),nColour & 0x0F);	\
+	PLOT(OFFSET( 5),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 6),nColour & 0x0F);	\
+	PLOT(OFFSET( 6),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 7),nColour & 0x0F);	\
+	PLOT(OFFSET( 7),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 8),nColour & 0x0F);	\
+	PLOT(OFFSET( 8),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 9),nColour & 0x0F);
+	PLOT(OFFSET( 9),nColour & 0x0F);
 #elif XZOOM == 10
- #define PLOTLINE(OFFSET,ADVANCECOLUMN)		\
+ #define PLOTLINE(OFFSET,ADVANCECOLUMN,PLOT)		\
 	nColour = pTileData[nLine];				\
-	PLOTPIXEL(OFFSET( 0),nColour & 0x0F);	\
+	PLOT(OFFSET( 0),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 1),nColour & 0x0F);	\
+	PLOT(OFFSET( 1),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 2),nColour & 0x0F);	\
+	PLOT(OFFSET( 2),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 3),nColour & 0x0F);	\
+	PLOT(OFFSET( 3),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 4),nColour & 0x0F);	\
+	PLOT(OFFSET( 4),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour = pTileData[nLine + 1];			\
-	PLOTPIXEL(OFFSET( 5),nColour & 0x0F);	\
+	PLOT(OFFSET( 5),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 6),nColour & 0x0F);	\
+	PLOT(OFFSET( 6),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 7),nColour & 0x0F);	\
+	PLOT(OFFSET( 7),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 8),nColour & 0x0F);	\
+	PLOT(OFFSET( 8),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 9),nColour & 0x0F);	\
+	PLOT(OFFSET( 9),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(10),nColour & 0x0F);
+	PLOT(OFFSET(10),nColour & 0x0F);
 #elif XZOOM == 11
- #define PLOTLINE(OFFSET,ADVANCECOLUMN)		\
+ #define PLOTLINE(OFFSET,ADVANCECOLUMN,PLOT)		\
 	nColour = pTileData[nLine];				\
-	PLOTPIXEL(OFFSET( 0),nColour & 0x0F);	\
+	PLOT(OFFSET( 0),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 1),nColour & 0x0F);	\
+	PLOT(OFFSET( 1),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 2),nColour & 0x0F);	\
+	PLOT(OFFSET( 2),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 3),nColour & 0x0F);	\
+	PLOT(OFFSET( 3),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 4),nColour & 0x0F);	\
+	PLOT(OFFSET( 4),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 5),nColour & 0x0F);	\
+	PLOT(OFFSET( 5),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour = pTileData[nLine + 1];			\
-	PLOTPIXEL(OFFSET( 6),nColour & 0x0F);	\
+	PLOT(OFFSET( 6),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 7),nColour & 0x0F);	\
+	PLOT(OFFSET( 7),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 8),nColour & 0x0F);	\
+	PLOT(OFFSET( 8),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 9),nColour & 0x0F);	\
+	PLOT(OFFSET( 9),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET(10),nColour & 0x0F);	\
+	PLOT(OFFSET(10),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(11),nColour & 0x0F);
+	PLOT(OFFSET(11),nColour & 0x0F);
 #elif XZOOM == 12
- #define PLOTLINE(OFFSET,ADVANCECOLUMN)		\
+ #define PLOTLINE(OFFSET,ADVANCECOLUMN,PLOT)		\
 	nColour = pTileData[nLine];				\
-	PLOTPIXEL(OFFSET( 0),nColour & 0x0F);	\
+	PLOT(OFFSET( 0),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 1),nColour & 0x0F);	\
+	PLOT(OFFSET( 1),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 2),nColour & 0x0F);	\
+	PLOT(OFFSET( 2),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 3),nColour & 0x0F);	\
+	PLOT(OFFSET( 3),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 4),nColour & 0x0F);	\
+	PLOT(OFFSET( 4),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 5),nColour & 0x0F);	\
+	PLOT(OFFSET( 5),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour = pTileData[nLine + 1];			\
-	PLOTPIXEL(OFFSET( 6),nColour & 0x0F);	\
+	PLOT(OFFSET( 6),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 7),nColour & 0x0F);	\
+	PLOT(OFFSET( 7),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 8),nColour & 0x0F);	\
+	PLOT(OFFSET( 8),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 9),nColour & 0x0F);	\
+	PLOT(OFFSET( 9),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(10),nColour & 0x0F);	\
+	PLOT(OFFSET(10),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(11),nColour & 0x0F);	\
+	PLOT(OFFSET(11),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(12),nColour & 0x0F);
+	PLOT(OFFSET(12),nColour & 0x0F);
 #elif XZOOM == 13
- #define PLOTLINE(OFFSET,ADVANCECOLUMN)		\
+ #define PLOTLINE(OFFSET,ADVANCECOLUMN,PLOT)		\
 	nColour = pTileData[nLine];				\
-	PLOTPIXEL(OFFSET( 0),nColour & 0x0F);	\
+	PLOT(OFFSET( 0),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 1),nColour & 0x0F);	\
+	PLOT(OFFSET( 1),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 2),nColour & 0x0F);	\
+	PLOT(OFFSET( 2),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 3),nColour & 0x0F);	\
+	PLOT(OFFSET( 3),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 4),nColour & 0x0F);	\
+	PLOT(OFFSET( 4),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET( 5),nColour & 0x0F);	\
+	PLOT(OFFSET( 5),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 6),nColour & 0x0F);	\
+	PLOT(OFFSET( 6),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour = pTileData[nLine + 1];			\
-	PLOTPIXEL(OFFSET( 7),nColour & 0x0F);	\
+	PLOT(OFFSET( 7),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 8),nColour & 0x0F);	\
+	PLOT(OFFSET( 8),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 9),nColour & 0x0F);	\
+	PLOT(OFFSET( 9),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET(10),nColour & 0x0F);	\
+	PLOT(OFFSET(10),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(11),nColour & 0x0F);	\
+	PLOT(OFFSET(11),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(12),nColour & 0x0F);	\
+	PLOT(OFFSET(12),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(13),nColour & 0x0F);
+	PLOT(OFFSET(13),nColour & 0x0F);
 #elif XZOOM == 14
- #define PLOTLINE(OFFSET,ADVANCECOLUMN)		\
+ #define PLOTLINE(OFFSET,ADVANCECOLUMN,PLOT)		\
 	nColour = pTileData[nLine];				\
-	PLOTPIXEL(OFFSET( 0),nColour & 0x0F);	\
+	PLOT(OFFSET( 0),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 1),nColour & 0x0F);	\
+	PLOT(OFFSET( 1),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 2),nColour & 0x0F);	\
+	PLOT(OFFSET( 2),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 3),nColour & 0x0F);	\
+	PLOT(OFFSET( 3),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 4),nColour & 0x0F);	\
+	PLOT(OFFSET( 4),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 8;							\
-	PLOTPIXEL(OFFSET(5),nColour & 0x0F);	\
+	PLOT(OFFSET(5),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 6),nColour & 0x0F);	\
+	PLOT(OFFSET( 6),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour = pTileData[nLine + 1];			\
-	PLOTPIXEL(OFFSET( 7),nColour & 0x0F);	\
+	PLOT(OFFSET( 7),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 8),nColour & 0x0F);	\
+	PLOT(OFFSET( 8),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 9),nColour & 0x0F);	\
+	PLOT(OFFSET( 9),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(10),nColour & 0x0F);	\
+	PLOT(OFFSET(10),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(11),nColour & 0x0F);	\
+	PLOT(OFFSET(11),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(12),nColour & 0x0F);	\
+	PLOT(OFFSET(12),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(13),nColour & 0x0F);	\
+	PLOT(OFFSET(13),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(14),nColour & 0x0F);
+	PLOT(OFFSET(14),nColour & 0x0F);
 #elif XZOOM == 15
- #define PLOTLINE(OFFSET,ADVANCECOLUMN)		\
+ #define PLOTLINE(OFFSET,ADVANCECOLUMN,PLOT)		\
 	nColour = pTileData[nLine];				\
-	PLOTPIXEL(OFFSET( 0),nColour & 0x0F);	\
+	PLOT(OFFSET( 0),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 1),nColour & 0x0F);	\
+	PLOT(OFFSET( 1),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 2),nColour & 0x0F);	\
+	PLOT(OFFSET( 2),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 3),nColour & 0x0F);	\
+	PLOT(OFFSET( 3),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 4),nColour & 0x0F);	\
+	PLOT(OFFSET( 4),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 5),nColour & 0x0F);	\
+	PLOT(OFFSET( 5),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 6),nColour & 0x0F);	\
+	PLOT(OFFSET( 6),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 7),nColour & 0x0F);	\
+	PLOT(OFFSET( 7),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour = pTileData[nLine +	1];			\
-	PLOTPIXEL(OFFSET( 8),nColour & 0x0F);	\
+	PLOT(OFFSET( 8),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET( 9),nColour & 0x0F);	\
+	PLOT(OFFSET( 9),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(10),nColour & 0x0F);	\
+	PLOT(OFFSET(10),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(11),nColour & 0x0F);	\
+	PLOT(OFFSET(11),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(12),nColour & 0x0F);	\
+	PLOT(OFFSET(12),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(13),nColour & 0x0F);	\
+	PLOT(OFFSET(13),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(14),nColour & 0x0F);	\
+	PLOT(OFFSET(14),nColour & 0x0F);	\
 	ADVANCECOLUMN;							\
 	nColour >>= 4;							\
-	PLOTPIXEL(OFFSET(15),nColour & 0x0F);
+	PLOT(OFFSET(15),nColour & 0x0F);
 #else
  #error unsupported zoom factor specified.
 #endif
@@ -460,14 +461,30 @@
 
 // #undef USE_SPEEDHACKS
 
-static void FUNCTIONNAME(BPP,XZOOM,CLIP,OPACITY)()
+static void FUNCTIONNAME(BPP,XZOOM,CLIP,OPACITY)(const struct NeoSpriteStrip* pStrip, const struct NeoSpriteBand* pBand)
 {
+	UINT16* pBank = pStrip->pBank;
+	INT32 nBankXPos = pStrip->nXPos, nBankYPos = pStrip->nYPos;
+	INT32 nBankYZoom = pStrip->nYZoom, nBankSize = pStrip->nSize;
+	INT32 nBandSliceStart = pBand->nSliceStart, nBandSliceEnd = pBand->nSliceEnd;
+	INT32 nBandStart = pBand->nBandStart, nBandEnd = pBand->nBandEnd;
+	UINT32* pTileData = NULL;
+	UINT16* pTilePalette = NULL;
 	UINT8 *pTileRow, *pPixel;
 	INT32 nColour = 0, nTransparent = 0;
 	INT32 nTileNumber, nTileAttrib = 0;
+	UINT32 nRowAttrib = 0;
+	INT32 nRowType;
 	INT32 nTile, nLine;
 	INT32 nPrevTile;
 	INT32 nYPos;
+#if defined NEO_SPRITE_SIMD && BPP == 16
+	// The vector path always touches 16 columns, so it is only used when they are all on screen
+	bool bSimdLine = nBankXPos >= 0 && nBankXPos + 16 <= nNeoScreenWidth;
+	NeoSimdPalette SimdPalette;
+
+	NeoSimdSetPalette(&SimdPalette, NeoRenderPalette);		// Replaced by the first opaque tile's palette
+#endif
 
 	UINT8* pZoomValue = NeoZoomROM + (nBankYZoom << 8);
 
@@ -482,14 +499,14 @@ static void FUNCTIONNAME(BPP,XZOOM,CLIP,OPACITY)()
       //		bprintf(PRINT_NORMAL, _T("  - s:%i l:%i y:%i %i z:%i\n"), nLinesTotal, nLinesDone, nYPos, nBankYPos, nBankYZoom);
 
       // Skip everything above the part of the display we need to render
-      if (nYPos < nSliceStart)
+      if (nYPos < nBandSliceStart)
       {
-         nLinesDone += nSliceStart - nYPos;
+         nLinesDone += nBandSliceStart - nYPos;
          continue;
       }
       // Skip everything below the part of the display we need to render
-      if (nYPos >= nSliceEnd) {
-         nLinesDone += nSliceStart + 512 - nYPos;
+      if (nYPos >= nBandSliceEnd) {
+         nLinesDone += nBandSliceStart + 512 - nYPos;
          continue;
       }
 
@@ -571,11 +588,16 @@ static void FUNCTIONNAME(BPP,XZOOM,CLIP,OPACITY)()
 #endif
 
          // Clip to the part of the screen we need to render
-         if (nEndLine - nStartLine > nSliceEnd - nYPos - 1)
-            nEndLine = nStartLine + nSliceEnd - nYPos - 1;
+         if (nEndLine - nStartLine > nBandEnd - nYPos - 1)
+            nEndLine = nStartLine + nBandEnd - nYPos - 1;
 
-         pTileRow = pBurnDraw + (nYPos - 0x10) * (BPP >> 3) * nNeoScreenWidth + nBankXPos * (BPP >> 3);
          nThisLine = nStartLine;
+         if (nYPos < nBandStart) {
+            nThisLine += nBandStart - nYPos;
+            nYPos = nBandStart;
+         }
+
+         pTileRow = pNeoRenderDraw + (nYPos - 0x10) * (BPP >> 3) * nNeoScreenWidth + nBankXPos * (BPP >> 3);
 
          nPrevTile = ~0;
 
@@ -607,7 +629,8 @@ static void FUNCTIONNAME(BPP,XZOOM,CLIP,OPACITY)()
                   }
                }
 
-               nTransparent = NeoTileAttribActive[nTileNumber];
+               nRowAttrib = NeoTileAttribActive[nTileNumber];
+               nTransparent = (nRowAttrib == 0);
 
                if (nTransparent == 0)
                {
@@ -621,8 +644,13 @@ static void FUNCTIONNAME(BPP,XZOOM,CLIP,OPACITY)()
                   else
 #endif
                   pTileData = (UINT32*)(NeoSpriteROMActive + (nTileNumber << 7));
+                  NEO_SPRITE_PAGE_TOUCH(nTileNumber);
 
-                  pTilePalette = &NeoPalette[(nTileAttrib & 0xFF00) >> 4];
+                  pTilePalette = &NeoRenderPalette[(nTileAttrib & 0xFF00) >> 4];
+#if defined NEO_SPRITE_SIMD && BPP == 16
+                  if (bSimdLine)
+                     NeoSimdSetPalette(&SimdPalette, pTilePalette);
+#endif
                }
             }
 
@@ -632,14 +660,40 @@ static void FUNCTIONNAME(BPP,XZOOM,CLIP,OPACITY)()
                if (nTileAttrib & 2)	// Flip Y
                   nLine ^= 0x1E;
 
-               if (nTileAttrib & 1) {							// Flip X
-                  pPixel = pTileRow + XZOOM * (BPP >> 3);
-                  PLOTLINE(MIRROROFFSET,pPixel -= (BPP >> 3));
+               // nLine is row * 2, which is also the position of the row in the opacity table
+               nRowType = (nRowAttrib >> nLine) & 3;
+
+#if defined NEO_SPRITE_SIMD && BPP == 16
+               if (bSimdLine)
+               {
+                  if (nRowType != NEO_TILEROW_TRANSPARENT)
+                     NeoSimdPlotLine(&SimdPalette, pTileRow, pTileData + nLine, NeoZoomColumn[XZOOM][nTileAttrib & 1]);
                }
                else
+#endif
+               if (nRowType == NEO_TILEROW_OPAQUE)
+               {
+                  if (nTileAttrib & 1) {							// Flip X
+                     pPixel = pTileRow + XZOOM * (BPP >> 3);
+                     PLOTLINE(MIRROROFFSET,pPixel -= (BPP >> 3),PLOTPIXEL_OPAQUE);
+                  }
+                  else
+                  {
+                     pPixel = pTileRow;
+                     PLOTLINE(NORMALOFFSET,pPixel += (BPP >> 3),PLOTPIXEL_OPAQUE);
+                  }
+               }
+               else if (nRowType == NEO_TILEROW_MIXED)
                {
-                  pPixel = pTileRow;
-                  PLOTLINE(NORMALOFFSET,pPixel += (BPP >> 3));
+                  if (nTileAttrib & 1) {							// Flip X
+                     pPixel = pTileRow + XZOOM * (BPP >> 3);
+                     PLOTLINE(MIRROROFFSET,pPixel -= (BPP >> 3),PLOTPIXEL);
+                  }
+                  else
+                  {
+                     pPixel = pTileRow;
+                     PLOTLINE(NORMALOFFSET,pPixel += (BPP >> 3),PLOTPIXEL);
+                  }
                }
             }
 
@@ -654,6 +708,7 @@ static void FUNCTIONNAME(BPP,XZOOM,CLIP,OPACITY)()
 #undef PLOTLINE
 #undef OPACITY
 #undef PLOTPIXEL
+#undef PLOTPIXEL_OPAQUE
 #undef TESTCOLOUR
 #undef TESTCLIP
 #undef CLIP
@@ -0,0 +1,252 @@
+// Neo Geo -- vectorised sprite line plotting
+//
+// A decoded tile row is 8 bytes holding 16 packed 4bpp pixels. The helpers
+// below unpack a whole row at once, pick the columns used by the current
+// horizontal zoom, look the colours up in the tile's 16 entry palette and
+// write the opaque pixels with a masked store, replacing the per-pixel
+// TESTCOLOUR branch of the scalar PLOTLINE macros.
+//
+// Only used by neo_sprite_render.h when the 16 pixel destination window lies
+// completely inside the visible line; edge strips keep using the scalar path.
+// The zoom column table is always available, the scanline renderer uses it too.
+
+#if !defined MSB_FIRST
+ #if defined __AVX2__ || defined __SSSE3__
+  #include <tmmintrin.h>
+  #if defined __AVX2__
+   #include <immintrin.h>
+  #endif
+  #define NEO_SPRITE_SIMD
+  #define NEO_SPRITE_SIMD_SSSE3
+ #elif defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define NEO_SPRITE_SIMD
+  #define NEO_SPRITE_SIMD_SSE2
+ #elif defined __ARM_NEON__ || defined __ARM_NEON
+  #include <arm_neon.h>
+  #define NEO_SPRITE_SIMD
+  #define NEO_SPRITE_SIMD_NEON
+ #endif
+#endif
+
+#define NS 0x80	// lane not drawn at this zoom level (always transparent)
+
+// Source pixel (0 - 15) for every destination column, per zoom level.
+// [XZOOM][0] is the normal order, [XZOOM][1] the X flipped one.
+static const UINT8 NeoZoomColumn[16][2][16] = {
+	{ {  8, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS },
+	  {  8, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS } },
+	{ {  4,  8, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS },
+	  {  8,  4, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS } },
+	{ {  4,  8, 12, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS },
+	  { 12,  8,  4, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS } },
+	{ {  2,  4,  8, 12, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS },
+	  { 12,  8,  4,  2, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS } },
+	{ {  2,  4,  8, 12, 14, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS },
+	  { 14, 12,  8,  4,  2, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS } },
+	{ {  2,  4,  6,  8, 12, 14, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS },
+	  { 14, 12,  8,  6,  4,  2, NS, NS, NS, NS, NS, NS, NS, NS, NS, NS } },
+	{ {  2,  4,  6,  8, 10, 12, 14, NS, NS, NS, NS, NS, NS, NS, NS, NS },
+	  { 14, 12, 10,  8,  6,  4,  2, NS, NS, NS, NS, NS, NS, NS, NS, NS } },
+	{ {  0,  2,  4,  6,  8, 10, 12, 14, NS, NS, NS, NS, NS, NS, NS, NS },
+	  { 14, 12, 10,  8,  6,  4,  2,  0, NS, NS, NS, NS, NS, NS, NS, NS } },
+	{ {  0,  2,  4,  6,  8,  9, 10, 12, 14, NS, NS, NS, NS, NS, NS, NS },
+	  { 14, 12, 10,  9,  8,  6,  4,  2,  0, NS, NS, NS, NS, NS, NS, NS } },
+	{ {  0,  2,  3,  4,  6,  8,  9, 10, 12, 14, NS, NS, NS, NS, NS, NS },
+	  { 14, 12, 10,  9,  8,  6,  4,  3,  2,  0, NS, NS, NS, NS, NS, NS } },
+	{ {  0,  2,  3,  4,  6,  8,  9, 10, 12, 14, 15, NS, NS, NS, NS, NS },
+	  { 15, 14, 12, 10,  9,  8,  6,  4,  3,  2,  0, NS, NS, NS, NS, NS } },
+	{ {  0,  2,  3,  4,  6,  7,  8,  9, 10, 12, 14, 15, NS, NS, NS, NS },
+	  { 15, 14, 12, 10,  9,  8,  7,  6,  4,  3,  2,  0, NS, NS, NS, NS } },
+	{ {  0,  2,  3,  4,  6,  7,  8,  9, 10, 12, 13, 14, 15, NS, NS, NS },
+	  { 15, 14, 13, 12, 10,  9,  8,  7,  6,  4,  3,  2,  0, NS, NS, NS } },
+	{ {  0,  1,  2,  3,  4,  6,  7,  8,  9, 10, 12, 13, 14, 15, NS, NS },
+	  { 15, 14, 13, 12, 10,  9,  8,  7,  6,  4,  3,  2,  1,  0, NS, NS } },
+	{ {  0,  1,  2,  3,  4,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15, NS },
+	  { 15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  4,  3,  2,  1,  0, NS } },
+	{ {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	  { 15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1,  0 } },
+};
+
+#undef NS
+
+#if defined NEO_SPRITE_SIMD
+
+#if defined NEO_SPRITE_SIMD_SSSE3
+
+// Low and high bytes of the 16 colours of the current tile palette
+typedef struct { __m128i nLo, nHi; } NeoSimdPalette;
+
+static inline void NeoSimdSetPalette(NeoSimdPalette* pPal, const UINT16* pPalette)
+{
+	__m128i w0 = _mm_loadu_si128((const __m128i*)(pPalette + 0));
+	__m128i w1 = _mm_loadu_si128((const __m128i*)(pPalette + 8));
+	__m128i nLowByte = _mm_set1_epi16(0x00FF);
+
+	pPal->nLo = _mm_packus_epi16(_mm_and_si128(w0, nLowByte), _mm_and_si128(w1, nLowByte));
+	pPal->nHi = _mm_packus_epi16(_mm_srli_epi16(w0, 8), _mm_srli_epi16(w1, 8));
+}
+
+static inline void NeoSimdPlotLine(const NeoSimdPalette* pPal, UINT8* pPixel, const UINT32* pRow, const UINT8* pSelect)
+{
+	__m128i nMask = _mm_set1_epi8(0x0F);
+	__m128i nPacked = _mm_loadl_epi64((const __m128i*)pRow);
+
+	// 8 bytes -> 16 colour indices, then pick the columns for this zoom level
+	__m128i nIndex = _mm_unpacklo_epi8(_mm_and_si128(nPacked, nMask), _mm_and_si128(_mm_srli_epi16(nPacked, 4), nMask));
+	nIndex = _mm_shuffle_epi8(nIndex, _mm_loadu_si128((const __m128i*)pSelect));
+
+	__m128i nOpaque = _mm_cmpeq_epi8(nIndex, _mm_setzero_si128());
+	INT32 nOpaqueBits = _mm_movemask_epi8(nOpaque) ^ 0xFFFF;
+	if (nOpaqueBits == 0) {
+		return;
+	}
+
+	__m128i nColLo = _mm_shuffle_epi8(pPal->nLo, nIndex);
+	__m128i nColHi = _mm_shuffle_epi8(pPal->nHi, nIndex);
+	__m128i c0 = _mm_unpacklo_epi8(nColLo, nColHi);
+	__m128i c1 = _mm_unpackhi_epi8(nColLo, nColHi);
+
+	if (nOpaqueBits == 0xFFFF) {
+		_mm_storeu_si128((__m128i*)pPixel + 0, c0);
+		_mm_storeu_si128((__m128i*)pPixel + 1, c1);
+		return;
+	}
+
+	// nOpaque is set for transparent pixels, so it selects the framebuffer
+#if defined __AVX2__
+	{
+		__m256i nColour = _mm256_inserti128_si256(_mm256_castsi128_si256(c0), c1, 1);
+		__m256i nKeep   = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi8(nOpaque, nOpaque)), _mm_unpackhi_epi8(nOpaque, nOpaque), 1);
+		__m256i nDest   = _mm256_loadu_si256((const __m256i*)pPixel);
+		_mm256_storeu_si256((__m256i*)pPixel, _mm256_blendv_epi8(nColour, nDest, nKeep));
+	}
+#else
+	{
+		__m128i m0 = _mm_unpacklo_epi8(nOpaque, nOpaque);
+		__m128i m1 = _mm_unpackhi_epi8(nOpaque, nOpaque);
+		__m128i d0 = _mm_loadu_si128((const __m128i*)pPixel + 0);
+		_mm_storeu_si128((__m128i*)pPixel + 0, _mm_or_si128(_mm_and_si128(m0, d0), _mm_andnot_si128(m0, c0)));
+		if (nOpaqueBits & 0xFF00) {
+			__m128i d1 = _mm_loadu_si128((const __m128i*)pPixel + 1);
+			_mm_storeu_si128((__m128i*)pPixel + 1, _mm_or_si128(_mm_and_si128(m1, d1), _mm_andnot_si128(m1, c1)));
+		}
+	}
+#endif
+}
+
+#elif defined NEO_SPRITE_SIMD_SSE2
+
+// SSE2 has no byte shuffle, so the palette lookup stays scalar; unpacking
+// and the opaque mask / masked store are still done 16 pixels at a time.
+typedef struct { const UINT16* pColour; } NeoSimdPalette;
+
+static inline void NeoSimdSetPalette(NeoSimdPalette* pPal, const UINT16* pPalette)
+{
+	pPal->pColour = pPalette;
+}
+
+static inline void NeoSimdPlotLine(const NeoSimdPalette* pPal, UINT8* pPixel, const UINT32* pRow, const UINT8* pSelect)
+{
+	UINT8 nPixels[16 + 1];
+	UINT8 nIndexSel[16];
+	UINT16 nColour[16];
+	__m128i nMask = _mm_set1_epi8(0x0F);
+	__m128i nPacked = _mm_loadl_epi64((const __m128i*)pRow);
+
+	_mm_storeu_si128((__m128i*)nPixels, _mm_unpacklo_epi8(_mm_and_si128(nPacked, nMask), _mm_and_si128(_mm_srli_epi16(nPacked, 4), nMask)));
+	nPixels[16] = 0;
+
+	// Unused columns (0x80) read the zero stored past the end of the row
+	for (INT32 i = 0; i < 16; i++) {
+		nIndexSel[i] = nPixels[pSelect[i] > 15 ? 16 : pSelect[i]];
+		nColour[i] = pPal->pColour[nIndexSel[i]];
+	}
+
+	__m128i nIndex = _mm_loadu_si128((const __m128i*)nIndexSel);
+	__m128i nOpaque = _mm_cmpeq_epi8(nIndex, _mm_setzero_si128());
+	INT32 nOpaqueBits = _mm_movemask_epi8(nOpaque) ^ 0xFFFF;
+	if (nOpaqueBits == 0) {
+		return;
+	}
+
+	__m128i c0 = _mm_loadu_si128((const __m128i*)nColour + 0);
+	__m128i c1 = _mm_loadu_si128((const __m128i*)nColour + 1);
+
+	if (nOpaqueBits == 0xFFFF) {
+		_mm_storeu_si128((__m128i*)pPixel + 0, c0);
+		_mm_storeu_si128((__m128i*)pPixel + 1, c1);
+		return;
+	}
+
+	__m128i m0 = _mm_unpacklo_epi8(nOpaque, nOpaque);
+	__m128i d0 = _mm_loadu_si128((const __m128i*)pPixel + 0);
+	_mm_storeu_si128((__m128i*)pPixel + 0, _mm_or_si128(_mm_and_si128(m0, d0), _mm_andnot_si128(m0, c0)));
+	if (nOpaqueBits & 0xFF00) {
+		__m128i m1 = _mm_unpackhi_epi8(nOpaque, nOpaque);
+		__m128i d1 = _mm_loadu_si128((const __m128i*)pPixel + 1);
+		_mm_storeu_si128((__m128i*)pPixel + 1, _mm_or_si128(_mm_and_si128(m1, d1), _mm_andnot_si128(m1, c1)));
+	}
+}
+
+#elif defined NEO_SPRITE_SIMD_NEON
+
+typedef struct { uint8x16_t nLo, nHi; } NeoSimdPalette;
+
+static inline void NeoSimdSetPalette(NeoSimdPalette* pPal, const UINT16* pPalette)
+{
+	uint16x8_t w0 = vld1q_u16(pPalette + 0);
+	uint16x8_t w1 = vld1q_u16(pPalette + 8);
+
+	pPal->nLo = vcombine_u8(vmovn_u16(w0), vmovn_u16(w1));
+	pPal->nHi = vcombine_u8(vshrn_n_u16(w0, 8), vshrn_n_u16(w1, 8));
+}
+
+#if defined __aarch64__
+ #define NEO_SIMD_TBL16(t, i)	vqtbl1q_u8(t, i)
+#else
+static inline uint8x16_t NeoSimdTbl16(uint8x16_t nTable, uint8x16_t nIndex)
+{
+	uint8x8x2_t t;
+	t.val[0] = vget_low_u8(nTable);
+	t.val[1] = vget_high_u8(nTable);
+	return vcombine_u8(vtbl2_u8(t, vget_low_u8(nIndex)), vtbl2_u8(t, vget_high_u8(nIndex)));
+}
+ #define NEO_SIMD_TBL16(t, i)	NeoSimdTbl16(t, i)
+#endif
+
+static inline void NeoSimdPlotLine(const NeoSimdPalette* pPal, UINT8* pPixel, const UINT32* pRow, const UINT8* pSelect)
+{
+	uint8x8_t nPacked = vld1_u8((const UINT8*)pRow);
+	uint8x8x2_t nNibbles = vzip_u8(vand_u8(nPacked, vdup_n_u8(0x0F)), vshr_n_u8(nPacked, 4));
+
+	// Out of range table indices (0x80) return 0, i.e. transparent
+	uint8x16_t nIndex = NEO_SIMD_TBL16(vcombine_u8(nNibbles.val[0], nNibbles.val[1]), vld1q_u8(pSelect));
+	uint8x16_t nOpaque = vtstq_u8(nIndex, nIndex);
+
+	uint64x2_t nAny = vreinterpretq_u64_u8(nOpaque);
+	UINT64 nLeft = vgetq_lane_u64(nAny, 0), nRight = vgetq_lane_u64(nAny, 1);
+	if ((nLeft | nRight) == 0) {
+		return;
+	}
+
+	uint8x16x2_t nColour = vzipq_u8(NEO_SIMD_TBL16(pPal->nLo, nIndex), NEO_SIMD_TBL16(pPal->nHi, nIndex));
+
+	if ((nLeft & nRight) == ~(UINT64)0) {
+		vst1q_u8(pPixel +  0, nColour.val[0]);
+		vst1q_u8(pPixel + 16, nColour.val[1]);
+		return;
+	}
+
+	uint8x16x2_t nWrite = vzipq_u8(nOpaque, nOpaque);
+	vst1q_u8(pPixel + 0, vbslq_u8(nWrite.val[0], nColour.val[0], vld1q_u8(pPixel + 0)));
+	if (nRight) {
+		vst1q_u8(pPixel + 16, vbslq_u8(nWrite.val[1], nColour.val[1], vld1q_u8(pPixel + 16)));
+	}
+}
+
+#undef NEO_SIMD_TBL16
+
+#endif
+
+#endif
@@ -16,10 +16,6 @@ static INT32 nBankswitch[MAX_SLOT] = { 0, };
 static INT32 nBankLookupAddress[40];
 static INT32 nBankLookupShift[40];
 
-static UINT8* pTile;
-static UINT8* pTileData;
-static UINT32* pTilePalette;
-
 static INT32 nLastBPP = 0;
 
 static INT32 nMinX, nMaxX;
@@ -28,25 +24,160 @@ static INT32 nMinX, nMaxX;
  #include "neo_text_render.h"
 #undef BPP
 
-INT32 NeoRenderText(void)
+// Fix layer cache
+//
+// The fix layer rarely changes, so every visible tile is kept pre-drawn in a
+// 320x224 surface (colours plus a mask of the opaque pixels) and only
+// composited over the sprites each frame. A tile is redrawn when the tile it
+// shows changes -- including the bank selected through 0xEA00/0xEB00 in the
+// bankswitched modes -- or when its palette or the fix ROM changed.
+// Cells are compared with what was drawn instead of being marked by the
+// write handlers, so this also works when drawing from a pipeline snapshot.
+
+#if !defined MSB_FIRST
+ #if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define NEO_TEXT_SIMD_SSE2
+ #elif defined __ARM_NEON__ || defined __ARM_NEON
+  #include <arm_neon.h>
+  #define NEO_TEXT_SIMD_NEON
+ #endif
+#endif
+
+#define NEO_TEXT_CACHE_WIDTH	(320)
+
+static UINT16* NeoTextCachePixel = NULL;
+static UINT16* NeoTextCacheMask = NULL;
+static UINT32 NeoTextCacheKey[28 * 40];					// What each cell was drawn with, 0 = nothing
+static UINT16 NeoTextCachePalette[256];					// The 16 fix palettes the cache was drawn with
+static UINT32 nNeoTextCacheDirtyPalettes;
+static INT32 nNeoTextCacheGeneration = -1;
+static INT32 nNeoTextROMGeneration = 0;					// Bumped when the fix ROM changes
+
+// Draw one tile into the cache
+static void NeoTextCacheTile(const UINT8* pData, const UINT16* pPalette, UINT16* pPixel, UINT16* pMask)
+{
+   for (INT32 y = 0; y < 8; y++, pPixel += NEO_TEXT_CACHE_WIDTH, pMask += NEO_TEXT_CACHE_WIDTH) {
+      for (INT32 x = 0; x < 8; x += 2) {
+         INT32 nColour = *pData++;
+
+         pPixel[x + 0] = pPalette[nColour >> 4];
+         pMask[x + 0]  = (nColour & 0xF0) ? 0xFFFF : 0;
+         pPixel[x + 1] = pPalette[nColour & 0x0F];
+         pMask[x + 1]  = (nColour & 0x0F) ? 0xFFFF : 0;
+      }
+   }
+}
+
+// Copy the opaque pixels of a cached tile to the screen
+static inline void NeoTextCacheBlit(UINT8* pDest, const UINT16* pPixel, const UINT16* pMask)
+{
+   for (INT32 y = 0; y < 8; y++, pDest += nBurnPitch, pPixel += NEO_TEXT_CACHE_WIDTH, pMask += NEO_TEXT_CACHE_WIDTH) {
+#if defined NEO_TEXT_SIMD_SSE2
+      __m128i d = _mm_loadu_si128((__m128i*)pDest);
+      __m128i m = _mm_loadu_si128((const __m128i*)pMask);
+      _mm_storeu_si128((__m128i*)pDest, _mm_or_si128(_mm_andnot_si128(m, d), _mm_and_si128(m, _mm_loadu_si128((const __m128i*)pPixel))));
+#elif defined NEO_TEXT_SIMD_NEON
+      vst1q_u16((UINT16*)pDest, vbslq_u16(vld1q_u16(pMask), vld1q_u16(pPixel), vld1q_u16((UINT16*)pDest)));
+#else
+      UINT32* d = (UINT32*)pDest;
+      const UINT32* s = (const UINT32*)pPixel;
+      const UINT32* m = (const UINT32*)pMask;
+
+      d[0] = (d[0] & ~m[0]) | (s[0] & m[0]);
+      d[1] = (d[1] & ~m[1]) | (s[1] & m[1]);
+      d[2] = (d[2] & ~m[2]) | (s[2] & m[2]);
+      d[3] = (d[3] & ~m[3]) | (s[3] & m[3]);
+#endif
+   }
+}
+
+// Called from NeoInitText, so the buffers are never allocated on the render
+// thread (BurnMalloc isn't thread safe). Without them the tiles are drawn
+// uncached.
+static void NeoTextCacheInit(void)
+{
+   if (NeoTextCachePixel == NULL) {
+      NeoTextCachePixel = (UINT16*)BurnMalloc(NEO_TEXT_CACHE_WIDTH * 224 * sizeof(UINT16));
+      NeoTextCacheMask  = (UINT16*)BurnMalloc(NEO_TEXT_CACHE_WIDTH * 224 * sizeof(UINT16));
+      if (NeoTextCachePixel == NULL || NeoTextCacheMask == NULL) {
+         BurnFree(NeoTextCachePixel);
+         BurnFree(NeoTextCacheMask);
+      }
+   }
+   nNeoTextCacheGeneration = -1;
+}
+
+// Start of NeoRenderText: find the fix palettes that changed and drop the
+// whole cache if the fix ROM changed
+static void NeoTextCacheUpdate(void)
+{
+   nNeoTextCacheDirtyPalettes = 0;
+
+   if (NeoTextCachePixel == NULL)
+      return;
+
+   if (nNeoTextCacheGeneration != nNeoTextROMGeneration) {
+      nNeoTextCacheGeneration = nNeoTextROMGeneration;
+      memset(NeoTextCacheKey, 0, sizeof(NeoTextCacheKey));
+   }
+
+   for (INT32 i = 0; i < 16; i++) {
+      if (memcmp(NeoTextCachePalette + (i << 4), NeoRenderPalette + (i << 4), 16 * sizeof(UINT16))) {
+         memcpy(NeoTextCachePalette + (i << 4), NeoRenderPalette + (i << 4), 16 * sizeof(UINT16));
+         nNeoTextCacheDirtyPalettes |= 1 << i;
+      }
+   }
+}
+
+static void NeoTextCacheExit(void)
+{
+   BurnFree(NeoTextCachePixel);
+   BurnFree(NeoTextCacheMask);
+}
+
+// Plot fix tile nTile (bank included) with palette nPalette (0x0000 - 0xF000) at column x, row y
+static inline void NeoPlotTextTile(UINT8* pTile, INT32 x, INT32 y, UINT8* pTextROM, INT8* pTileAttrib, UINT32 nTile, INT32 nPalette)
+{
+   if (NeoTextCachePixel) {
+      UINT32* pKey = &NeoTextCacheKey[(y - 2) * 40 + x];
+      UINT32 nKey = 0x80000000 | (bNeoRenderTextBIOS << 20) | (nPalette << 4) | nTile;
+      INT32 nOffset = (y - 2) * 8 * NEO_TEXT_CACHE_WIDTH + (x << 3);
+
+      if (pTileAttrib[nTile]) {
+         *pKey = nKey;
+         return;
+      }
+
+      if (*pKey != nKey || (nNeoTextCacheDirtyPalettes & (1 << (nPalette >> 12)))) {
+         *pKey = nKey;
+         NeoTextCacheTile(pTextROM + (nTile << 5), &NeoTextCachePalette[nPalette >> 8], NeoTextCachePixel + nOffset, NeoTextCacheMask + nOffset);
+      }
+
+      NeoTextCacheBlit(pTile, NeoTextCachePixel + nOffset, NeoTextCacheMask + nOffset);
+      return;
+   }
+
+   if (pTileAttrib[nTile] == 0)
+      RenderTile16(pTile, pTextROM + (nTile << 5), &NeoRenderPalette[nPalette >> 8]);
+}
+
+// Draw the fix layer rows nFirstRow - (nLastRow - 1), visible rows are 2 - 29
+static void NeoRenderTextRows(INT32 nFirstRow, INT32 nLastRow)
 {
    INT32 x, y;
+   UINT8* pTile;
    UINT8* pTextROM;
    INT8* pTileAttrib;
-   UINT8* pCurrentRow = pBurnDraw;
-   UINT32* pTextPalette = NeoPalette;
    UINT32 nTileDown = nBurnPitch << 3;
    UINT32 nTileLeft = nBurnBpp << 3;
-   UINT16* pTileRow = (UINT16*)(NeoGraphicsRAM + 0xE000);
-
-   if (!(nBurnLayer & 2))
-      return 0;
+   UINT8* pCurrentRow = pNeoRenderDraw + (nFirstRow - 2) * nTileDown;
+   UINT16* pTileRow = (UINT16*)(NeoRenderVRAM + 0xE000) + nFirstRow;
 
-   if (!bBIOSTextROMEnabled && nBankswitch[nNeoActiveSlot])
+   if (!bNeoRenderTextBIOS && nBankswitch[nNeoActiveSlot])
    {
-
-      if (!NeoTextROMCurrent)
-         return 0;
+      pTextROM    = NeoTextROMCurrent;
+      pTileAttrib = NeoTextTileAttribActive;
 
       if (nBankswitch[nNeoActiveSlot] == 1)
       {
@@ -60,57 +191,43 @@ INT32 NeoRenderText(void)
          y = 0;
          while (y < 32)
          {
-            if (*((UINT16*)(NeoGraphicsRAM + 0xEA00 + z)) == 0x0200 && (*((UINT16*)(NeoGraphicsRAM + 0xEB00 + z)) & 0xFF00) == 0xFF00)
+            if (*((UINT16*)(NeoRenderVRAM + 0xEA00 + z)) == 0x0200 && (*((UINT16*)(NeoRenderVRAM + 0xEB00 + z)) & 0xFF00) == 0xFF00)
             {
-               nBank = ((*((UINT16*)(NeoGraphicsRAM + 0xEB00 + z)) & 3) ^ 3) << 12;
+               nBank = ((*((UINT16*)(NeoRenderVRAM + 0xEB00 + z)) & 3) ^ 3) << 12;
                nOffset[y++] = nBank;
             }
             nOffset[y++] = nBank;
             z += 4;
          }
 
-         for (y = 2, pTileRow += 2; y < 30; y++, pCurrentRow += nTileDown, pTileRow++)
+         for (y = nFirstRow; y < nLastRow; y++, pCurrentRow += nTileDown, pTileRow++)
          {
-            pTextROM    = NeoTextROMCurrent        + (nOffset[y - 2] << 5);
-            pTileAttrib = NeoTextTileAttribActive +  nOffset[y - 2];
             for (x = nMinX, pTile = pCurrentRow; x < nMaxX; x++, pTile += nTileLeft)
             {
                UINT32 nTile = pTileRow[x << 5];
-               INT32 nPalette = nTile & 0xF000;
-               nTile &= 0x0FFF;
-               if (pTileAttrib[nTile] == 0) {
-                  pTileData = pTextROM + (nTile << 5);
-                  pTilePalette = &pTextPalette[nPalette >> 8];
-                  RenderTile16();
-               }
+               NeoPlotTextTile(pTile, x, y, pTextROM, pTileAttrib, (nTile & 0x0FFF) + nOffset[y - 2], nTile & 0xF000);
             }
          }
       } else {
 
          // KOF2000
 
-         UINT16* pBankInfo = (UINT16*)(NeoGraphicsRAM + 0xEA00) + 1;
-         pTextROM    = NeoTextROMCurrent;
-         pTileAttrib = NeoTextTileAttribActive;
+         UINT16* pBankInfo = (UINT16*)(NeoRenderVRAM + 0xEA00) + 1 + (nFirstRow - 2);
 
-         for (y = 2, pTileRow += 2; y < 30; y++, pCurrentRow += nTileDown, pTileRow++, pBankInfo++) {
+         for (y = nFirstRow; y < nLastRow; y++, pCurrentRow += nTileDown, pTileRow++, pBankInfo++) {
             for (x = nMinX, pTile = pCurrentRow; x < nMaxX; x++, pTile += nTileLeft) {
                UINT32 nTile = pTileRow[x << 5];
                INT32 nPalette = nTile & 0xF000;
                nTile &= 0x0FFF;
                nTile += (((pBankInfo[nBankLookupAddress[x]] >> nBankLookupShift[x]) & 3) ^ 3) << 12;
-               if (pTileAttrib[nTile] == 0) {
-                  pTileData = pTextROM + (nTile << 5);
-                  pTilePalette = &pTextPalette[nPalette >> 8];
-                  RenderTile16();
-               }
+               NeoPlotTextTile(pTile, x, y, pTextROM, pTileAttrib, nTile, nPalette);
             }
          }
       }
    }
    else
    {
-      if (bBIOSTextROMEnabled)
+      if (bNeoRenderTextBIOS)
       {
          pTextROM    = NeoTextROMBIOS;
          pTileAttrib = NeoTextTileAttribBIOS;
@@ -118,31 +235,53 @@ INT32 NeoRenderText(void)
          pTextROM    = NeoTextROMCurrent;
          pTileAttrib = NeoTextTileAttribActive;
       }
-      if (!pTextROM)
-         return 0;
 
-      for (y = 2, pTileRow += 2; y < 30; y++, pCurrentRow += nTileDown, pTileRow++)
+      for (y = nFirstRow; y < nLastRow; y++, pCurrentRow += nTileDown, pTileRow++)
       {
          for (x = nMinX, pTile = pCurrentRow; x < nMaxX; x++, pTile += nTileLeft)
          {
             UINT32 nTile = pTileRow[x << 5];
-            INT32 nPalette = nTile & 0xF000;
-            nTile &= 0xFFF;
-            if (pTileAttrib[nTile] == 0)
-            {
-               pTileData = pTextROM + (nTile << 5);
-               pTilePalette = &pTextPalette[nPalette >> 8];
-               RenderTile16();
-            }
+            NeoPlotTextTile(pTile, x, y, pTextROM, pTileAttrib, nTile & 0x0FFF, nTile & 0xF000);
          }
       }
    }
+}
+
+static void NeoRenderTextBand(void* pParam, INT32 nBand)
+{
+   INT32 nBands = *(INT32*)pParam;
+
+   NeoRenderTextRows(2 + 28 * nBand / nBands, 2 + 28 * (nBand + 1) / nBands);
+}
+
+INT32 NeoRenderText(void)
+{
+   INT32 nBands = BurnThreadCount();
+
+   if (!(nBurnLayer & 2))
+      return 0;
+
+   if (bNeoRenderTextBIOS) {
+      if (!NeoTextROMBIOS)
+         return 0;
+   } else {
+      if (!NeoTextROMCurrent)
+         return 0;
+   }
+
+   NeoTextCacheUpdate();
+
+   if (nBands > 1)
+      BurnThreadRun(NeoRenderTextBand, &nBands, nBands);
+   else
+      NeoRenderTextRows(2, 30);
 
    return 0;
 }
 
 void NeoExitText(INT32 nSlot)
 {
+	NeoTextCacheExit();
 	BurnFree(NeoTextTileAttribBIOS);
 	BurnFree(NeoTextTileAttrib[nSlot]);
 	NeoTextTileAttribActive = NULL;
@@ -202,6 +341,8 @@ void NeoUpdateTextOne(INT32 nOffset, const UINT8 byteValue)
 	}
 
 	NeoTextROMCurrent[nOffset] = byteValue;
+	nNeoTextROMGeneration++;
+	nNeoGraphicsGeneration++;
 }
 
 static inline void NeoTextDecodeTile(const UINT8* pData, UINT8* pDest)
@@ -231,6 +372,8 @@ void NeoDecodeTextBIOS(INT32 nOffset, const INT32 nSize, UINT8* pData)
    for (UINT8* pDest = NeoTextROMBIOS + (nOffset & ~0x1F); pData < pEnd; pData += 32, pDest += 32)
       NeoTextDecodeTile(pData, pDest);
 
+   nNeoTextROMGeneration++;
+
 #if 0
    if (NeoTextTileAttribBIOS)
       NeoUpdateTextAttribBIOS(0, nSize);
@@ -250,12 +393,18 @@ void NeoUpdateText(INT32 nOffset, const INT32 nSize, UINT8* pData, UINT8* pDest)
    NeoDecodeText(nOffset, nSize, pData, pDest);
    if (NeoTextTileAttribActive)
       NeoUpdateTextAttrib((nOffset & ~0x1F), nSize);
+
+   nNeoTextROMGeneration++;
+   nNeoGraphicsGeneration++;
 }
 
 void NeoSetTextSlot(INT32 nSlot)
 {
 	NeoTextROMCurrent       = NeoTextROM[nSlot];
 	NeoTextTileAttribActive = NeoTextTileAttrib[nSlot];
+
+	nNeoTextROMGeneration++;
+	nNeoGraphicsGeneration++;
 }
 
 INT32 NeoInitText(INT32 nSlot)
@@ -267,6 +416,8 @@ INT32 NeoInitText(INT32 nSlot)
          NeoTextTileAttribBIOS[i] = 1;
       NeoUpdateTextAttribBIOS(0, 0x020000);
 
+      NeoTextCacheInit();
+
       return 0;
    }
 
@@ -291,6 +442,7 @@ INT32 NeoInitText(INT32 nSlot)
 
    NeoTextROMCurrent       = NeoTextROM[nSlot];
    NeoTextTileAttribActive = NeoTextTileAttrib[nSlot];
+   nNeoTextROMGeneration++;
    for (INT32 i = 0; i < ((nTileNum < 0x1000) ? 0x1000 : nTileNum); i++)
       NeoTextTileAttribActive[i] = 1;
    NeoUpdateTextAttrib(0, nNeoTextROMSize[nSlot]);
@@ -18,7 +18,7 @@
 #endif
 
 
-static void FUNCTIONNAME(BPP)()
+static void FUNCTIONNAME(BPP)(UINT8* pTile, const UINT8* pTileData, const UINT16* pTilePalette)
 {
 	UINT8 *pTileRow, *pPixel;
 	INT32 y, nColour;
@@ -3,6 +3,16 @@
 #include "neogeo.h"
 #include "bitswap.h"
 
+#if !defined MSB_FIRST
+ #if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define NEO_DECODE_SIMD_SSE2
+ #elif defined __ARM_NEON__ || defined __ARM_NEON
+  #include <arm_neon.h>
+  #define NEO_DECODE_SIMD_NEON
+ #endif
+#endif
+
 UINT8 nNeoProtectionXor;
 
 // This function loads the 68K ROMs
@@ -65,17 +75,43 @@ static void NeoPCBDataDecrypt(UINT8* dst, INT32 size)
 		((UINT32*)dst)[i] = BURN_ENDIAN_SWAP_INT32(BITSWAP32(0xE9C42134 ^ BURN_ENDIAN_SWAP_INT32(((UINT32*)dst)[i]), 0x09, 0x0D, 0x13, 0x00, 0x17, 0x0F, 0x03, 0x05, 0x04, 0x0C, 0x11, 0x1E, 0x12, 0x15, 0x0B, 0x06, 0x1B, 0x0A, 0x1A, 0x1C, 0x14, 0x02, 0x0e, 0x1D, 0x18, 0x08, 0x01, 0x10, 0x19, 0x1F, 0x07, 0x16));
 }
 
+// The C ROMs are decrypted in independent 4MB blocks, spread over the worker pool.
+// Each block only modifies its own part of the load buffer, and the CMC address
+// scrambling is a permutation of the ROM, so no two blocks write the same word.
+struct NeoSpriteDecryptJob {
+   UINT8* pDest;
+   UINT8* pBuf1;
+   UINT8* pBuf2;
+   INT32 nOffset;										// Where the first block goes in the decrypted ROM
+   INT32 nSize;
+   bool bPCB, bKOF2K3;
+};
+
+static void NeoSpriteDecryptBlock(void* pParam, INT32 nJob)
+{
+   struct NeoSpriteDecryptJob* pJob = (struct NeoSpriteDecryptJob*)pParam;
+   INT32 j = nJob * 0x400000;
+
+   if (pJob->bPCB) {
+      pJob->bKOF2K3 ? NeoKOFAddressDecrypt(pJob->pBuf2, pJob->pBuf1, j, j + 0x400000) : NeoSVCAddressDecrypt(pJob->pBuf2, pJob->pBuf1, j, j + 0x400000);
+      NeoPCBDataDecrypt(pJob->pBuf1 + j, 0x400000);
+   }
+   NeoCMCDecrypt(nNeoProtectionXor, pJob->pDest, pJob->pBuf1 + j, pJob->nOffset + j, 0x400000, pJob->nSize);
+}
+
 // This function loads and pre-processes the sprite data
 INT32 NeoLoadSprites(INT32 nOffset, INT32 nNum, UINT8* pDest, UINT32 nSpriteSize)
 {
    struct BurnRomInfo ri;
 
    UINT32 nRomSize = 0;
+   UINT64 nProfile = BurnProfileStart();
 
    if (BurnDrvGetHardwareCode() & (HARDWARE_SNK_CMC42 | HARDWARE_SNK_CMC50)) {
 
       UINT8* pBuf1 = NULL;
       UINT8* pBuf2 = NULL;
+      struct NeoSpriteDecryptJob Job;
 
       //		double dProgress = 1.0 / ((double)((nSpriteSize > 0x04000000) ? 0x05000000 : nSpriteSize) / 0x400000 * 1.5);
 
@@ -130,27 +166,27 @@ INT32 NeoLoadSprites(INT32 nOffset, INT32 nNum, UINT8* pDest, UINT32 nSpriteSize
          //			BurnUpdateProgress(0.0, _T("Decrypting graphics...")/*, BST_DECRYPT_GRA*/ , 0);
          BurnUpdateProgress(1.0 / ((double)(nSpriteSize/0x800000) * 8.0 / (nRomSize / 0x400000) / 3.0), _T("Decrypting graphics..."), 0);
 
+         Job.pBuf1 = pBuf1;
+         Job.pBuf2 = pBuf2;
+         Job.bPCB = (BurnDrvGetHardwareCode() & HARDWARE_PUBLIC_MASK) == HARDWARE_SNK_DEDICATED_PCB;
+         Job.bKOF2K3 = (BurnDrvGetHardwareCode() & HARDWARE_SNK_KOF2K3) != 0;
+
+         UINT64 nProfileDecrypt = BurnProfileStart();
          if ((i * nRomSize * 2) < 0x04000000) {
-            for (UINT32 j = 0; j < nRomSize * 2; j += 0x400000) {
-               if ((BurnDrvGetHardwareCode() & HARDWARE_PUBLIC_MASK) == HARDWARE_SNK_DEDICATED_PCB) {
-                  //						BurnUpdateProgress(dProgress / 2.0, NULL/*, 0*/, 0);
-                  (BurnDrvGetHardwareCode() & HARDWARE_SNK_KOF2K3) ? NeoKOFAddressDecrypt(pBuf2, pBuf1, j, j + 0x400000) : NeoSVCAddressDecrypt(pBuf2, pBuf1, j, j + 0x400000);
-                  NeoPCBDataDecrypt(pBuf1 + j, 0x400000);
-               }
-               //					BurnUpdateProgress(dProgress, NULL/*, 0*/, 0);
-               NeoCMCDecrypt(nNeoProtectionXor, pDest, pBuf1 + j, i * (nRomSize * 2) + j, 0x400000, nSpriteSize);
-            }
+            Job.pDest = pDest;
+            Job.nOffset = i * (nRomSize * 2);
+            Job.nSize = nSpriteSize;
+            BurnThreadRun(NeoSpriteDecryptBlock, &Job, (nRomSize * 2 + 0x3FFFFF) / 0x400000);
          } else {
             // The kof2k3 PCB has 96MB of graphics ROM, however the last 16MB are unused, and the protection/decryption hardware does not see them
 
-            for (UINT32 j = 0; j < nRomSize; j += 0x400000) {
-               //					BurnUpdateProgress(dProgress / 2.0, NULL/*, 0*/, 0);
-               NeoKOFAddressDecrypt(pBuf2, pBuf1, j, j + 0x400000);
-               NeoPCBDataDecrypt(pBuf1 + j, 0x400000);
-               //					BurnUpdateProgress(dProgress, NULL, /*0,*/ 0);
-               NeoCMCDecrypt(nNeoProtectionXor, pDest + 0x4000000, pBuf1 + j, j, 0x400000, 0x1000000);
-            }
+            Job.pDest = pDest + 0x4000000;
+            Job.nOffset = 0;
+            Job.nSize = 0x1000000;
+            Job.bPCB = Job.bKOF2K3 = true;
+            BurnThreadRun(NeoSpriteDecryptBlock, &Job, (nRomSize + 0x3FFFFF) / 0x400000);
          }
+         BurnProfileStop("NeoCMCDecrypt", nProfileDecrypt, nRomSize * 2);
       }
 
       BurnFree(pBuf2);
@@ -227,13 +263,154 @@ INT32 NeoLoadSprites(INT32 nOffset, INT32 nNum, UINT8* pDest, UINT32 nSpriteSize
          return 1;
    }
 
+   BurnProfileStop("NeoLoadSprites", nProfile, nSpriteSize);
+
    return 0;
 }
 
 // ----------------------------------------------------------------------------
 // Graphics decoding for MVS/AES
 
-void NeoDecodeSprites(UINT8* pDest, INT32 nSize)
+// Sprite tile decoding
+//
+// Each row of a tile is stored as 4 bit planes for either half: bytes 64-127
+// hold the pixels that end up in the even words, bytes 0-63 those in the odd
+// words. Taking the 8 plane bytes of a row of both halves as an 8x8 bit
+// matrix, a transpose gives one byte per pixel pair (first half in the low
+// nibble), and unzipping the nibbles gives the two packed 4bpp words. Both
+// are a few delta swaps on a 64-bit value, or on two of them with SSE2/NEON.
+// Cartridge tiles have planes 1 and 2 the other way round, which is one more
+// swap before the transpose.
+
+#define NEO_DECODE_SWAP(x, m, s) { UINT64 t = ((x >> (s)) ^ x) & (m); x ^= t ^ (t << (s)); }
+
+static inline UINT64 NeoDecodeRow(UINT64 x, bool bCD)
+{
+   if (!bCD)
+      NEO_DECODE_SWAP(x, 0x0000FF000000FF00ULL, 8);
+
+   NEO_DECODE_SWAP(x, 0x00AA00AA00AA00AAULL, 7);
+   NEO_DECODE_SWAP(x, 0x0000CCCC0000CCCCULL, 14);
+   NEO_DECODE_SWAP(x, 0x00000000F0F0F0F0ULL, 28);
+
+   NEO_DECODE_SWAP(x, 0x00F000F000F000F0ULL, 4);
+   NEO_DECODE_SWAP(x, 0x0000FF000000FF00ULL, 8);
+   NEO_DECODE_SWAP(x, 0x00000000FFFF0000ULL, 16);
+
+   return x;
+}
+
+#if defined NEO_DECODE_SIMD_SSE2
+
+#define NEO_DECODE_SWAP_SSE2(x, h, l, s) { __m128i t = _mm_and_si128(_mm_xor_si128(_mm_srli_epi64(x, s), x), _mm_set_epi32(h, l, h, l)); x = _mm_xor_si128(x, _mm_xor_si128(t, _mm_slli_epi64(t, s))); }
+
+static inline __m128i NeoDecodeRowSSE2(__m128i x, bool bCD)
+{
+   if (!bCD)
+      NEO_DECODE_SWAP_SSE2(x, 0x0000FF00, 0x0000FF00, 8);
+
+   NEO_DECODE_SWAP_SSE2(x, 0x00AA00AA, 0x00AA00AA, 7);
+   NEO_DECODE_SWAP_SSE2(x, 0x0000CCCC, 0x0000CCCC, 14);
+   NEO_DECODE_SWAP_SSE2(x, 0x00000000, (INT32)0xF0F0F0F0, 28);
+
+   NEO_DECODE_SWAP_SSE2(x, 0x00F000F0, 0x00F000F0, 4);
+   NEO_DECODE_SWAP_SSE2(x, 0x0000FF00, 0x0000FF00, 8);
+   NEO_DECODE_SWAP_SSE2(x, 0x00000000, (INT32)0xFFFF0000, 16);
+
+   return x;
+}
+
+#elif defined NEO_DECODE_SIMD_NEON
+
+#define NEO_DECODE_SWAP_NEON(x, m, s) { uint64x2_t t = vandq_u64(veorq_u64(vshrq_n_u64(x, s), x), vdupq_n_u64(m)); x = veorq_u64(x, veorq_u64(t, vshlq_n_u64(t, s))); }
+
+static inline uint64x2_t NeoDecodeRowNEON(uint64x2_t x, bool bCD)
+{
+   if (!bCD)
+      NEO_DECODE_SWAP_NEON(x, 0x0000FF000000FF00ULL, 8);
+
+   NEO_DECODE_SWAP_NEON(x, 0x00AA00AA00AA00AAULL, 7);
+   NEO_DECODE_SWAP_NEON(x, 0x0000CCCC0000CCCCULL, 14);
+   NEO_DECODE_SWAP_NEON(x, 0x00000000F0F0F0F0ULL, 28);
+
+   NEO_DECODE_SWAP_NEON(x, 0x00F000F000F000F0ULL, 4);
+   NEO_DECODE_SWAP_NEON(x, 0x0000FF000000FF00ULL, 8);
+   NEO_DECODE_SWAP_NEON(x, 0x00000000FFFF0000ULL, 16);
+
+   return x;
+}
+
+#endif
+
+// Decode nTiles tiles from pData to pDest, which may be the same. If pAttrib
+// is given, the row opacity of each tile is computed while it is still in cache.
+static void NeoDecodeTiles(const UINT8* pData, UINT8* pDest, INT32 nTiles, bool bCD, UINT32* pAttrib)
+{
+   for (INT32 i = 0; i < nTiles; i++, pData += 128, pDest += 128) {
+#if defined NEO_DECODE_SIMD_SSE2
+      __m128i a[4], b[4];
+
+      for (INT32 j = 0; j < 4; j++) {
+         a[j] = _mm_loadu_si128((const __m128i*)(pData + 64 + (j << 4)));
+         b[j] = _mm_loadu_si128((const __m128i*)(pData + (j << 4)));
+      }
+      for (INT32 j = 0; j < 4; j++) {
+         _mm_storeu_si128((__m128i*)(pDest + (j << 5) +  0), NeoDecodeRowSSE2(_mm_unpacklo_epi32(a[j], b[j]), bCD));
+         _mm_storeu_si128((__m128i*)(pDest + (j << 5) + 16), NeoDecodeRowSSE2(_mm_unpackhi_epi32(a[j], b[j]), bCD));
+      }
+#elif defined NEO_DECODE_SIMD_NEON
+      uint32x4_t a[4], b[4];
+
+      for (INT32 j = 0; j < 4; j++) {
+         a[j] = vreinterpretq_u32_u8(vld1q_u8(pData + 64 + (j << 4)));
+         b[j] = vreinterpretq_u32_u8(vld1q_u8(pData + (j << 4)));
+      }
+      for (INT32 j = 0; j < 4; j++) {
+         uint32x4x2_t r = vzipq_u32(a[j], b[j]);
+         vst1q_u8(pDest + (j << 5) +  0, vreinterpretq_u8_u64(NeoDecodeRowNEON(vreinterpretq_u64_u32(r.val[0]), bCD)));
+         vst1q_u8(pDest + (j << 5) + 16, vreinterpretq_u8_u64(NeoDecodeRowNEON(vreinterpretq_u64_u32(r.val[1]), bCD)));
+      }
+#else
+      UINT32 data[32];
+
+      for (INT32 y = 0; y < 16; y++) {
+         const UINT8* a = pData + 64 + (y << 2);
+         const UINT8* b = pData + (y << 2);
+         UINT64 x = (UINT64)(a[0] | (a[1] << 8) | (a[2] << 16) | ((UINT32)a[3] << 24)) | ((UINT64)(b[0] | (b[1] << 8) | (b[2] << 16) | ((UINT32)b[3] << 24)) << 32);
+
+         x = NeoDecodeRow(x, bCD);
+         data[(y << 1) + 0] = (UINT32)x;
+         data[(y << 1) + 1] = (UINT32)(x >> 32);
+      }
+      memcpy(pDest, data, sizeof(data));
+#endif
+
+      if (pAttrib)
+         pAttrib[i] = NeoCalcTileAttrib(pDest);
+   }
+}
+
+#define NEO_DECODE_CHUNK		(0x040000)				// Bytes per job
+
+struct NeoDecodeJob {
+   UINT8* pStart;
+   INT32 nSize;
+   UINT32* pAttrib;
+};
+
+static void NeoDecodeSpriteChunk(void* pParam, INT32 nJob)
+{
+   struct NeoDecodeJob* pJob = (struct NeoDecodeJob*)pParam;
+   INT32 nOffset = nJob * NEO_DECODE_CHUNK;
+   INT32 nSize = pJob->nSize - nOffset;
+
+   if (nSize > NEO_DECODE_CHUNK)
+      nSize = NEO_DECODE_CHUNK;
+
+   NeoDecodeTiles(pJob->pStart + nOffset, pJob->pStart + nOffset, nSize >> 7, false, pJob->pAttrib ? pJob->pAttrib + (nOffset >> 7) : NULL);
+}
+
+void NeoDecodeSprites(UINT8* pDest, INT32 nSize, UINT32* pAttrib)
 {
    //	double dProgress = 0.0;
 
@@ -253,11 +430,14 @@ void NeoDecodeSprites(UINT8* pDest, INT32 nSize)
 #else
       INT32 SpriteNum = 8;
 #endif
+   UINT64 nProfile = BurnProfileStart();
 
    for (INT32 i = 0; i < SpriteNum; i++) {
+      struct NeoDecodeJob Job;
 
-      UINT8* pStart = pDest + i * (nSize >> 3);
-      UINT8* pEnd = pStart + (nSize >> 3);
+      Job.pStart = pDest + i * (nSize >> 3);
+      Job.nSize = nSize >> 3;
+      Job.pAttrib = pAttrib ? pAttrib + ((i * (nSize >> 3)) >> 7) : NULL;
 
       //		BurnUpdateProgress(dProgress, i ? NULL : _T("Preprocessing graphics...")/*, BST_PROCESS_GRA*/, 0);
 
@@ -268,77 +448,17 @@ void NeoDecodeSprites(UINT8* pDest, INT32 nSize)
       BurnUpdateProgress(1.0 / nStep, i ? NULL : _T("Preprocessing graphics..."), 0);
 
       // Pre-process the sprite graphics
-      for (UINT8* pTile = pStart; pTile < pEnd; pTile += 128) {
-         UINT32 data[32];
-
-         for (INT32 y = 0; y < 16; y++) {
-            UINT32 n = 0;
-            for (INT32 x = 0; x < 8; x++) {
-               UINT32 m = ((pTile[67 + (y << 2)] >> x) & 1) << 3;
-               m |= ((pTile[65 + (y << 2)] >> x) & 1) << 2;
-               m |= ((pTile[66 + (y << 2)] >> x) & 1) << 1;
-               m |= ((pTile[64 + (y << 2)] >> x) & 1) << 0;
-
-               n |= m << (x << 2);
-            }
-            data[(y << 1) + 0] = n;
-
-            n = 0;
-            for (INT32 x = 0; x < 8; x++) {
-               UINT32 m = ((pTile[3 + (y << 2)] >> x) & 1) << 3;
-               m |= ((pTile[1 + (y << 2)] >> x) & 1) << 2;
-               m |= ((pTile[2 + (y << 2)] >> x) & 1) << 1;
-               m |= ((pTile[0 + (y << 2)] >> x) & 1) << 0;
-
-               n |= m << (x << 2);
-            }
-            data[(y << 1) + 1] = n;
-         }
-         for (INT32 n = 0; n < 32; n++) {
-            ((UINT32*)pTile)[n] = data[n];
-         }
-      }
+      BurnThreadRun(NeoDecodeSpriteChunk, &Job, (Job.nSize + NEO_DECODE_CHUNK - 1) / NEO_DECODE_CHUNK);
    }
+
+   BurnProfileStop("NeoDecodeSprites", nProfile, nSize);
 }
 
-// Graphics decoding for Neo CD
+// Graphics decoding for Neo CD, called while running so it stays on the calling thread
 
 void NeoDecodeSpritesCD(UINT8* pData, UINT8* pDest, INT32 nSize)
 {
-   UINT8* pEnd = pData + nSize;
-
-   for (UINT8* pTile = pData; pTile < pEnd; pTile += 128, pDest += 128) {
-      UINT32 data[32];
-
-      for (INT32 y = 0; y < 16; y++) {
-         UINT32 n = 0;
-
-         for (INT32 x = 0; x < 8; x++) {
-            UINT32 m = ((pTile[67 + (y << 2)] >> x) & 1) << 3;
-            m |= ((pTile[66 + (y << 2)] >> x) & 1) << 2;
-            m |= ((pTile[65 + (y << 2)] >> x) & 1) << 1;
-            m |= ((pTile[64 + (y << 2)] >> x) & 1) << 0;
-
-            n |= m << (x << 2);
-         }
-         data[(y << 1) + 0] = n;
-
-         n = 0;
-         for (INT32 x = 0; x < 8; x++) {
-            UINT32 m = ((pTile[3 + (y << 2)] >> x) & 1) << 3;
-            m |= ((pTile[2 + (y << 2)] >> x) & 1) << 2;
-            m |= ((pTile[1 + (y << 2)] >> x) & 1) << 1;
-            m |= ((pTile[0 + (y << 2)] >> x) & 1) << 0;
-
-            n |= m << (x << 2);
-         }
-         data[(y << 1) + 1] = n;
-      }
-
-      for (INT32 n = 0; n < 32; n++) {
-         ((UINT32*)pDest)[n] = data[n];
-      }
-   }
+   NeoDecodeTiles(pData, pDest, nSize >> 7, true, NULL);
 }
 
 // ----------------------------------------------------------------------------
@@ -349,22 +469,24 @@ INT32 NeoLoadADPCM(INT32 nOffset, INT32 nNum, UINT8* pDest)
    ri.nType = 0;
    ri.nLen = 0;
 
+   UINT64 nProfile = BurnProfileStart();
+
    BurnDrvGetRomInfo(&ri, nOffset);
 
    for (INT32 i = 0; i < nNum; i++)
       BurnLoadRom(pDest + ri.nLen * i, nOffset + i, 1);
 
+   BurnProfileStop("NeoLoadADPCM", nProfile, (UINT64)ri.nLen * nNum);
+
    return 0;
 }
 
-// This function fills the screen with the first palette entry
-void NeoClearScreen()
+// Fill the screen with the backdrop colour (palette entry 0x0FFF)
+void NeoClearScreen(UINT32 nColour)
 {
-   UINT32 nColour = NeoPalette[0x0FFF];
-
    if (nColour)
    {
-      UINT32* pClear = (UINT32*)pBurnDraw;
+      UINT32* pClear = (UINT32*)pNeoRenderDraw;
       nColour |= nColour << 16;
       for (INT32 i = 0; i < nNeoScreenWidth * 224 / 16; i++)
       {
@@ -379,5 +501,5 @@ void NeoClearScreen()
       }
    }
    else
-      memset(pBurnDraw, 0, nNeoScreenWidth * 224 * nBurnBpp);
+      memset(pNeoRenderDraw, 0, nNeoScreenWidth * 224 * nBurnBpp);
 }
@@ -1,6 +1,8 @@
 #include "burnint.h"
 #include "m68000_intf.h"
 #include "z80_intf.h"
+#include "burn_thread.h"
+#include "burn_profile.h"
 #include <boolean.h>
 
 // Uncomment the following line to make the display the full 320 pixels wide
@@ -41,12 +43,12 @@ extern struct NEO_CALLBACK  NeoCallback[MAX_SLOT];
 extern struct NEO_CALLBACK* NeoCallbackActive;
 
 // neogeo.cpp
-void NeoClearScreen();
+void NeoClearScreen(UINT32 nColour);
 INT32 NeoLoadCode(INT32 nOffset, INT32 nNum, UINT8* pDest);
 INT32 NeoLoadSprites(INT32 nOffset, INT32 nNum, UINT8* pDest, UINT32 nSpriteSize);
 INT32 NeoLoadADPCM(INT32 nOffset, INT32 nNum, UINT8* pDest);
 
-void NeoDecodeSprites(UINT8* pDest, INT32 nSize);
+void NeoDecodeSprites(UINT8* pDest, INT32 nSize, UINT32* pAttrib);
 void NeoDecodeSpritesCD(UINT8* pData, UINT8* pDest, INT32 nSize);
 
 // neo_run.cpp
@@ -98,9 +100,10 @@ void NeoUpdateVector();
 // neo_palette.cpp
 extern UINT8* NeoPalSrc[2];
 extern INT32 nNeoPaletteBank;
-extern UINT32* NeoPalette;
+extern UINT16* NeoPalette;
 
 extern UINT8 NeoRecalcPalette;
+extern UINT32 nNeoPaletteGeneration;
 
 INT32 NeoInitPalette();
 void NeoExitPalette();
@@ -136,17 +139,54 @@ extern bool BurnUseCache;
 #endif
 
 extern INT32 nNeoSpriteFrame;
+extern UINT32 nNeoGraphicsGeneration;
 extern UINT32 nNeoTileMask[MAX_SLOT];
 extern INT32 nNeoMaxTile[MAX_SLOT];
+extern UINT32* NeoTileAttrib[MAX_SLOT];
+extern INT32 nNeoSpriteROMBudget;
 
-extern INT32 nSliceStart, nSliceEnd, nSliceSize;
+extern BURN_THREAD_LOCAL INT32 nSliceStart, nSliceEnd, nSliceSize;
+
+extern bool bNeoSpriteListDirty;
+extern bool bNeoLineRenderer;
 
 void NeoUpdateSprites(INT32 nOffset, INT32 nSize);
 void NeoSetSpriteSlot(INT32 nSlot);
+void NeoSpritePageTrim();
+UINT32* NeoAllocTileAttrib(INT32 nSlot);
+UINT32 NeoCalcTileAttrib(const UINT8* pTile);
 INT32 NeoInitSprites(INT32 nSlot);
 void NeoExitSprites(INT32 nSlot);
+INT32 NeoSpriteStart();
 INT32 NeoRenderSprites();
 
+// neo_pipeline.cpp
+extern UINT8* pNeoRenderDraw;
+extern UINT8* NeoRenderVRAM;
+extern UINT16* NeoRenderPalette;
+extern INT32 nNeoRenderSpriteFrame, nNeoRenderSpriteStart;
+extern bool bNeoRenderTextBIOS;
+extern bool bNeoRenderPipeline;
+extern bool bNeoRenderSkipUnchanged, bNeoRenderUnchanged;
+
+void NeoRenderFlush();
+void NeoRenderClear(bool bPipeline);
+void NeoRenderSlice();
+void NeoRenderFinish(bool bText);
+void NeoRenderExit();
+
+// neo_cache.cpp
+struct NeoCacheRegion {
+	UINT8** ppData;
+	UINT32 nLen;
+};
+
+INT32 NeoCacheLoad(struct NeoCacheRegion* pRegion, INT32 nRegions, UINT32** pSize, INT32 nSizes);
+void NeoCacheSave(struct NeoCacheRegion* pRegion, INT32 nRegions, UINT32** pSize, INT32 nSizes);
+bool NeoCacheMapped(INT32 nSlot, const UINT8* pData);
+INT32 NeoCacheDiscard(UINT8* pData, UINT32 nLen);
+void NeoCacheExit(INT32 nSlot);
+
 // neo_decrypt.cpp
 extern UINT8 nNeoProtectionXor;
 
@@ -23,7 +23,18 @@ static INT32 LoadRom(UINT8 *Dest, INT32 i, INT32 nGap, INT32 bXor)
 
   if (nLen<=0) return 1;
 
-  if (nGap>1 || bXor)
+  if (nGap>1 && !bXor && BurnExtLoadRomSink && !bDoIpsPatch)
+  {
+    // Stream the rom straight into Dest. Like a plain load, a failed one may
+    // leave Dest partly written. XOR loads still go through a copy, so Dest
+    // is never left half XORed.
+    struct BurnRomSink Sink;
+    Sink.pDest=Dest; Sink.nGap=nGap; Sink.nLen=nLen; Sink.nPos=0;
+
+    nRet=BurnExtLoadRomSink(&Sink,NULL,i);
+    if (nRet!=0) return 1;
+  }
+  else if (nGap>1 || bXor)
   {
     UINT8 *Load=NULL;
     UINT8 *pd=NULL,*pl=NULL,*LoadEnd=NULL;
@@ -71,6 +82,29 @@ static INT32 LoadRom(UINT8 *Dest, INT32 i, INT32 nGap, INT32 bXor)
   return 0;
 }
 
+// Put the next nLen bytes of a streamed rom in place
+void BurnRomSinkWrite(struct BurnRomSink* pSink, const UINT8* pSrc, INT32 nLen)
+{
+  UINT8 *pd=NULL;
+  const UINT8 *pEnd=NULL;
+
+  if (nLen>pSink->nLen-pSink->nPos) nLen=pSink->nLen-pSink->nPos;
+  if (nLen<=0) return;
+
+  pd=pSink->pDest+pSink->nPos*pSink->nGap;
+  pEnd=pSrc+nLen;
+  pSink->nPos+=nLen;
+
+  if (pSink->nGap==1)
+  {
+    memcpy(pd,pSrc,nLen);
+  }
+  else
+  {
+    do { *pd  = *pSrc++; pd+=pSink->nGap; } while (pSrc<pEnd);
+  }
+}
+
 INT32 BurnLoadRom(UINT8 *Dest, INT32 i, INT32 nGap)
 {
   return LoadRom(Dest,i,nGap,0);
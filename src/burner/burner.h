@@ -166,8 +166,13 @@ struct ZipEntry { char* szName;	UINT32 nLen; UINT32 nCrc; };
 
 INT32 ZipOpen(char* szZip);
 INT32 ZipClose();
+INT32 ZipKeepOpen(INT32 bKeep);
 INT32 ZipGetList(struct ZipEntry** pList, INT32* pnListCount);
 INT32 ZipLoadFile(UINT8* Dest, INT32 nLen, INT32* pnWrote, INT32 nEntry);
+INT32 ZipPlan(INT32* pEntries, INT32 nCount);
+INT32 ZipLoadFileSink(struct BurnRomSink* pSink, INT32* pnWrote, INT32 nEntry);
+INT32 ZipGetFilePos(INT32 nEntry, UINT32* pnPos);
+INT32 ZipLoadFileAt(char* szZip, INT32 nEntry, UINT32 nPos, UINT8* Dest, INT32 nLen, INT32* pnWrote);
 INT32 __cdecl ZipLoadOneFile(char* arcName, const char* fileName, void** Dest, INT32* pnWrote);
 
 // bzip.cpp
@@ -41,6 +41,11 @@ void wait_for_input(void);
 
 static UINT8 *memptr[MAX_MEM_PTR]; // pointer to allocated memory
 static UINT32 memsize[MAX_MEM_PTR];
+static UINT32 membytes[MAX_MEM_PTR]; // bytes held by each pointer, for the counters below
+
+// bytes currently allocated, and the most there has been (for the start-up profiler)
+UINT64 nBurnMallocBytes = 0;
+UINT64 nBurnMallocPeak = 0;
 
 // this should be called early on... BurnDrvInit?
 
@@ -50,7 +55,9 @@ void BurnInitMemoryManager(void)
 {
    memset (memptr, 0, MAX_MEM_PTR * sizeof(UINT8 **));
    memset (memsize, 0, MAX_MEM_PTR * sizeof(UINT32 *));
+   memset (membytes, 0, sizeof(membytes));
    total_size = 0;
+   nBurnMallocBytes = nBurnMallocPeak = 0;
 }
 
 // should we pass the pointer as a variable here so that we can save a pointer to it
@@ -122,6 +129,12 @@ UINT8 *BurnMalloc(INT32 size)
          }
 
          memset (memptr[i], 0, size); // set contents to 0
+
+         membytes[i] = size;
+         nBurnMallocBytes += size;
+         if (nBurnMallocBytes > nBurnMallocPeak)
+            nBurnMallocPeak = nBurnMallocBytes;
+
          return memptr[i];
       }
    }
@@ -151,6 +164,8 @@ void _BurnFree(void *ptr)
             memsize[i]  = 0;
          }
          memptr[i]   = NULL;
+         nBurnMallocBytes -= membytes[i];
+         membytes[i] = 0;
 			break;
 		}
 	}
@@ -172,7 +187,9 @@ void BurnExitMemoryManager(void)
 
          memptr[i] = NULL;
          memsize[i] = 0;
+         membytes[i] = 0;
 		}
 	}
    total_size = 0;
+   nBurnMallocBytes = 0;
 }
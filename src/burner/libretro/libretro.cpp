@@ -1,9 +1,12 @@
 #include <vector>
 #include <string>
+#include <map>
 #include "libretro.h"
 #include "burner.h"
 #include "input/inp_keys.h"
 #include "state.h"
+#include "burn_thread.h"
+#include "burn_profile.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -43,6 +46,8 @@ struct ROMFIND
 	unsigned int nState;
 	int nArchive;
 	int nPos;
+   unsigned int nDirPos;   // Position in the zip directory, for inflating on another thread
+   bool bDirPos;
    BurnRomInfo ri;
 };
 
@@ -73,6 +78,12 @@ void retro_set_environment(retro_environment_t cb)
       // Use UniBios by default. Original Bios takes a long time to load(about 2 minutes), no idea why.
       { "fba-unibios", "Neo Geo UniBIOS; enabled|disabled" },
       { "fba-cpu-speed-adjust", "CPU Speed Overclock; 100|110|120|130|140|150|160|170|180|190|200" },
+      { "fba-sprite-renderer", "Sprite renderer; tiles|scanline" },
+      { "fba-render-threads", "Render and decrypt threads; 1|2|3|4|6|8" },
+      { "fba-render-pipeline", "Render pipeline (1 frame latency); disabled|enabled" },
+      { "fba-rom-cache", "Cache decoded ROMs in system dir (restart); disabled|enabled" },
+      { "fba-sprite-rom-budget", "Resident sprite ROM in MB with ROM cache (restart); unlimited|16|24|32|48|64" },
+      { "fba-load-profile", "Log load time per phase to save dir (restart); disabled|enabled" },
       { NULL, NULL },
    };
 
@@ -89,7 +100,11 @@ void retro_get_system_info(struct retro_system_info *info)
    info->library_version = FBA_VERSION;
    info->need_fullpath = true;
    info->block_extract = true;
+#ifdef INCLUDE_7Z_SUPPORT
+   info->valid_extensions = "iso|zip|7z";
+#else
    info->valid_extensions = "iso|zip";
+#endif
 }
 
 /////
@@ -108,6 +123,7 @@ void IpsApplyPatches(UINT8 *, char *) {}
 
 TCHAR szAppHiscorePath[MAX_PATH];
 TCHAR szAppSamplesPath[MAX_PATH];
+TCHAR szAppCachePath[MAX_PATH];
 TCHAR szAppBurnVer[16];
 
 CDEmuStatusValue CDEmuStatus;
@@ -229,40 +245,36 @@ char *LabelCheck(char *, char *) { return 0; }
 const int32_t nConfigMinVersion = 0x020921;
 
 // addition to support loading of roms without crc check
-static int find_rom_by_name(char *name, const ZipEntry *list, unsigned elems)
+// Name and CRC lookup over the entries of one archive, first entry wins
+struct ArchiveLookup
 {
-	unsigned i = 0;
-	for (i = 0; i < elems; i++)
-	{
-		if(!strcmp(list[i].szName, name)) 
-			return i; 
-	}
+   std::map<std::string, int> name;
+   std::map<uint32_t, int> crc;
+};
 
-#if 0
-   if (log_cb)
-      log_cb(RETRO_LOG_ERROR, "Not found: %s (name = %s)\n", list[i].szName, name);
-#endif
+static void build_archive_lookup(ArchiveLookup &lookup, const ZipEntry *list, unsigned elems)
+{
+   lookup.name.clear();
+   lookup.crc.clear();
 
-	return -1;
+   for (unsigned i = 0; i < elems; i++)
+   {
+      if (list[i].szName)
+         lookup.name.insert(std::make_pair(std::string(list[i].szName), (int)i));
+      lookup.crc.insert(std::make_pair((uint32_t)list[i].nCrc, (int)i));
+   }
 }
 
-static int find_rom_by_crc(uint32_t crc, const ZipEntry *list, unsigned elems)
+static int find_rom_by_name(const char *name, const ArchiveLookup &lookup)
 {
-	unsigned i = 0;
-   for (i = 0; i < elems; i++)
-   {
-      if (list[i].nCrc == crc)
-	  {
-         return i;
-	  }
-   }
+   std::map<std::string, int>::const_iterator it = lookup.name.find(name);
+   return it != lookup.name.end() ? it->second : -1;
+}
 
-#if 0
-   if (log_cb)
-      log_cb(RETRO_LOG_ERROR, "Not found: 0x%X (crc: 0x%X)\n", list[i].nCrc, crc);
-#endif
-   
-   return -1;
+static int find_rom_by_crc(uint32_t crc, const ArchiveLookup &lookup)
+{
+   std::map<uint32_t, int>::const_iterator it = lookup.crc.find(crc);
+   return it != lookup.crc.end() ? it->second : -1;
 }
 
 static void free_archive_list(ZipEntry *list, unsigned count)
@@ -275,11 +287,217 @@ static void free_archive_list(ZipEntry *list, unsigned count)
    }
 }
 
+#ifdef HAVE_THREADS
+// Parallel inflate. The first ROM the driver asks for starts a background task
+// that inflates it and every later ROM of the set on the worker pool, each
+// through a zip handle of its own. archive_load_rom takes the ROMs as they
+// complete, so the driver decodes one ROM while the next are still inflating.
+#define PREFETCH_NONE      0
+#define PREFETCH_QUEUED    1
+#define PREFETCH_RUNNING   2
+#define PREFETCH_DONE      3
+
+#define PREFETCH_BUDGET    (64 << 20)   // Inflated data waiting to be taken
+
+struct ROMPREFETCH
+{
+   int nState;
+   uint8_t *pData;
+   int32_t nWrote;
+   int32_t nRet;
+};
+
+static ROMPREFETCH g_prefetch[1024];
+static int g_prefetch_list[1024];
+static int g_prefetch_count;
+static bool g_prefetch_enabled, g_prefetch_started, g_prefetch_cancel;
+static size_t g_prefetch_bytes;
+
+static void prefetch_job(void *param, int32_t job)
+{
+   int i = ((int*)param)[job];
+   ROMPREFETCH *p = &g_prefetch[i];
+   size_t len = g_find_list[i].ri.nLen;
+
+   BurnSyncLock();
+   if (g_prefetch_cancel || p->nState != PREFETCH_QUEUED)
+   {
+      BurnSyncUnlock();
+      return;
+   }
+   p->nState = PREFETCH_RUNNING;
+   g_prefetch_bytes += len;
+   BurnSyncUnlock();
+
+   uint8_t *data = (uint8_t*)malloc(len);
+   int32_t wrote = 0;
+   int32_t ret = 1;
+   if (data)
+      ret = ZipLoadFileAt((char*)g_find_list_path[g_find_list[i].nArchive].c_str(), g_find_list[i].nPos, g_find_list[i].nDirPos, data, len, &wrote);
+
+   BurnSyncLock();
+   p->pData = data;
+   p->nWrote = wrote;
+   p->nRet = ret;
+   p->nState = PREFETCH_DONE;
+   BurnSyncSignal();
+   BurnSyncUnlock();
+}
+
+// The ROMs go to the pool in batches that fit in the budget. Only this task
+// waits for the driver to take them, so the pool workers never block and stay
+// free for the driver's own jobs (sprite decryption and decoding).
+static void prefetch_main(void *)
+{
+   int next = 0;
+
+   while (next < g_prefetch_count)
+   {
+      int first;
+      size_t bytes;
+
+      BurnSyncLock();
+      // Don't run too far ahead of the driver
+      while (!g_prefetch_cancel && g_prefetch[g_prefetch_list[next]].nState == PREFETCH_QUEUED && g_prefetch_bytes && g_prefetch_bytes + g_find_list[g_prefetch_list[next]].ri.nLen > PREFETCH_BUDGET)
+         BurnSyncWait();
+      if (g_prefetch_cancel)
+      {
+         BurnSyncUnlock();
+         return;
+      }
+
+      first = next;
+      bytes = g_prefetch_bytes;
+      do
+      {
+         // Taken over by the driver already
+         if (g_prefetch[g_prefetch_list[next]].nState == PREFETCH_QUEUED)
+            bytes += g_find_list[g_prefetch_list[next]].ri.nLen;
+         next++;
+      } while (next < g_prefetch_count && bytes + g_find_list[g_prefetch_list[next]].ri.nLen <= PREFETCH_BUDGET);
+      BurnSyncUnlock();
+
+      BurnThreadRun(prefetch_job, g_prefetch_list + first, next - first);
+   }
+}
+
+static void prefetch_start(int first)
+{
+   g_prefetch_started = true;
+   g_prefetch_count = 0;
+
+   for (unsigned i = first; i < g_rom_count; i++)
+   {
+      const BurnRomInfo &ri = g_find_list[i].ri;
+
+      // BIOS and optional ROMs are mostly alternatives that never get loaded
+      if (!g_find_list[i].bDirPos || ri.nType == 0 || ri.nLen == 0 || (ri.nType & (BRF_BIOS | BRF_OPT | BRF_NODUMP)))
+         continue;
+
+      g_prefetch[i].nState = PREFETCH_QUEUED;
+      g_prefetch_list[g_prefetch_count++] = i;
+   }
+
+   if (g_prefetch_count < 2)
+   {
+      for (int j = 0; j < g_prefetch_count; j++)
+         g_prefetch[g_prefetch_list[j]].nState = PREFETCH_NONE;
+      g_prefetch_count = 0;
+      return;
+   }
+
+   g_prefetch_cancel = false;
+   g_prefetch_bytes = 0;
+   BurnSyncInit();
+   BurnTaskStart(prefetch_main, NULL);
+}
+
+static void prefetch_stop(void)
+{
+   g_prefetch_enabled = false;
+
+   if (g_prefetch_count)
+   {
+      BurnSyncLock();
+      g_prefetch_cancel = true;
+      BurnSyncSignal();
+      BurnSyncUnlock();
+
+      BurnTaskWait();
+      BurnSyncExit();
+   }
+
+   // Anything the driver didn't ask for
+   for (unsigned i = 0; i < g_rom_count; i++)
+   {
+      free(g_prefetch[i].pData);
+      g_prefetch[i].pData = NULL;
+      g_prefetch[i].nState = PREFETCH_NONE;
+   }
+
+   g_prefetch_started = false;
+   g_prefetch_count = 0;
+}
+
+// Returns the inflated ROM (to be freed by the caller) if the prefetch has it
+static uint8_t *prefetch_take(int32_t i, int32_t *wrote, int32_t *ret)
+{
+   if (!g_prefetch_enabled)
+      return NULL;
+
+   if (!g_prefetch_started)
+      prefetch_start(i);
+
+   if (g_prefetch_count == 0)
+      return NULL;
+
+   ROMPREFETCH *p = &g_prefetch[i];
+   uint8_t *data = NULL;
+
+   BurnSyncLock();
+   // Not started yet, cheaper to load it here than to wait for it
+   if (p->nState == PREFETCH_QUEUED)
+      p->nState = PREFETCH_NONE;
+   UINT64 profile = BurnProfileStart();
+   while (p->nState == PREFETCH_RUNNING)
+      BurnSyncWait();
+   BurnProfileStop("PrefetchWait", profile, 0);
+   if (p->nState == PREFETCH_DONE)
+   {
+      p->nState = PREFETCH_NONE;
+      g_prefetch_bytes -= g_find_list[i].ri.nLen;
+      BurnSyncSignal();
+
+      // Out of memory leaves it to the normal path
+      data = p->pData;
+      p->pData = NULL;
+      *wrote = p->nWrote;
+      *ret = p->nRet ? 1 : 0;
+   }
+   BurnSyncUnlock();
+
+   return data;
+}
+#endif
+
 static int32_t archive_load_rom(uint8_t *dest, int32_t *wrote, int32_t i)
 {
    if (i < 0 || i >= g_rom_count)
       return 1;
 
+#ifdef HAVE_THREADS
+   int32_t len, ret;
+   uint8_t *data = prefetch_take(i, &len, &ret);
+   if (data)
+   {
+      memcpy(dest, data, len);
+      free(data);
+      if (wrote)
+         *wrote = len;
+      return ret;
+   }
+#endif
+
    int archive = g_find_list[i].nArchive;
 
    if (ZipOpen((char*)g_find_list_path[archive].c_str()) != 0)
@@ -297,6 +515,40 @@ static int32_t archive_load_rom(uint8_t *dest, int32_t *wrote, int32_t i)
    ZipClose();
    return 0;
 }
+// Same as archive_load_rom, but streams the ROM into a gap destination
+static int32_t archive_load_rom_sink(BurnRomSink *sink, int32_t *wrote, int32_t i)
+{
+   if (i < 0 || i >= g_rom_count)
+      return 1;
+
+#ifdef HAVE_THREADS
+   int32_t len, ret;
+   uint8_t *data = prefetch_take(i, &len, &ret);
+   if (data)
+   {
+      BurnRomSinkWrite(sink, data, len);
+      free(data);
+      if (wrote)
+         *wrote = len;
+      return ret;
+   }
+#endif
+
+   int archive = g_find_list[i].nArchive;
+
+   if (ZipOpen((char*)g_find_list_path[archive].c_str()) != 0)
+      return 1;
+
+   if (ZipLoadFileSink(sink, wrote, g_find_list[i].nPos) != 0)
+   {
+      ZipClose();
+      return 1;
+   }
+
+   ZipClose();
+   return 0;
+}
+
 #ifdef GEKKO
 /* Gets cache directory when using VM for large games. */
 int get_cache_path(char *path)
@@ -368,10 +620,11 @@ static bool open_archive(void)
 		}
 
 		ZipEntry *list = NULL;
-      int32_t count;
+      int32_t count = 0;
 		ZipGetList(&list, &count);
 
-		
+		ArchiveLookup lookup;
+		build_archive_lookup(lookup, list, count);
 
 		// Try to map the ROMs FBA wants to ROMs we find inside our pretty archives ...
 		for (unsigned i = 0; i < g_rom_count; i++)
@@ -394,41 +647,41 @@ static bool open_archive(void)
 				BurnDrvGetRomName(&szPossibleName, i, 0);
 				if(!strcmp(szPossibleName, "asia-s3.rom"))
 				{
-					if(index < 0) { index = find_rom_by_name((char*)"uni-bios_3_2.rom", list, count); }
-					if(index < 0) {	index = find_rom_by_crc(0xA4E8B9B3, list, count); }
-					if(index < 0) { index = find_rom_by_name((char*)"uni-bios_3_1.rom", list, count); }
-					if(index < 0) {	index = find_rom_by_crc(0x0C58093F, list, count); }
-					if(index < 0) { index = find_rom_by_name((char*)"uni-bios_3_0.rom", list, count); }
-					if(index < 0) {	index = find_rom_by_crc(0xA97C89A9, list, count); }
-					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_2_3o.rom", list, count); }
-					if(index < 0) {	index = find_rom_by_crc(0x601720AE, list, count); }
-					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_2_3.rom", list, count); }
-					if(index < 0) {	index = find_rom_by_crc(0x27664EB5, list, count); }
-					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_2_2.rom", list, count); }
-					if(index < 0) {	index = find_rom_by_crc(0x2D50996A, list, count); }
-					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_2_1.rom", list, count); }
-					if(index < 0) {	index = find_rom_by_crc(0x8DABF76B, list, count); }
-					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_2_0.rom", list, count); }
-					if(index < 0) {	index = find_rom_by_crc(0x0C12C2AD, list, count); }
-					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_1_3.rom", list, count); }
-					if(index < 0) {	index = find_rom_by_crc(0xB24B44A0, list, count); }
-					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_1_2o.rom", list, count); }
-					if(index < 0) {	index = find_rom_by_crc(0xE19D3CE9, list, count); }
-					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_1_2.rom", list, count); }
-					if(index < 0) {	index = find_rom_by_crc(0x4FA698E9, list, count); }
-					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_1_1.rom", list, count); }
-					if(index < 0) {	index = find_rom_by_crc(0x5DDA0D84, list, count); }
-					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_1_0.rom", list, count); }
-					if(index < 0) {	index = find_rom_by_crc(0x0CE453A0, list, count); }
+					if(index < 0) { index = find_rom_by_name((char*)"uni-bios_3_2.rom", lookup); }
+					if(index < 0) {	index = find_rom_by_crc(0xA4E8B9B3, lookup); }
+					if(index < 0) { index = find_rom_by_name((char*)"uni-bios_3_1.rom", lookup); }
+					if(index < 0) {	index = find_rom_by_crc(0x0C58093F, lookup); }
+					if(index < 0) { index = find_rom_by_name((char*)"uni-bios_3_0.rom", lookup); }
+					if(index < 0) {	index = find_rom_by_crc(0xA97C89A9, lookup); }
+					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_2_3o.rom", lookup); }
+					if(index < 0) {	index = find_rom_by_crc(0x601720AE, lookup); }
+					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_2_3.rom", lookup); }
+					if(index < 0) {	index = find_rom_by_crc(0x27664EB5, lookup); }
+					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_2_2.rom", lookup); }
+					if(index < 0) {	index = find_rom_by_crc(0x2D50996A, lookup); }
+					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_2_1.rom", lookup); }
+					if(index < 0) {	index = find_rom_by_crc(0x8DABF76B, lookup); }
+					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_2_0.rom", lookup); }
+					if(index < 0) {	index = find_rom_by_crc(0x0C12C2AD, lookup); }
+					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_1_3.rom", lookup); }
+					if(index < 0) {	index = find_rom_by_crc(0xB24B44A0, lookup); }
+					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_1_2o.rom", lookup); }
+					if(index < 0) {	index = find_rom_by_crc(0xE19D3CE9, lookup); }
+					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_1_2.rom", lookup); }
+					if(index < 0) {	index = find_rom_by_crc(0x4FA698E9, lookup); }
+					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_1_1.rom", lookup); }
+					if(index < 0) {	index = find_rom_by_crc(0x5DDA0D84, lookup); }
+					if(index < 0) {	index = find_rom_by_name((char*)"uni-bios_1_0.rom", lookup); }
+					if(index < 0) {	index = find_rom_by_crc(0x0CE453A0, lookup); }
 					
 					// uni-bios not found, try to find regular bios
-					if(index < 0) {	index = find_rom_by_crc(g_find_list[i].ri.nCrc, list, count); }
+					if(index < 0) {	index = find_rom_by_crc(g_find_list[i].ri.nCrc, lookup); }
 
 				} else {
-					index = find_rom_by_crc(g_find_list[i].ri.nCrc, list, count);
+					index = find_rom_by_crc(g_find_list[i].ri.nCrc, lookup);
 				}
 			} else {
-				index = find_rom_by_crc(g_find_list[i].ri.nCrc, list, count);
+				index = find_rom_by_crc(g_find_list[i].ri.nCrc, lookup);
 			}
 
 			if (index < 0)
@@ -438,6 +691,7 @@ static bool open_archive(void)
 			g_find_list[i].nArchive = z;
 			g_find_list[i].nPos = index;
 			g_find_list[i].nState = STAT_OK;
+			g_find_list[i].bDirPos = ZipGetFilePos(index, &g_find_list[i].nDirPos) == 0;
 
 			if (list[index].nLen < g_find_list[i].ri.nLen)
 				g_find_list[i].nState = STAT_SMALL;
@@ -445,6 +699,18 @@ static bool open_archive(void)
 				g_find_list[i].nState = STAT_LARGE;
 		}
 
+		// Let the archive know what it will be asked for (BIOS and optional
+		// ROMs are mostly alternatives that never get loaded)
+		std::vector<int32_t> planned;
+		for (unsigned i = 0; i < g_rom_count; i++)
+		{
+			if (g_find_list[i].nState != STAT_NOFIND && g_find_list[i].nArchive == (int)z && g_find_list[i].ri.nCrc
+					&& !(g_find_list[i].ri.nType & (BRF_BIOS | BRF_OPT | BRF_NODUMP)))
+				planned.push_back(g_find_list[i].nPos);
+		}
+		if (!planned.empty())
+			ZipPlan(&planned[0], planned.size());
+
 		free_archive_list(list, count);
 		ZipClose();
 	}
@@ -464,9 +730,19 @@ static bool open_archive(void)
 	}
 
 	BurnExtLoadRom = archive_load_rom;
+	BurnExtLoadRomSink = archive_load_rom_sink;
 	return true;
 }
 
+extern "C" {
+   void HiscoreApply(void);
+   void NeoFrame(void);
+   extern bool bNeoLineRenderer;
+   extern bool bNeoRenderPipeline;
+   extern bool bNeoRenderSkipUnchanged, bNeoRenderUnchanged;
+   extern INT32 nNeoSpriteROMBudget;
+};
+
 void retro_init()
 {
    struct retro_log_callback log;
@@ -475,6 +751,10 @@ void retro_init()
    else
       log_cb = NULL;
 
+   bool can_dupe = false;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_CAN_DUPE, &can_dupe))
+      bNeoRenderSkipUnchanged = can_dupe;
+
    g_fba_frame = (uint16_t*)malloc(320 * 224 * sizeof(uint16_t));
 	BurnLibInit();
 }
@@ -491,15 +771,12 @@ void retro_deinit()
    }
    driver_inited = false;
    BurnLibExit();
+   BurnTaskExit();
+   BurnThreadExit();
    if (g_fba_frame)
       free(g_fba_frame);
 }
 
-extern "C" {
-   void HiscoreApply(void);
-   void NeoFrame(void);
-};
-
 void retro_reset(void)
 {
    struct GameInp* pgi = GameInp;
@@ -527,6 +804,22 @@ void retro_reset(void)
 
 static bool first_init = true;
 
+// The worker pool is also used while loading, so this is checked before the game is loaded as well
+static void check_thread_variable(void)
+{
+   struct retro_variable var = {0};
+   var.key = "fba-render-threads";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var))
+   {
+      INT32 nThreads = atoi(var.value);
+      if (nThreads != BurnThreadCount()) {
+         BurnTaskWait();
+         BurnThreadInit(nThreads);
+      }
+   }
+}
+
 static void check_variables(void)
 {
    struct retro_variable var = {0};
@@ -608,6 +901,28 @@ static void check_variables(void)
       else if (strcmp(var.value, "200") == 0)
          nBurnCPUSpeedAdjust = 0x0200;
    }
+
+   var.key = "fba-sprite-renderer";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var))
+   {
+      if (!strcmp(var.value, "tiles"))
+         bNeoLineRenderer = false;
+      if (!strcmp(var.value, "scanline"))
+         bNeoLineRenderer = true;
+   }
+
+   check_thread_variable();
+
+   var.key = "fba-render-pipeline";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var))
+   {
+      if (!strcmp(var.value, "disabled"))
+         bNeoRenderPipeline = false;
+      if (!strcmp(var.value, "enabled"))
+         bNeoRenderPipeline = true;
+   }
 }
 
 void retro_run(void)
@@ -631,7 +946,8 @@ void retro_run(void)
    nCurrentFrame++;
    HiscoreApply();
    NeoFrame();
-   video_cb(g_fba_frame, width, height, nBurnPitch);
+   // NULL repeats the previous frame
+   video_cb(bNeoRenderUnchanged ? NULL : g_fba_frame, width, height, nBurnPitch);
    audio_batch_cb(g_audio_buf, nBurnSoundLen);
 
    bool updated = false;
@@ -718,12 +1034,59 @@ int VidRecalcPal()
    return BurnRecalcPal();
 }
 
+// Log the start-up profile and write it to <save dir>/<driver>.loadprofile.json
+static void report_load_profile(void)
+{
+   if (!bBurnProfile)
+      return;
+   bBurnProfile = false;
+
+   char path[1100];
+   snprintf(path, sizeof(path), "%s%c%s.loadprofile.json", g_save_dir, slash, BurnDrvGetTextA(DRV_NAME));
+
+   FILE *fp = fopen(path, "w");
+   if (fp)
+      fprintf(fp, "{\n  \"driver\": \"%s\",\n  \"threads\": %d,\n  \"phases\": [\n", BurnDrvGetTextA(DRV_NAME), BurnThreadCount());
+
+   for (int i = 0; i < BurnProfileCount(); i++)
+   {
+      const BurnProfilePhase *phase = BurnProfileGetPhase(i);
+
+      if (log_cb)
+         log_cb(RETRO_LOG_INFO, "[FBA] Load %-16s %5d calls %9.1f ms %10llu KB, peak alloc %llu KB, peak RSS %llu KB\n",
+               phase->szName, phase->nCalls, phase->nTime / 1000.0, (unsigned long long)(phase->nBytes >> 10),
+               (unsigned long long)(phase->nPeakAlloc >> 10), (unsigned long long)(phase->nPeakRSS >> 10));
+
+      if (fp)
+         fprintf(fp, "    { \"name\": \"%s\", \"calls\": %d, \"time_us\": %llu, \"bytes\": %llu, \"peak_alloc\": %llu, \"peak_rss\": %llu }%s\n",
+               phase->szName, phase->nCalls, (unsigned long long)phase->nTime, (unsigned long long)phase->nBytes,
+               (unsigned long long)phase->nPeakAlloc, (unsigned long long)phase->nPeakRSS, i + 1 < BurnProfileCount() ? "," : "");
+   }
+
+   if (fp)
+   {
+      fprintf(fp, "  ]\n}\n");
+      fclose(fp);
+   }
+}
+
 static bool fba_init(unsigned driver, const char *game_zip_name)
 {
    nBurnDrvActive = driver;
 
-   if (!open_archive())
+   // Keep the archives (and their directory index) open until the driver has loaded its ROMs
+   ZipKeepOpen(1);
+
+   UINT64 profile = BurnProfileStart();
+   bool found = open_archive();
+   BurnProfileStop("open_archive", profile, 0);
+
+   if (!found)
+   {
+      ZipKeepOpen(0);
+      bBurnProfile = false;
       return false;
+   }
 
    nBurnBpp = 2;
    nFMInterpolation = 3;
@@ -731,7 +1094,17 @@ static bool fba_init(unsigned driver, const char *game_zip_name)
    
    char input[128];
 
+#ifdef HAVE_THREADS
+   g_prefetch_enabled = true;
+#endif
+   profile = BurnProfileStart();
    BurnDrvInit();
+#ifdef HAVE_THREADS
+   prefetch_stop();
+#endif
+   ZipKeepOpen(0);
+   BurnProfileStop("BurnDrvInit", profile, 0);
+   report_load_profile();
    sprintf (input, "%s%c%s.fs", g_save_dir, slash, BurnDrvGetTextA(DRV_NAME));
    BurnStateLoad(input, 0, NULL);
 
@@ -859,6 +1232,28 @@ bool retro_load_game(const struct retro_game_info *info)
       log_cb(RETRO_LOG_ERROR, "Save dir not defined => use roms dir %s\n", g_save_dir);
    }
 
+   // The pre-decoded ROM cache is written while the game loads, so check it here
+   szAppCachePath[0] = 0;
+   struct retro_variable var = {0};
+   var.key = "fba-rom-cache";
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value && !strcmp(var.value, "enabled"))
+   {
+      const char *system_dir = NULL;
+      if (environ_cb(RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY, &system_dir) && system_dir)
+         snprintf(szAppCachePath, sizeof(szAppCachePath), "%s%c", system_dir, slash);
+   }
+
+   nNeoSpriteROMBudget = 0;
+   var.key = "fba-sprite-rom-budget";
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      nNeoSpriteROMBudget = atoi(var.value);
+
+   BurnProfileReset();
+   var.key = "fba-load-profile";
+   bBurnProfile = environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value && !strcmp(var.value, "enabled");
+
+   check_thread_variable();
+
    unsigned i = BurnDrvGetIndexByName(basename);
    if (i < nBurnDrvCount)
    {
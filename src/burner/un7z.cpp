@@ -47,6 +47,7 @@
 ***************************************************************************/
 
 #include "un7z.h"
+#include "burn_thread.h"
 
 #include <ctype.h>
 #include <stdlib.h>
@@ -208,6 +209,9 @@ static _7z_file *_7z_cache[_7Z_CACHE_SIZE];
 /* cache management */
 static void free__7z_file(_7z_file *_7z);
 
+/* extraction plan */
+static void _7z_plan_free(_7z_file *_7z);
+
 
 /***************************************************************************
     _7Z FILE ACCESS
@@ -461,6 +465,214 @@ void _7z_file_cache_clear(void)
     from a _7Z into the target buffer
 -------------------------------------------------*/
 
+/*-------------------------------------------------
+    _7z_decode_folder - decode a whole folder
+    (solid block) into a new buffer
+-------------------------------------------------*/
+
+static SRes _7z_decode_folder(_7z_file *_7z, ILookInStream *stream, UInt32 folderIndex, Byte **buffer)
+{
+	const CSzArEx *p = &_7z->db;
+	CSzFolder *folder = p->db.Folders + folderIndex;
+	UInt64 unpackSizeSpec = SzFolder_GetUnpackSize(folder);
+	size_t unpackSize = (size_t)unpackSizeSpec;
+	UInt64 startOffset = SzArEx_GetFolderStreamPos(p, folderIndex, 0);
+
+	*buffer = NULL;
+	if (unpackSize != unpackSizeSpec || unpackSize == 0)
+		return SZ_ERROR_MEM;
+
+	RINOK(LookInStream_SeekTo(stream, startOffset));
+
+	Byte *out = (Byte *)IAlloc_Alloc(&_7z->allocImp, unpackSize);
+	if (out == NULL)
+		return SZ_ERROR_MEM;
+
+	SRes res = SzFolder_Decode(folder, p->db.PackSizes + p->FolderStartPackStreamIndex[folderIndex], stream, startOffset, out, unpackSize, &_7z->allocTempImp);
+	if (res == SZ_OK && folder->UnpackCRCDefined && CrcCalc(out, unpackSize) != folder->UnpackCRC)
+		res = SZ_ERROR_CRC;
+
+	if (res != SZ_OK) {
+		IAlloc_Free(&_7z->allocImp, out);
+		return res;
+	}
+
+	*buffer = out;
+	return SZ_OK;
+}
+
+
+/*-------------------------------------------------
+    _7z_file_plan - decode the folders holding
+    the given files up front, several at once,
+    and keep each until all its planned files
+    have been decompressed
+-------------------------------------------------*/
+
+/* don't decode ahead when the planned folders are bigger than this */
+#define _7Z_PLAN_BUDGET		(256 << 20)
+
+struct _7z_plan_job
+{
+	_7z_file *_7z;
+	UInt32 *folders;
+};
+
+static void _7z_plan_decode(void *param, INT32 job)
+{
+	_7z_plan_job *plan = (_7z_plan_job *)param;
+	_7z_file *_7z = plan->_7z;
+	UInt32 folderIndex = plan->folders[job];
+
+	/* every job reads through a file handle of its own */
+	CFileInStream archiveStream;
+	CLookToRead lookStream;
+
+	archiveStream.file._7z_currfpos = 0;
+	archiveStream.file._7z_length = _7z->archiveStream.file._7z_length;
+	archiveStream.file._7z_osdfile = fopen(_7z->filename, "rb");
+	if (archiveStream.file._7z_osdfile == NULL)
+		return;
+
+	FileInStream_CreateVTable(&archiveStream);
+	LookToRead_CreateVTable(&lookStream, False);
+	lookStream.realStream = &archiveStream.s;
+	LookToRead_Init(&lookStream);
+
+	/* a folder that fails is decoded again on demand */
+	_7z_decode_folder(_7z, &lookStream.s, folderIndex, &_7z->planBuffer[folderIndex]);
+
+	fclose(archiveStream.file._7z_osdfile);
+}
+
+_7z_error _7z_file_plan(_7z_file *_7z, const int *files, int count)
+{
+	const CSzArEx *p = &_7z->db;
+
+	_7z_plan_free(_7z);
+
+	if (p->db.NumFolders == 0 || count <= 0)
+		return _7ZERR_NONE;
+
+	_7z->planBuffer = (Byte **)calloc(p->db.NumFolders, sizeof(Byte *));
+	_7z->planRefs = (UInt32 *)calloc(p->db.NumFolders, sizeof(UInt32));
+	_7z->planFile = (Byte *)calloc(p->db.NumFiles, sizeof(Byte));
+	if (_7z->planBuffer == NULL || _7z->planRefs == NULL || _7z->planFile == NULL)
+	{
+		_7z_plan_free(_7z);
+		return _7ZERR_OUT_OF_MEMORY;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		if (files[i] < 0 || (UInt32)files[i] >= p->db.NumFiles || _7z->planFile[files[i]])
+			continue;
+
+		UInt32 folderIndex = p->FileIndexToFolderIndexMap[files[i]];
+		if (folderIndex == (UInt32)-1)
+			continue;
+
+		_7z->planFile[files[i]] = 1;
+		_7z->planRefs[folderIndex]++;
+	}
+
+	/* the blocks are independent, so decode them side by side */
+	UInt32 *folders = (UInt32 *)malloc(p->db.NumFolders * sizeof(UInt32));
+	UInt64 total = 0;
+	INT32 numFolders = 0;
+
+	if (folders == NULL)
+		return _7ZERR_NONE;
+
+	for (UInt32 i = 0; i < p->db.NumFolders; i++)
+	{
+		if (_7z->planRefs[i] == 0)
+			continue;
+
+		folders[numFolders++] = i;
+		total += SzFolder_GetUnpackSize(p->db.Folders + i);
+	}
+
+	if (numFolders > 1 && total <= _7Z_PLAN_BUDGET)
+	{
+		_7z_plan_job plan = { _7z, folders };
+		BurnThreadRun(_7z_plan_decode, &plan, numFolders);
+	}
+
+	free(folders);
+
+	return _7ZERR_NONE;
+}
+
+
+/*-------------------------------------------------
+    _7z_plan_take - decompress a planned file from
+    its folder, returns false if not planned
+-------------------------------------------------*/
+
+static bool _7z_plan_take(_7z_file *_7z, int index, void *buffer, UINT32 length, UINT32 *Processed, _7z_error *err)
+{
+	const CSzArEx *p = &_7z->db;
+
+	if (_7z->planFile == NULL || !_7z->planFile[index])
+		return false;
+
+	UInt32 folderIndex = p->FileIndexToFolderIndexMap[index];
+
+	if (_7z->planBuffer[folderIndex] == NULL)
+	{
+		if (_7z_decode_folder(_7z, &_7z->lookStream.s, folderIndex, &_7z->planBuffer[folderIndex]) != SZ_OK)
+			return false;
+	}
+
+	const CSzFileItem *fileItem = p->db.Files + index;
+	size_t offset = 0;
+	for (UInt32 i = p->FolderStartFileIndex[folderIndex]; i < (UInt32)index; i++)
+		offset += (size_t)p->db.Files[i].Size;
+
+	size_t size = (size_t)fileItem->Size;
+	const Byte *data = _7z->planBuffer[folderIndex] + offset;
+
+	*err = _7ZERR_NONE;
+	if (offset + size > (size_t)SzFolder_GetUnpackSize(p->db.Folders + folderIndex))
+		*err = _7ZERR_FILE_CORRUPT;
+	else if (fileItem->CrcDefined && CrcCalc(data, size) != fileItem->Crc)
+		*err = _7ZERR_FILE_CORRUPT;
+
+	if (*err == _7ZERR_NONE)
+	{
+		memcpy(buffer, data, size < length ? size : length);
+		*Processed = size;
+	}
+
+	/* the last planned file of a folder frees it */
+	_7z->planFile[index] = 0;
+	if (--_7z->planRefs[folderIndex] == 0)
+	{
+		IAlloc_Free(&_7z->allocImp, _7z->planBuffer[folderIndex]);
+		_7z->planBuffer[folderIndex] = NULL;
+	}
+
+	return true;
+}
+
+static void _7z_plan_free(_7z_file *_7z)
+{
+	if (_7z->planBuffer)
+	{
+		for (UInt32 i = 0; i < _7z->db.db.NumFolders; i++)
+			IAlloc_Free(&_7z->allocImp, _7z->planBuffer[i]);
+	}
+
+	free(_7z->planBuffer);
+	free(_7z->planRefs);
+	free(_7z->planFile);
+	_7z->planBuffer = NULL;
+	_7z->planRefs = NULL;
+	_7z->planFile = NULL;
+}
+
+
 _7z_error _7z_file_decompress(_7z_file *new_7z, void *buffer, UINT32 length, UINT32 *Processed)
 {
 	SRes res;
@@ -476,6 +688,10 @@ _7z_error _7z_file_decompress(_7z_file *new_7z, void *buffer, UINT32 length, UIN
 		}
 	}
 
+	_7z_error err;
+	if (_7z_plan_take(new_7z, index, buffer, length, Processed, &err))
+		return err;
+
 	size_t offset = 0;
 	size_t outSizeProcessed = 0;
 
@@ -516,6 +732,7 @@ static void free__7z_file(_7z_file *_7z)
 
 
 		if (_7z->outBuffer) IAlloc_Free(&_7z->allocImp, _7z->outBuffer);
+		_7z_plan_free(_7z);
 		if (_7z->inited) SzArEx_Free(&_7z->db, &_7z->allocImp);
 	
 
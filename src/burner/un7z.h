@@ -53,6 +53,10 @@
 
 #include "driver.h"
 
+#ifndef __cplusplus
+ #include <stdbool.h>
+#endif
+
 #define ARRAY_LENGTH(x)		(sizeof(x) / sizeof(x[0]))
 
 #include "7z.h"
@@ -60,6 +64,10 @@
 #include "7zVersion.h"
 
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 void *SZipAlloc(void *p, size_t size);
 void SZipFree(void *p, void *address);
 void *SZipAllocTemp(void *p, size_t size);
@@ -150,6 +158,11 @@ struct __7z_file
 	UInt32 blockIndex;// = 0xFFFFFFFF; /* it can have any value before first call (if outBuffer = 0) */
 	Byte *outBuffer;// = 0; /* it must be 0 before first call for each new archive. */
 	size_t outBufferSize;// = 0;  /* it can have any value before first call (if outBuffer = 0) */
+
+	// extraction plan (see _7z_file_plan)
+	Byte **planBuffer;						/* decoded folders, NumFolders entries */
+	UInt32 *planRefs;						/* planned files of each folder not yet taken */
+	Byte *planFile;							/* files still to be taken, NumFiles entries */
 };
 
 
@@ -179,5 +192,12 @@ int _7z_search_crc_match(_7z_file *new_7z, UINT32 crc, const char *search_filena
 /* decompress the most recently found file in the _7Z */
 _7z_error _7z_file_decompress(_7z_file *new_7z, void *buffer, UINT32 length, UINT32 *Processed);
 
+/* tell the _7Z which files are going to be decompressed, so every solid block is decoded only once */
+_7z_error _7z_file_plan(_7z_file *_7z, const int *files, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
 
 #endif	/* __UN_7Z_H__ */
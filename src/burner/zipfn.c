@@ -1,5 +1,6 @@
 // Zip module
 #include "burner.h"
+#include "burn_profile.h"
 #include "unzip.h"
 
 #ifdef INCLUDE_7Z_SUPPORT
@@ -15,17 +16,160 @@ static INT32 nFileType = ZIPFN_FILETYPE_NONE;
 static unzFile Zip = NULL;
 static INT32 nCurrFile = 0; // The current file we are pointing to
 
+// Central directory position of every entry in the zip, so an entry can be
+// reached with a single seek instead of walking the directory up to it
+static unz_file_pos* ZipEntryPos = NULL;
+static INT32 nZipEntries = 0;
+
 #ifdef INCLUDE_7Z_SUPPORT
 static _7z_file* _7ZipFile = NULL;
 #endif
 
+// Archives closed while ZipKeepOpen is active are parked here, and a later
+// ZipOpen of the same name picks them up again (directory index included)
+#define ZIPFN_MAX_HELD			32
+
+struct ZipHeldArchive {
+	INT32 bUsed;
+	char szName[MAX_PATH];
+	INT32 nFileType;
+	unzFile Zip;
+	unz_file_pos* ZipEntryPos;
+	INT32 nZipEntries;
+#ifdef INCLUDE_7Z_SUPPORT
+	_7z_file* _7ZipFile;
+#endif
+};
+
+static struct ZipHeldArchive ZipHeld[ZIPFN_MAX_HELD];
+static INT32 bZipKeepOpen = 0;
+static char szZipCurrName[MAX_PATH] = "";
+
+static INT32 ZipUnhold(char* szZip)
+{
+	for (INT32 i = 0; i < ZIPFN_MAX_HELD; i++) {
+		if (!ZipHeld[i].bUsed || strcmp(ZipHeld[i].szName, szZip)) continue;
+
+		nFileType = ZipHeld[i].nFileType;
+		Zip = ZipHeld[i].Zip;
+		ZipEntryPos = ZipHeld[i].ZipEntryPos;
+		nZipEntries = ZipHeld[i].nZipEntries;
+#ifdef INCLUDE_7Z_SUPPORT
+		_7ZipFile = ZipHeld[i]._7ZipFile;
+#endif
+		memset(&ZipHeld[i], 0, sizeof(ZipHeld[i]));
+
+		if (nFileType == ZIPFN_FILETYPE_ZIP) unzGoToFirstFile(Zip);
+		nCurrFile = 0;
+
+		return 0;
+	}
+
+	return 1;
+}
+
+static INT32 ZipHold()
+{
+	for (INT32 i = 0; i < ZIPFN_MAX_HELD; i++) {
+		if (ZipHeld[i].bUsed) continue;
+
+		ZipHeld[i].bUsed = 1;
+		strcpy(ZipHeld[i].szName, szZipCurrName);
+		ZipHeld[i].nFileType = nFileType;
+		ZipHeld[i].Zip = Zip;
+		ZipHeld[i].ZipEntryPos = ZipEntryPos;
+		ZipHeld[i].nZipEntries = nZipEntries;
+#ifdef INCLUDE_7Z_SUPPORT
+		ZipHeld[i]._7ZipFile = _7ZipFile;
+		_7ZipFile = NULL;
+#endif
+		Zip = NULL;
+		ZipEntryPos = NULL;
+		nZipEntries = 0;
+		nFileType = ZIPFN_FILETYPE_NONE;
+
+		return 0;
+	}
+
+	return 1;
+}
+
+// Keep archives open across ZipClose/ZipOpen (e.g. while a driver loads its
+// ROMs one by one), ZipKeepOpen(0) closes everything that was kept
+INT32 ZipKeepOpen(INT32 bKeep)
+{
+	if (bKeep) {
+		bZipKeepOpen = 1;
+		return 0;
+	}
+
+	bZipKeepOpen = 0;
+	ZipClose();
+
+	for (INT32 i = 0; i < ZIPFN_MAX_HELD; i++) {
+		if (ZipHeld[i].bUsed && ZipUnhold(ZipHeld[i].szName) == 0) ZipClose();
+	}
+
+	return 0;
+}
+
+// Walk the central directory once and remember where every entry is
+static INT32 ZipIndex()
+{
+	unz_global_info ZipGlobalInfo;
+	memset(&ZipGlobalInfo, 0, sizeof(ZipGlobalInfo));
+
+	if (ZipEntryPos) {
+		free(ZipEntryPos);
+		ZipEntryPos = NULL;
+	}
+	nZipEntries = 0;
+
+	unzGetGlobalInfo(Zip, &ZipGlobalInfo);
+	INT32 nListLen = ZipGlobalInfo.number_entry;
+	if (nListLen <= 0) return 1;
+
+	ZipEntryPos = (unz_file_pos*)malloc(nListLen * sizeof(unz_file_pos));
+	if (ZipEntryPos == NULL) return 1;
+
+	INT32 nRet = unzGoToFirstFile(Zip);
+	for (nCurrFile = 0; nCurrFile < nListLen && nRet == UNZ_OK; nCurrFile++, nRet = unzGoToNextFile(Zip)) {
+		unzGetFilePos(Zip, &ZipEntryPos[nCurrFile]);
+	}
+	nZipEntries = nCurrFile;
+
+	unzGoToFirstFile(Zip);
+	nCurrFile = 0;
+
+	return 0;
+}
+
+static INT32 ZipOpenArchive(char* szZip);
+
 INT32 ZipOpen(char* szZip)
+{
+	UINT64 nProfile = BurnProfileStart();
+	INT32 nRet = ZipOpenArchive(szZip);
+	BurnProfileStop("ZipOpen", nProfile, 0);
+
+	return nRet;
+}
+
+static INT32 ZipOpenArchive(char* szZip)
 {
 	nFileType = ZIPFN_FILETYPE_NONE;
 	
 	if (szZip == NULL) return 1;
+
+	if (bZipKeepOpen && ZipUnhold(szZip) == 0) {
+		strcpy(szZipCurrName, szZip);
+		return 0;
+	}
 	
 	char szFileName[MAX_PATH];
+
+	szZipCurrName[0] = 0;
+	if (strlen(szZip) < sizeof(szZipCurrName)) strcpy(szZipCurrName, szZip);
 	
 	sprintf(szFileName, "%s.zip", szZip);
 	Zip = unzOpen(szFileName);
@@ -53,6 +197,16 @@ INT32 ZipOpen(char* szZip)
 
 INT32 ZipClose()
 {
+	if (bZipKeepOpen && nFileType != ZIPFN_FILETYPE_NONE && szZipCurrName[0]) {
+		if (ZipHold() == 0) return 0;
+	}
+
+	if (ZipEntryPos) {
+		free(ZipEntryPos);
+		ZipEntryPos = NULL;
+	}
+	nZipEntries = 0;
+
 	if (nFileType == ZIPFN_FILETYPE_ZIP) {
 		if (Zip != NULL) {
 			unzClose(Zip);
@@ -63,6 +217,7 @@ INT32 ZipClose()
 #ifdef INCLUDE_7Z_SUPPORT
 	if (nFileType == ZIPFN_FILETYPE_7ZIP) {
 		if (_7ZipFile != NULL) {
+			_7z_file_plan(_7ZipFile, NULL, 0);
 			_7z_file_close(_7ZipFile);
 			_7ZipFile = NULL;
 		}
@@ -93,11 +248,16 @@ INT32 ZipGetList(struct ZipEntry** pList, INT32* pnListCount)
 
 		// Make an array of File Entries
 		struct ZipEntry* List = (struct ZipEntry *)malloc(nListLen * sizeof(struct ZipEntry));
-		if (List == NULL) { unzClose(Zip); return 1; }
+		if (List == NULL) return 1;
 		memset(List, 0, nListLen * sizeof(struct ZipEntry));
 
 		INT32 nRet = unzGoToFirstFile(Zip);
-		if (nRet != UNZ_OK) { unzClose(Zip); return 1; }
+		if (nRet != UNZ_OK) return 1;
+
+		// Index the entries on the same walk
+		if (ZipEntryPos) free(ZipEntryPos);
+		ZipEntryPos = (unz_file_pos*)malloc(nListLen * sizeof(unz_file_pos));
+		nZipEntries = 0;
 
 		// Step through all of the files, until we get to the end
 		INT32 nNextRet = 0;
@@ -106,6 +266,11 @@ INT32 ZipGetList(struct ZipEntry** pList, INT32* pnListCount)
 			nCurrFile < nListLen && nNextRet == UNZ_OK;
 			nCurrFile++, nNextRet = unzGoToNextFile(Zip))
 		{
+			if (ZipEntryPos) {
+				unzGetFilePos(Zip, &ZipEntryPos[nCurrFile]);
+				nZipEntries = nCurrFile + 1;
+			}
+
 			unz_file_info FileInfo;
 			memset(&FileInfo, 0, sizeof(FileInfo));
 
@@ -196,7 +361,21 @@ INT32 ZipGetList(struct ZipEntry** pList, INT32* pnListCount)
 	return 0;
 }
 
+static INT32 ZipLoadEntry(UINT8* Dest, INT32 nLen, INT32* pnWrote, INT32 nEntry);
+
 INT32 ZipLoadFile(UINT8* Dest, INT32 nLen, INT32* pnWrote, INT32 nEntry)
+{
+	UINT64 nProfile = BurnProfileStart();
+	INT32 nWrote = 0;
+	INT32 nRet = ZipLoadEntry(Dest, nLen, &nWrote, nEntry);
+	BurnProfileStop("ZipLoadFile", nProfile, nWrote);
+
+	if (pnWrote != NULL) *pnWrote = nWrote;
+
+	return nRet;
+}
+
+static INT32 ZipLoadEntry(UINT8* Dest, INT32 nLen, INT32* pnWrote, INT32 nEntry)
 {
 	if (nFileType == ZIPFN_FILETYPE_ZIP && Zip == NULL) return 1;
 
@@ -207,21 +386,13 @@ INT32 ZipLoadFile(UINT8* Dest, INT32 nLen, INT32* pnWrote, INT32 nEntry)
 	INT32 nRet = 0;
 	
 	if (nFileType == ZIPFN_FILETYPE_ZIP) {
-		if (nEntry < nCurrFile)
-		{
-			// We'll have to go through the zip file again to get to our entry
-			nRet = unzGoToFirstFile(Zip);
-			if (nRet != UNZ_OK) return 1;
-			nCurrFile = 0;
-		}
+		if (ZipEntryPos == NULL && ZipIndex()) return 1;
+		if (nEntry < 0 || nEntry >= nZipEntries) return 1;
 
-		// Now step through to the file we need
-		while (nCurrFile < nEntry)
-		{
-			nRet = unzGoToNextFile(Zip);
-			if (nRet != UNZ_OK) return 1;
-			nCurrFile++;
-		}
+		// Seek straight to the entry
+		nRet = unzGoToFilePos(Zip, &ZipEntryPos[nEntry]);
+		if (nRet != UNZ_OK) return 1;
+		nCurrFile = nEntry;
 
 		nRet = unzOpenCurrentFile(Zip);
 		if (nRet != UNZ_OK) return 1;
@@ -257,6 +428,152 @@ INT32 ZipLoadFile(UINT8* Dest, INT32 nLen, INT32* pnWrote, INT32 nEntry)
 	return 0;
 }
 
+// Tell the current archive which entries are going to be loaded. Solid 7z
+// archives decode every block they need once (several at the same time),
+// whatever order the entries are asked for in. Zips need no plan.
+INT32 ZipPlan(INT32* pEntries, INT32 nCount)
+{
+#ifdef INCLUDE_7Z_SUPPORT
+	if (nFileType == ZIPFN_FILETYPE_7ZIP && _7ZipFile != NULL) {
+		if (_7z_file_plan(_7ZipFile, pEntries, nCount) != _7ZERR_NONE) return 1;
+	}
+#else
+	(void)pEntries;
+	(void)nCount;
+#endif
+
+	return 0;
+}
+
+// Inflate an entry in small pieces and hand them to a rom sink, so the
+// caller never needs a buffer for the whole file
+#define ZIPFN_SINK_CHUNK		(0x10000)
+
+static INT32 ZipLoadEntrySink(struct BurnRomSink* pSink, INT32* pnWrote, INT32 nEntry);
+
+INT32 ZipLoadFileSink(struct BurnRomSink* pSink, INT32* pnWrote, INT32 nEntry)
+{
+	UINT64 nProfile = BurnProfileStart();
+	INT32 nWrote = 0;
+	INT32 nRet = ZipLoadEntrySink(pSink, &nWrote, nEntry);
+	BurnProfileStop("ZipLoadFile", nProfile, nWrote);
+
+	if (pnWrote != NULL) *pnWrote = nWrote;
+
+	return nRet;
+}
+
+static INT32 ZipLoadEntrySink(struct BurnRomSink* pSink, INT32* pnWrote, INT32 nEntry)
+{
+	INT32 nWrote = 0;
+	INT32 nRet = 0;
+
+	if (nFileType == ZIPFN_FILETYPE_ZIP && Zip == NULL) return 1;
+
+#ifdef INCLUDE_7Z_SUPPORT
+	if (nFileType == ZIPFN_FILETYPE_7ZIP) {
+		// 7z members come out in one piece
+		UINT8* Load = (UINT8*)malloc(pSink->nLen);
+		if (Load == NULL) return 1;
+
+		nRet = ZipLoadEntry(Load, pSink->nLen, &nWrote, nEntry);
+		if (nRet == 0) BurnRomSinkWrite(pSink, Load, nWrote);
+		if (pnWrote != NULL) *pnWrote = nWrote;
+
+		free(Load);
+		return nRet;
+	}
+#endif
+
+	if (nFileType != ZIPFN_FILETYPE_ZIP) return 1;
+
+	if (ZipEntryPos == NULL && ZipIndex()) return 1;
+	if (nEntry < 0 || nEntry >= nZipEntries) return 1;
+
+	nRet = unzGoToFilePos(Zip, &ZipEntryPos[nEntry]);
+	if (nRet != UNZ_OK) return 1;
+	nCurrFile = nEntry;
+
+	UINT8* Chunk = (UINT8*)malloc(ZIPFN_SINK_CHUNK);
+	if (Chunk == NULL) return 1;
+
+	nRet = unzOpenCurrentFile(Zip);
+	if (nRet != UNZ_OK) { free(Chunk); return 1; }
+
+	while (nWrote < pSink->nLen) {
+		INT32 nChunk = pSink->nLen - nWrote;
+		if (nChunk > ZIPFN_SINK_CHUNK) nChunk = ZIPFN_SINK_CHUNK;
+
+		nRet = unzReadCurrentFile(Zip, Chunk, nChunk);
+		if (nRet <= 0) break;
+
+		BurnRomSinkWrite(pSink, Chunk, nRet);
+		nWrote += nRet;
+	}
+	free(Chunk);
+
+	// Return how many bytes were copied
+	if (pnWrote != NULL) *pnWrote = nWrote;
+
+	if (nRet < 0) {
+		unzCloseCurrentFile(Zip);
+		return 1;
+	}
+
+	// The CRC is only checked once the whole entry has been read
+	nRet = unzCloseCurrentFile(Zip);
+	if (nRet == UNZ_CRCERROR) return 2;
+	if (nRet != UNZ_OK) return 1;
+
+	return 0;
+}
+
+// Directory position of an entry in the current zip, for ZipLoadFileAt
+INT32 ZipGetFilePos(INT32 nEntry, UINT32* pnPos)
+{
+	if (nFileType != ZIPFN_FILETYPE_ZIP || Zip == NULL) return 1;
+
+	if (ZipEntryPos == NULL && ZipIndex()) return 1;
+	if (nEntry < 0 || nEntry >= nZipEntries) return 1;
+
+	*pnPos = ZipEntryPos[nEntry].pos_in_zip_directory;
+
+	return 0;
+}
+
+// Load an entry of a zip through a handle of its own, so several entries can
+// be inflated at the same time. Doesn't touch the current archive.
+INT32 ZipLoadFileAt(char* szZip, INT32 nEntry, UINT32 nPos, UINT8* Dest, INT32 nLen, INT32* pnWrote)
+{
+	char szFileName[MAX_PATH];
+	unz_file_pos FilePos;
+
+	if (szZip == NULL || strlen(szZip) + 5 > sizeof(szFileName)) return 1;
+
+	sprintf(szFileName, "%s.zip", szZip);
+	unzFile ZipAt = unzOpen(szFileName);
+	if (ZipAt == NULL) return 1;
+
+	FilePos.pos_in_zip_directory = nPos;
+	FilePos.num_of_file = nEntry;
+
+	INT32 nRet = unzGoToFilePos(ZipAt, &FilePos);
+	if (nRet == UNZ_OK) nRet = unzOpenCurrentFile(ZipAt);
+	if (nRet != UNZ_OK) { unzClose(ZipAt); return 1; }
+
+	nRet = unzReadCurrentFile(ZipAt, Dest, nLen);
+	// Return how many bytes were copied
+	if (nRet >= 0 && pnWrote != NULL) *pnWrote = nRet;
+
+	nRet = unzCloseCurrentFile(ZipAt);
+	unzClose(ZipAt);
+
+	if (nRet == UNZ_CRCERROR) return 2;
+	if (nRet != UNZ_OK) return 1;
+
+	return 0;
+}
+
 // Load one file directly, added by regret
 INT32 __cdecl ZipLoadOneFile(char* arcName, const char* fileName, void** Dest, INT32* pnWrote)
 {
@@ -276,7 +593,7 @@ INT32 __cdecl ZipLoadOneFile(char* arcName, const char* fileName, void** Dest, I
 		}
 
 		INT32 nRet = unzGoToFirstFile(Zip);
-		if (nRet != UNZ_OK) { unzClose(Zip); return 1; }
+		if (nRet != UNZ_OK) { ZipClose(); return 1; }
 
 		unz_file_info FileInfo;
 		memset(&FileInfo, 0, sizeof(FileInfo));
@@ -0,0 +1,790 @@
+// A68K check - runs random 68000 programs on A68K and Musashi side by side
+//
+// Build and run with "make A68K=1 a68k-check". Both cores go through the Sek
+// interface, CPU 0 on A68K and CPU 1 on Musashi. Every program is stepped one
+// instruction at a time on both, the registers and the cycles are compared
+// after each step and the RAM every few steps. The first register or RAM
+// difference, or junk left in A68K's Intel flags, stops the run and is printed
+// with the instruction that caused it.
+//
+// Usage: a68k_check [seed [programs [instructions [irq [cycles]]]]]
+//
+// cycles 0 counts the instructions timed differently, 1 also lists each
+// opcode the first time it's timed differently and 2 stops there.
+
+#include "burnint.h"
+#include "m68000_intf.h"
+#include "m68000_debug.h"
+
+// The Sek interface is linked without the rest of the emulator
+BOOL bBurnUseASMCPUEmulation = FALSE;
+INT32 (__cdecl *BurnAcb) (struct BurnArea* pba) = NULL;
+
+void CpuCheatRegister(INT32 nCPU, struct cpu_core_config *config)
+{
+	(void)nCPU;
+	(void)config;
+}
+
+// Memory map
+#define CHECK_ROM_SIZE		(0x080000)
+#define CHECK_RAM_START		(0x100000)
+#define CHECK_RAM_SIZE		(0x010000)
+#define CHECK_SCRATCH		(0x108000)					// Pointer registers A0-A3 point in here
+#define CHECK_PROGRAM		(0x008000)
+
+#define CHECK_HANDLER_RTE	(0x000800)					// rte
+#define CHECK_HANDLER_SKIP	(0x000810)					// Step over the faulting opcode, rte
+#define CHECK_SUBROUTINE	(0x000900)					// addq.l #1,Dn / rts for each Dn
+
+#define CHECK_RAM_INTERVAL	(16)						// Steps between RAM compares
+
+static UINT16 CheckRom[CHECK_ROM_SIZE >> 1];
+static UINT16 CheckRam[2][CHECK_RAM_SIZE >> 1];
+
+static UINT32 nCheckRand;
+
+static UINT32 CheckRand()
+{
+	nCheckRand ^= nCheckRand << 13;
+	nCheckRand ^= nCheckRand >> 17;
+	nCheckRand ^= nCheckRand << 5;
+
+	return nCheckRand;
+}
+
+// ----------------------------------------------------------------------------
+// Program generator
+
+static INT32 nCheckPos;										// Next word of the program
+
+// Words of the instruction being generated, written after any pointer reloads
+static UINT16 CheckIns[16];
+static INT32 nCheckInsLen;
+
+static void CheckEmit(UINT16 nWord)
+{
+	CheckRom[nCheckPos++] = nWord;
+}
+
+static void CheckIns1(UINT16 nWord)
+{
+	CheckIns[nCheckInsLen++] = nWord;
+}
+
+static void CheckInsImm(INT32 nSize, UINT32 nValue)
+{
+	if (nSize == 2)
+		CheckIns1(nValue >> 16);
+	CheckIns1(nSize == 0 ? (nValue & 0xFF) : (nValue & 0xFFFF));
+}
+
+static void CheckInsFlush()
+{
+	for (INT32 i = 0; i < nCheckInsLen; i++)
+		CheckEmit(CheckIns[i]);
+	nCheckInsLen = 0;
+}
+
+// Point An (A0-A3) somewhere safe in the scratch area, word aligned
+static void CheckPointer(INT32 n)
+{
+	UINT32 nAddress = CHECK_SCRATCH + 0x0200 + (CheckRand() % 0x3A00 & ~1);
+
+	CheckEmit(0x41F9 | (n << 9));							// lea $xxxxxx,An
+	CheckEmit(nAddress >> 16);
+	CheckEmit(nAddress & 0xFFFF);
+}
+
+// A4 is the index register of the indexed modes, kept small and even
+static void CheckIndex()
+{
+	CheckEmit(0x49F8);										// lea $xxxx.w,A4
+	CheckEmit(CheckRand() & 0x7E);
+}
+
+// andi.b #$99,<ea>, which leaves only valid BCD digits
+static void CheckBcd(INT32 nEA, const UINT16* pExt, INT32 nExt)
+{
+	CheckEmit(0x0200 | nEA);
+	CheckEmit(0x0099);
+	for (INT32 i = 0; i < nExt; i++)
+		CheckEmit(pExt[i]);
+}
+
+// Addressing modes an instruction accepts
+#define EA_DN		(0x001)
+#define EA_AN		(0x002)
+#define EA_IND		(0x004)
+#define EA_POSTINC	(0x008)
+#define EA_PREDEC	(0x010)
+#define EA_DISP		(0x020)
+#define EA_INDEX	(0x040)
+#define EA_ABSW		(0x080)
+#define EA_ABSL		(0x100)
+#define EA_PCDISP	(0x200)
+#define EA_PCINDEX	(0x400)
+#define EA_IMM		(0x800)
+
+#define EA_MEMALT	(EA_IND | EA_POSTINC | EA_PREDEC | EA_DISP | EA_INDEX | EA_ABSL)
+#define EA_DATAALT	(EA_DN | EA_MEMALT)
+#define EA_ALT		(EA_DATAALT | EA_AN)
+#define EA_DATA		(EA_DATAALT | EA_ABSW | EA_PCDISP | EA_PCINDEX | EA_IMM)
+#define EA_ALL		(EA_DATA | EA_AN)
+#define EA_CONTROL	(EA_IND | EA_DISP | EA_INDEX | EA_ABSW | EA_ABSL | EA_PCDISP | EA_PCINDEX)
+
+// Pick an addressing mode, add its extension words and return the mode/register field
+static INT32 CheckEA(INT32 nAllowed, INT32 nSize)
+{
+	INT32 nKind, nReg = CheckRand() & 3;
+	UINT32 nAddress;
+
+	if (nSize == 0)
+		nAllowed &= ~EA_AN;									// No byte access to address registers
+
+	do {
+		nKind = CheckRand() % 12;
+	} while ((nAllowed & (1 << nKind)) == 0);
+
+	switch (nKind) {
+		case 0:
+			return CheckRand() & 7;
+		case 1:
+			return 0x08 | (CheckRand() % 7);				// A7 is only used as the stack
+		case 2:
+		case 3:
+		case 4:
+			CheckPointer(nReg);
+			return (nKind << 3) | nReg;
+		case 5:
+			CheckPointer(nReg);
+			CheckIns1((CheckRand() & 0x1FE) - 0x100);
+			return 0x28 | nReg;
+		case 6:
+			CheckPointer(nReg);
+			CheckIndex();
+			CheckIns1(0xC000 | (CheckRand() & 0x0800) | (((CheckRand() & 0x7E) - 0x40) & 0xFF));
+			return 0x30 | nReg;
+		case 7:
+			CheckIns1(0x1000 + (CheckRand() % 0x7000 & ~1));	// Random ROM data
+			return 0x38;
+		case 8:
+			nAddress = CHECK_SCRATCH + (CheckRand() % 0x4000 & ~1);
+			CheckIns1(nAddress >> 16);
+			CheckIns1(nAddress & 0xFFFF);
+			return 0x39;
+		case 9:
+			CheckIns1((CheckRand() & 0xFFE) - 0x800);
+			return 0x3A;
+		case 10:
+			CheckIndex();
+			CheckIns1(0xC000 | (CheckRand() & 0x0800) | (((CheckRand() & 0x7E) - 0x40) & 0xFF));
+			return 0x3B;
+		default:
+			CheckInsImm(nSize, CheckRand());
+			return 0x3C;
+	}
+}
+
+// A legal SR value, supervisor mode and no trace
+static UINT16 CheckSR()
+{
+	return (CheckRand() & 0x071F) | 0x2000;
+}
+
+static void CheckInstruction()
+{
+	INT32 nSize = CheckRand() % 3;
+	INT32 nDn = CheckRand() & 7, nDm = CheckRand() & 7;
+	INT32 nAn = CheckRand() % 7;
+	INT32 nCond = CheckRand() & 15;
+	INT32 nOp, nEA, nMove;
+
+	nCheckInsLen = 0;
+
+	switch (CheckRand() % 44) {
+		case 0:												// move
+		case 1:
+			CheckIns1(0);
+			nEA = CheckEA(EA_ALL, nSize);
+			nMove = CheckEA(EA_DATAALT, nSize);
+			CheckIns[0] = ((nSize == 0) ? 0x1000 : (nSize == 1) ? 0x3000 : 0x2000) | (nMove & 7) << 9 | (nMove & 0x38) << 3 | nEA;
+			break;
+		case 2:												// movea
+			nSize = 1 + (CheckRand() & 1);
+			CheckIns1(0);
+			CheckIns[0] = ((nSize == 1) ? 0x3040 : 0x2040) | nAn << 9 | CheckEA(EA_ALL, nSize);
+			break;
+		case 3:												// moveq
+			CheckIns1(0x7000 | nDn << 9 | (CheckRand() & 0xFF));
+			break;
+		case 4:												// add, sub, cmp <ea>,Dn
+		case 5:
+			nOp = (const UINT16[]){ 0xD000, 0x9000, 0xB000 }[CheckRand() % 3];
+			CheckIns1(0);
+			CheckIns[0] = nOp | nDn << 9 | nSize << 6 | CheckEA(EA_ALL, nSize);
+			break;
+		case 6:												// and, or <ea>,Dn
+			nOp = (CheckRand() & 1) ? 0xC000 : 0x8000;
+			CheckIns1(0);
+			CheckIns[0] = nOp | nDn << 9 | nSize << 6 | CheckEA(EA_DATA, nSize);
+			break;
+		case 7:												// add, sub, and, or Dn,<ea>
+			nOp = (const UINT16[]){ 0xD100, 0x9100, 0xC100, 0x8100 }[CheckRand() & 3];
+			CheckIns1(0);
+			CheckIns[0] = nOp | nDn << 9 | nSize << 6 | CheckEA(EA_MEMALT, nSize);
+			break;
+		case 8:												// eor Dn,<ea>
+			CheckIns1(0);
+			CheckIns[0] = 0xB100 | nDn << 9 | nSize << 6 | CheckEA(EA_DATAALT, nSize);
+			break;
+		case 9:												// adda, suba, cmpa
+			nOp = (const UINT16[]){ 0xD0C0, 0x90C0, 0xB0C0 }[CheckRand() % 3];
+			nSize = 1 + (CheckRand() & 1);
+			CheckIns1(0);
+			nEA = CheckEA(EA_ALL, nSize);
+			if ((nEA >> 3) == 3 || (nEA >> 3) == 4)
+				nAn = 4 + (CheckRand() % 3);				// Musashi reads An before (An)+ and -(An) change it
+			CheckIns[0] = nOp | nAn << 9 | (nSize - 1) << 8 | nEA;
+			break;
+		case 10:											// addi, subi, andi, ori, eori, cmpi
+		case 11:
+			nOp = (const UINT16[]){ 0x0600, 0x0400, 0x0200, 0x0000, 0x0A00, 0x0C00 }[CheckRand() % 6];
+			CheckIns1(0);
+			CheckInsImm(nSize, CheckRand());
+			CheckIns[0] = nOp | nSize << 6 | CheckEA(EA_DATAALT, nSize);
+			break;
+		case 12:											// addq, subq
+			nOp = (CheckRand() & 1) ? 0x5000 : 0x5100;
+			CheckIns1(0);
+			CheckIns[0] = nOp | (CheckRand() & 7) << 9 | nSize << 6 | CheckEA(EA_ALT, nSize);
+			break;
+		case 13:											// addx, subx
+			nOp = (CheckRand() & 1) ? 0xD100 : 0x9100;
+			if (CheckRand() & 1) {
+				CheckIns1(nOp | nDn << 9 | nSize << 6 | nDm);
+			} else {
+				nDn &= 3;
+				nDm &= 3;
+				CheckPointer(nDn);
+				CheckPointer(nDm);
+				CheckIns1(nOp | nDn << 9 | nSize << 6 | 0x08 | nDm);
+			}
+			break;
+		case 14:											// abcd, sbcd, nbcd
+			// A68K corrects with the x86 daa/das, which only match the 68000 on
+			// valid digits, so the operands are made valid BCD first
+			nOp = (CheckRand() & 1) ? 0xC100 : 0x8100;
+			switch (CheckRand() % 3) {
+				case 0:
+					CheckBcd(nDn, NULL, 0);
+					CheckBcd(nDm, NULL, 0);
+					CheckIns1(nOp | nDn << 9 | nDm);
+					break;
+				case 1:
+					nDn &= 3;
+					nDm &= 3;
+					CheckPointer(nDn);
+					CheckPointer(nDm);
+					CheckBcd(0x28 | nDn, (const UINT16[]){ 0xFFFF }, 1);
+					CheckBcd(0x28 | nDm, (const UINT16[]){ nDn == nDm ? 0xFFFE : 0xFFFF }, 1);
+					CheckIns1(nOp | nDn << 9 | 0x08 | nDm);
+					break;
+				default:
+					CheckIns1(0);
+					nEA = CheckEA(EA_DATAALT & ~(EA_POSTINC | EA_PREDEC), 0);
+					CheckBcd(nEA, CheckIns + 1, nCheckInsLen - 1);
+					CheckIns[0] = 0x4800 | nEA;
+					break;
+			}
+			break;
+		case 15:											// cmpm
+			nDn &= 3;
+			nDm &= 3;
+			CheckPointer(nDn);
+			CheckPointer(nDm);
+			CheckIns1(0xB108 | nDn << 9 | nSize << 6 | nDm);
+			break;
+		case 16:											// negx, clr, neg, not, tst
+			nOp = (const UINT16[]){ 0x4000, 0x4200, 0x4400, 0x4600, 0x4A00 }[CheckRand() % 5];
+			CheckIns1(0);
+			CheckIns[0] = nOp | nSize << 6 | CheckEA(EA_DATAALT, nSize);
+			break;
+		case 17:											// asd, lsd, roxd, rod Dn
+		case 18:
+			CheckIns1(0xE000 | (CheckRand() & 7) << 9 | (CheckRand() & 1) << 8 | nSize << 6 | (CheckRand() & 0x38) | nDn);
+			break;
+		case 19:											// asd, lsd, roxd, rod <ea>
+			CheckIns1(0);
+			CheckIns[0] = 0xE0C0 | (CheckRand() & 7) << 8 | CheckEA(EA_MEMALT, 1);
+			break;
+		case 20:											// mulu, muls
+			nOp = (CheckRand() & 1) ? 0xC0C0 : 0xC1C0;
+			CheckIns1(0);
+			CheckIns[0] = nOp | nDn << 9 | CheckEA(EA_DATA, 1);
+			break;
+		case 21:											// divu, divs (divide by zero included)
+			nOp = (CheckRand() & 1) ? 0x80C0 : 0x81C0;
+			CheckIns1(0);
+			CheckIns[0] = nOp | nDn << 9 | CheckEA(EA_DATA, 1);
+			break;
+		case 22:											// ext, swap, exg
+			switch (CheckRand() % 6) {
+				case 0: CheckIns1(0x4880 | nDn); break;
+				case 1: CheckIns1(0x48C0 | nDn); break;
+				case 2: CheckIns1(0x4840 | nDn); break;
+				case 3: CheckIns1(0xC140 | nDn << 9 | nDm); break;
+				case 4: CheckIns1(0xC148 | nAn << 9 | CheckRand() % 7); break;
+				default: CheckIns1(0xC188 | nDn << 9 | nAn); break;
+			}
+			break;
+		case 23:											// scc
+			CheckIns1(0);
+			CheckIns[0] = 0x50C0 | nCond << 8 | CheckEA(EA_DATAALT, 0);
+			break;
+		case 24:											// moveq / addq.l / dbcc loop
+			if (nDm == nDn)
+				nDm = (nDm + 1) & 7;
+			CheckIns1(0x7000 | nDn << 9 | (CheckRand() & 15));
+			CheckIns1(0x5280 | nDm);
+			CheckIns1(0x50C8 | nCond << 8 | nDn);
+			CheckIns1(0xFFFC);
+			break;
+		case 25:											// bcc.s, bcc.w over a moveq
+			if (nCond < 2)
+				nCond = 0;									// bra, bsr has its own case
+			if (CheckRand() & 1) {
+				CheckIns1(0x6002 | nCond << 8);
+			} else {
+				CheckIns1(0x6000 | nCond << 8);
+				CheckIns1(0x0004);
+			}
+			CheckIns1(0x7000 | nDn << 9 | (CheckRand() & 0xFF));
+			break;
+		case 26:											// bsr, jsr, jmp, rts
+			switch (CheckRand() % 3) {
+				case 0:
+					CheckIns1(0x6102);						// bsr.s to the addq
+					CheckIns1(0x6004);						// bra.s past the rts
+					CheckIns1(0x5280 | nDn);
+					CheckIns1(0x4E75);
+					break;
+				case 1:
+					CheckIns1(0x4EB9);						// jsr abs.l
+					CheckIns1(0);
+					CheckIns1(CHECK_SUBROUTINE + nDn * 4);
+					break;
+				default:
+					CheckIns1(0x4EFA);						// jmp d16(pc) over a moveq
+					CheckIns1(0x0004);
+					CheckIns1(0x7000 | nDn << 9 | (CheckRand() & 0xFF));
+					break;
+			}
+			break;
+		case 27:											// btst, bchg, bclr, bset Dn
+			nOp = CheckRand() & 3;
+			CheckIns1(0);
+			CheckIns[0] = 0x0100 | nDn << 9 | nOp << 6 | CheckEA(nOp ? EA_DATAALT : (EA_DATA & ~EA_IMM), 0);
+			break;
+		case 28:											// btst, bchg, bclr, bset #
+			nOp = CheckRand() & 3;
+			CheckIns1(0);
+			CheckIns1(CheckRand() & 0xFF);
+			CheckIns[0] = 0x0800 | nOp << 6 | CheckEA(nOp ? EA_DATAALT : (EA_DATA & ~EA_IMM), 0);
+			break;
+		case 29:											// movem registers to memory
+			nSize = 1 + (CheckRand() & 1);
+			CheckIns1(0);
+			CheckIns1(CheckRand() & 0x7FFF);
+			nEA = CheckEA((EA_CONTROL & ~(EA_ABSW | EA_PCDISP | EA_PCINDEX)) | EA_PREDEC, nSize);
+			if ((nEA & 0x38) == 0x20)
+				CheckIns[1] = CheckRand() & 0xFFFE;			// Reversed mask, no A7
+			CheckIns[0] = 0x4880 | (nSize - 1) << 6 | nEA;
+			break;
+		case 30:											// movem memory to registers
+			nSize = 1 + (CheckRand() & 1);
+			CheckIns1(0);
+			CheckIns1(CheckRand() & 0x7FFF);
+			CheckIns[0] = 0x4C80 | (nSize - 1) << 6 | CheckEA(EA_CONTROL | EA_POSTINC, nSize);
+			break;
+		case 31:											// movep
+			nDm &= 3;
+			CheckPointer(nDm);
+			CheckIns1(0x0108 | nDn << 9 | (4 + (CheckRand() & 3)) << 6 | nDm);
+			CheckIns1((CheckRand() & 0x1FF) - 0x100);
+			break;
+		case 32:											// lea, pea
+			CheckIns1(0);
+			if (CheckRand() & 1) {
+				CheckIns[0] = 0x41C0 | nAn << 9 | CheckEA(EA_CONTROL, 2);
+			} else {
+				CheckIns[0] = 0x4840 | CheckEA(EA_CONTROL, 2);
+				CheckIns1(0x588F);							// addq.l #4,A7
+			}
+			break;
+		case 33:											// link, move to the frame, unlk
+			CheckIns1(0x4E50 | nAn);
+			CheckIns1(-(INT32)(4 + (CheckRand() & 0x1C)));
+			CheckIns1(0x2140 | nAn << 9 | nDn);				// move.l Dn,-4(An)
+			CheckIns1(0xFFFC);
+			CheckIns1(0x4E58 | nAn);
+			break;
+		case 34:											// chk
+			CheckIns1(0);
+			CheckIns[0] = 0x4180 | nDn << 9 | CheckEA(EA_DATA, 1);
+			break;
+		case 35:											// tas
+			CheckIns1(0);
+			CheckIns[0] = 0x4AC0 | CheckEA(EA_DATAALT, 0);
+			break;
+		case 36:											// move to/from sr and ccr
+			switch (CheckRand() & 3) {
+				case 0:
+					CheckIns1(0x46FC);
+					CheckIns1(CheckSR());
+					break;
+				case 1:
+					CheckIns1(0);
+					CheckIns[0] = 0x40C0 | CheckEA(EA_DATAALT, 1);
+					break;
+				default:
+					CheckIns1(0);
+					CheckIns[0] = 0x44C0 | CheckEA(EA_DATA, 1);
+					break;
+			}
+			break;
+		case 37:											// andi, ori, eori to ccr and sr
+			switch (CheckRand() % 6) {
+				case 0: CheckIns1(0x023C); CheckIns1(CheckRand() & 0xFF); break;
+				case 1: CheckIns1(0x003C); CheckIns1(CheckRand() & 0xFF); break;
+				case 2: CheckIns1(0x0A3C); CheckIns1(CheckRand() & 0xFF); break;
+				case 3: CheckIns1(0x027C); CheckIns1(CheckRand() | 0x2000); break;
+				case 4: CheckIns1(0x007C); CheckIns1(CheckRand() & 0x071F); break;
+				default: CheckIns1(0x0A7C); CheckIns1(CheckRand() & 0x071F); break;
+			}
+			break;
+		case 38:											// trap, trapv
+			CheckIns1((CheckRand() & 1) ? (0x4E40 | (CheckRand() & 15)) : 0x4E76);
+			break;
+		case 39:											// illegal, line A, line F
+			switch (CheckRand() % 3) {
+				case 0: CheckIns1(0x4AFC); break;
+				case 1: CheckIns1(0xA000 | (CheckRand() & 0x0FFF)); break;
+				default: CheckIns1(0xF000 | (CheckRand() & 0x0FFF)); break;
+			}
+			break;
+		case 40:											// rtr, rte to a pushed frame
+			CheckIns1(0x487A);								// pea past the return
+			CheckIns1(0x0008);
+			CheckIns1(0x3F3C);								// move.w #xxxx,-(A7)
+			if (CheckRand() & 1) {
+				CheckIns1(CheckRand() & 0xFF);
+				CheckIns1(0x4E77);
+			} else {
+				CheckIns1(CheckSR());
+				CheckIns1(0x4E73);
+			}
+			break;
+		case 41:											// move usp
+			CheckIns1(((CheckRand() & 1) ? 0x4E60 : 0x4E68) | nAn);
+			break;
+		case 42:											// move to and from the stack
+			CheckIns1(0x2F00 | nDn);						// move.l Dn,-(A7)
+			CheckIns1(0x201F | nDm << 9);					// move.l (A7)+,Dm
+			break;
+		default:
+			CheckIns1(0x4E71);								// nop
+			break;
+	}
+
+	CheckInsFlush();
+}
+
+// Build the vectors, handlers, ROM data and one random program, returns the end address
+static UINT32 CheckProgram(INT32 nInstructions, INT32 bIrq)
+{
+	memset(CheckRom, 0, sizeof(CheckRom));
+
+	CheckRom[0] = (CHECK_RAM_START + CHECK_RAM_SIZE) >> 16;	// SSP
+	CheckRom[1] = (CHECK_RAM_START + CHECK_RAM_SIZE) & 0xFFFF;
+	CheckRom[2] = CHECK_PROGRAM >> 16;						// PC
+	CheckRom[3] = CHECK_PROGRAM & 0xFFFF;
+	for (INT32 i = 2; i < 64; i++) {
+		UINT32 nHandler = (i == 4 || i == 10 || i == 11) ? CHECK_HANDLER_SKIP : CHECK_HANDLER_RTE;
+		CheckRom[i * 2 + 0] = nHandler >> 16;
+		CheckRom[i * 2 + 1] = nHandler & 0xFFFF;
+	}
+
+	nCheckPos = CHECK_HANDLER_RTE >> 1;
+	CheckEmit(0x4E73);										// rte
+	nCheckPos = CHECK_HANDLER_SKIP >> 1;
+	CheckEmit(0x54AF);										// addq.l #2,2(A7)
+	CheckEmit(0x0002);
+	CheckEmit(0x4E73);										// rte
+	nCheckPos = CHECK_SUBROUTINE >> 1;
+	for (INT32 i = 0; i < 8; i++) {
+		CheckEmit(0x5280 | i);								// addq.l #1,Di
+		CheckEmit(0x4E75);									// rts
+	}
+
+	for (INT32 i = 0x1000 >> 1; i < CHECK_PROGRAM >> 1; i++)
+		CheckRom[i] = CheckRand();
+
+	nCheckPos = CHECK_PROGRAM >> 1;
+	CheckEmit(0x46FC);										// move #$2700,sr, reset leaves the flags undefined
+	CheckEmit(0x2700);
+	for (INT32 i = 0; i < 8; i++) {
+		UINT32 nValue = CheckRand();
+		CheckEmit(0x203C | i << 9);							// move.l #xxxxxxxx,Di
+		CheckEmit(nValue >> 16);
+		CheckEmit(nValue & 0xFFFF);
+	}
+	for (INT32 i = 0; i < 4; i++)
+		CheckPointer(i);
+	CheckIndex();
+	for (INT32 i = 5; i < 7; i++) {
+		UINT32 nValue = CheckRand();
+		CheckEmit(0x207C | i << 9);							// movea.l #xxxxxxxx,Ai
+		CheckEmit(nValue >> 16);
+		CheckEmit(nValue & 0xFFFF);
+	}
+	if (bIrq) {
+		CheckEmit(0x46FC);									// move #$2000,sr
+		CheckEmit(0x2000);
+	}
+
+	for (INT32 i = 0; i < nInstructions && nCheckPos < (0x070000 >> 1); i++)
+		CheckInstruction();
+
+	CheckEmit(0x60FE);										// bra.s *
+
+	return (nCheckPos - 1) << 1;
+}
+
+// ----------------------------------------------------------------------------
+// Lockstep run
+
+struct CheckState {
+	UINT32 nReg[18];										// D0-D7, A0-A7, PC, SR
+	INT32 nCycles;
+	INT32 nPending;											// Interrupt pending before the step
+};
+
+static const char* CheckRegName[18] = {
+	"D0", "D1", "D2", "D3", "D4", "D5", "D6", "D7",
+	"A0", "A1", "A2", "A3", "A4", "A5", "A6", "A7",
+	"PC", "SR"
+};
+
+static UINT8 CheckTimedApart[0x10000];						// Opcodes already listed
+
+static void CheckStep(INT32 nCPU, struct CheckState* pState)
+{
+	SekOpen(nCPU);
+	pState->nPending = SekDbgGetPendingIRQ();
+	pState->nCycles = SekRun(1);
+	for (INT32 i = 0; i < 18; i++)
+		pState->nReg[i] = SekDbgGetRegister((enum SekRegister)(SEK_REG_D0 + i));
+	SekClose();
+}
+
+static void CheckIrq(INT32 nCPU, INT32 nLevel)
+{
+	SekOpen(nCPU);
+	SekSetIRQLine(nLevel, SEK_IRQSTATUS_AUTO);
+	SekClose();
+}
+
+static UINT16 CheckOpcode(UINT32 nPC)
+{
+	return CheckRom[(nPC & (CHECK_ROM_SIZE - 1)) >> 1];
+}
+
+// An interrupt pending before the step can be taken in it
+static INT32 CheckIrqTaken(INT32 nLevel, UINT32 nSRBefore, UINT32 nSRAfter)
+{
+	INT32 nMask = ((nSRBefore < nSRAfter) ? nSRBefore : nSRAfter) >> 8 & 7;
+
+	return nLevel == 7 || nLevel > nMask;
+}
+
+// Flags the 68000 leaves undefined after nOpcode
+static UINT32 CheckUndefinedFlags(UINT16 nOpcode, const struct CheckState* pState)
+{
+	INT32 bException = (pState->nReg[16] == CHECK_HANDLER_RTE);
+
+	if ((nOpcode & 0xF1C0) == 0x4180)						// chk, N is only defined when it traps
+		return bException ? 0x07 : 0x0F;
+	if ((nOpcode & 0xB1F0) == 0x8100 || (nOpcode & 0xFFC0) == 0x4800)	// abcd, sbcd, nbcd
+		return 0x0A;
+	if ((nOpcode & 0xF0C0) == 0x80C0) {						// divu, divs
+		// Musashi leaves C alone on a divide by zero or an overflow instead of clearing it
+		if (bException)
+			return 0x0F;
+		if (pState->nReg[17] & 0x02)
+			return 0x0D;
+	}
+
+	return 0;
+}
+
+// Give Musashi A68K's undefined flags, in SR and in the exception frame, so
+// they don't show up as differences later on
+static void CheckCopyUndefinedFlags(UINT16 nOpcode, const struct CheckState* pA68K, struct CheckState* pM68K)
+{
+	UINT32 nMask = CheckUndefinedFlags(nOpcode, pA68K);
+	UINT32 nFrame = (pA68K->nReg[15] - CHECK_RAM_START) >> 1;
+
+	if (nMask == 0)
+		return;
+
+	pM68K->nReg[17] = (pM68K->nReg[17] & ~nMask) | (pA68K->nReg[17] & nMask);
+	SekOpen(1);
+	m68k_set_reg(M68K_REG_SR, pM68K->nReg[17]);
+	SekClose();
+
+	if (pA68K->nReg[16] == CHECK_HANDLER_RTE && nFrame < (CHECK_RAM_SIZE >> 1))
+		CheckRam[1][nFrame] = (CheckRam[1][nFrame] & ~nMask) | (CheckRam[0][nFrame] & nMask);
+}
+
+static void CheckReport(INT32 nProgram, UINT32 nSeed, INT64 nStep, UINT32 nPC, const struct CheckState* pA68K, const struct CheckState* pM68K)
+{
+	printf("program %d (seed %u), step %lld, instruction at %06X:", nProgram, nSeed, (long long)nStep, nPC);
+	for (INT32 i = 0; i < 5; i++)
+		printf(" %04X", CheckOpcode(nPC + i * 2));
+	printf("\n        A68K      Musashi\n");
+	for (INT32 i = 0; i < 18; i++)
+		printf("%s  %08X  %08X%s\n", CheckRegName[i], pA68K->nReg[i], pM68K->nReg[i], pA68K->nReg[i] != pM68K->nReg[i] ? "  <" : "");
+	printf("cyc %8d  %8d%s\n", pA68K->nCycles, pM68K->nCycles, pA68K->nCycles != pM68K->nCycles ? "  <" : "");
+}
+
+static INT32 CheckCompareRam(INT32 nProgram, UINT32 nSeed, INT64 nStep, UINT32 nPC)
+{
+	for (INT32 i = 0; i < (CHECK_RAM_SIZE >> 1); i++) {
+		if (CheckRam[0][i] != CheckRam[1][i]) {
+			printf("program %d (seed %u), step %lld, RAM differs at %06X (A68K %04X, Musashi %04X), last instruction at %06X\n",
+				nProgram, nSeed, (long long)nStep, CHECK_RAM_START + (i << 1), CheckRam[0][i], CheckRam[1][i], nPC);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	UINT32 nSeed = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1;
+	INT32 nPrograms = (argc > 2) ? atoi(argv[2]) : 100;
+	INT32 nInstructions = (argc > 3) ? atoi(argv[3]) : 1000;
+	INT32 bIrq = (argc > 4) ? atoi(argv[4]) : 1;
+	INT32 nCycleMode = (argc > 5) ? atoi(argv[5]) : 0;		// 0 = count, 1 = list, 2 = stop at timing differences
+	INT64 nSteps = 0, nCycles[2] = { 0, 0 }, nTimedApart = 0;
+	INT32 nOpcodesApart = 0;
+
+	for (INT32 i = 0; i < 2; i++) {
+		bBurnUseASMCPUEmulation = (i == 0);					// CPU 0 on A68K, CPU 1 on Musashi
+		if (SekInit(i, 0x68000)) {
+			printf("SekInit failed\n");
+			return 1;
+		}
+		SekOpen(i);
+		SekMapMemory((UINT8*)CheckRom, 0, CHECK_ROM_SIZE - 1, SM_ROM);
+		SekMapMemory((UINT8*)CheckRam[i], CHECK_RAM_START, CHECK_RAM_START + CHECK_RAM_SIZE - 1, SM_RAM);
+		SekClose();
+	}
+
+	for (INT32 nProgram = 0; nProgram < nPrograms; nProgram++) {
+		struct CheckState A68K, M68K;
+		UINT32 nEnd, nPC = CHECK_PROGRAM, nSR = 0x2700;
+		INT64 nStep;
+
+		nCheckRand = (nSeed + nProgram) * 2654435761U | 1;
+		nEnd = CheckProgram(nInstructions, bIrq);
+
+		for (INT32 i = 0; i < (CHECK_RAM_SIZE >> 1); i++)
+			CheckRam[0][i] = CheckRam[1][i] = CheckRand();
+
+		for (INT32 i = 0; i < 2; i++) {
+			SekOpen(i);
+			SekSetIRQLine(0, SEK_IRQSTATUS_NONE);			// Drop an interrupt the last program left pending
+			SekReset();
+			SekClose();
+		}
+
+		for (nStep = 0; nPC != nEnd; nStep++) {
+			if (nStep > (INT64)nInstructions * 64) {
+				printf("program %d (seed %u) doesn't reach its end\n", nProgram, nSeed + nProgram);
+				return 1;
+			}
+
+			if (bIrq && (CheckRand() & 63) == 0) {
+				INT32 nLevel = 1 + CheckRand() % 7;
+				CheckIrq(0, nLevel);
+				CheckIrq(1, nLevel);
+			}
+
+			CheckStep(0, &A68K);
+			CheckStep(1, &M68K);
+
+			// A68K keeps the Intel flags between instructions and a Bcc loads them
+			// back into EFLAGS, so stray bits there can trap long after the fact
+			if (M68000_regs.ccr & ~0x0AD7) {
+				printf("program %d (seed %u), step %lld, instruction at %06X leaves %08X in the A68K flags\n",
+					nProgram, nSeed + nProgram, (long long)nStep, nPC, M68000_regs.ccr);
+				return 1;
+			}
+
+			CheckCopyUndefinedFlags(CheckOpcode(nPC), &A68K, &M68K);
+
+			// A68K takes an interrupt in a step of its own, Musashi together
+			// with the instruction that unmasks it or the one that follows
+			if (CheckIrqTaken(A68K.nPending, nSR, A68K.nReg[17]) && memcmp(A68K.nReg, M68K.nReg, sizeof(A68K.nReg))) {
+				INT32 nFirstCycles = A68K.nCycles;
+
+				CheckStep(0, &A68K);
+				A68K.nCycles += nFirstCycles;
+			}
+
+			if (memcmp(A68K.nReg, M68K.nReg, sizeof(A68K.nReg))) {
+				CheckReport(nProgram, nSeed + nProgram, nStep, nPC, &A68K, &M68K);
+				return 1;
+			}
+
+			if (A68K.nCycles != M68K.nCycles) {
+				if (nCycleMode == 2) {
+					CheckReport(nProgram, nSeed + nProgram, nStep, nPC, &A68K, &M68K);
+					return 1;
+				}
+
+				if (!CheckTimedApart[CheckOpcode(nPC)]) {
+					CheckTimedApart[CheckOpcode(nPC)] = 1;
+					if (nCycleMode == 1)
+						printf("%04X  A68K %3d  Musashi %3d cycles\n", CheckOpcode(nPC), A68K.nCycles, M68K.nCycles);
+					nOpcodesApart++;
+				}
+				nTimedApart++;
+			}
+
+			if ((nStep % CHECK_RAM_INTERVAL) == 0 && CheckCompareRam(nProgram, nSeed + nProgram, nStep, nPC))
+				return 1;
+
+			nPC = A68K.nReg[16];
+			nSR = A68K.nReg[17];
+			nCycles[0] += A68K.nCycles;
+			nCycles[1] += M68K.nCycles;
+		}
+
+		if (CheckCompareRam(nProgram, nSeed + nProgram, nStep, nPC))
+			return 1;
+
+		nSteps += nStep;
+	}
+
+	SekExit();
+
+	printf("%d programs, %lld instructions, registers and RAM agree\n", nPrograms, (long long)nSteps);
+	printf("%lld A68K cycles, %lld Musashi cycles, %lld instructions (%d opcodes) timed differently\n",
+		(long long)nCycles[0], (long long)nCycles[1], (long long)nTimedApart, nOpcodesApart);
+
+	return 0;
+}
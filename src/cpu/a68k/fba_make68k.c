@@ -102,6 +102,7 @@
  * 16.05.01 ASG	- use push/pop around mem calls instead of store to safe_REG
  *                optimized a bit the 020 extension word decoder
  *                removed lots of unnecessary code in branches
+ * 17.10.26 FBA	- x86-64 output (System V calling convention)
  *---------------------------------------------------------------
  * Known Problems / Bugs
  *
@@ -122,6 +123,10 @@
  *
  * ALIGNMENT is normally 4, but seems faster on my P2 as 0 !
  *
+ * X86_64 should be defined to get code for 64 bit Linux / OS X. The
+ * routines are still written as 32 bit code and then widened by
+ * X64Convert, the differences otherwise are marked with X86_64.
+ *
  *---------------------------------------------------------------
  *
  * Future Changes
@@ -148,6 +153,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <ctype.h>
 
 /* New Disassembler */
 
@@ -222,9 +228,23 @@ int		DisOp;
 #define REG_SFC				"R_SFC"
 #define REG_DFC				"R_DFC"
 
+#ifdef X86_64
+
+/* Arguments are always passed in registers */
+#ifndef FASTCALL
+#define FASTCALL
+#endif
+
+#define FASTCALL_FIRST_REG	"edi"
+#define FASTCALL_SECOND_REG	"esi"
+
+#else
+
 #define FASTCALL_FIRST_REG	"ecx"
 #define FASTCALL_SECOND_REG	"edx"
 
+#endif
+
 
 
 /*
@@ -251,7 +271,14 @@ int  ppro			= 0;
 
 /* External register preservation */
 
-#ifdef DOS
+#ifdef X86_64
+
+/* System V preserves RBX, RBP and R12-R15. ESI and EDI carry the */
+/* arguments, Memory_Read and Memory_Write keep EDI in R13 and always */
+/* reload ESI */
+static char SavedRegs[] = "-B---DB";
+
+#elif defined(DOS)
 
 /* Registers normally saved around C routines anyway */
 /* GCC 2.9.1 (dos) seems to preserve EBX,EDI and EBP */
@@ -406,6 +433,22 @@ void CopyX(void)
 	fprintf(fp, "\t\t bt    dword [%s],0\n",REG_X);
 }
 
+/*
+ * Decimal adjust AL after ADC or SBB
+ *
+ * DAA and DAS are not available in 64 bit mode, the
+ * replacements are emitted by CodeSegmentBegin
+ */
+
+void DecimalAdjust(int Subtract)
+{
+#ifdef X86_64
+	fprintf(fp, "\t\t call  %s\n", Subtract ? "DecimalAdjustSub" : "DecimalAdjustAdd");
+#else
+	fprintf(fp, "\t\t %s\n", Subtract ? "das" : "daa");
+#endif
+}
+
 /*
  * Immediate 3 bit data
  *
@@ -444,6 +487,27 @@ void Immediate8(void)
 #endif
 }
 
+/*
+ * Call a function in a68k_memory_intf
+ *
+ * Entry = number of the function pointer in the structure
+ *
+ */
+
+void CallMemoryIntf(int Entry)
+{
+#ifdef X86_64
+	/* The stack is kept however the routine left it, align it for C */
+
+	fprintf(fp, "\t\t mov   r12,rsp\n");
+	fprintf(fp, "\t\t and   rsp,byte -16\n");
+	fprintf(fp, "\t\t call  [%sa68k_memory_intf+%d]\n", PREF, Entry * 8);
+	fprintf(fp, "\t\t mov   rsp,r12\n");
+#else
+	fprintf(fp, "\t\t call  [%sa68k_memory_intf+%d]\n", PREF, Entry * 4);
+#endif
+}
+
 /*
  * This will check for bank changes before
  * resorting to calling the C bank select code
@@ -525,7 +589,7 @@ void MemoryBanking(int BaseCode)
 	fprintf(fp, "\t\t push  esi\n");
 #endif
 
-	fprintf(fp, "\t\t call  [%sa68k_memory_intf+28]\n", PREF);
+	CallMemoryIntf(7);
 
 #ifndef FASTCALL
 	fprintf(fp, "\t\t lea   esp,[esp+4]\n");
@@ -988,6 +1052,9 @@ void Memory_Read(char Size,int AReg,char *Flags,int Mask)
 
 #ifdef FASTCALL
 
+#ifdef X86_64
+	fprintf(fp, "\t\t mov   r13,rdi\n");
+#endif
 	fprintf(fp, "\t\t mov   %s,%s\n",FASTCALL_FIRST_REG,regnameslong[AReg]);
 
 	/* ASG - no longer need to mask addresses here */
@@ -1032,15 +1099,15 @@ void Memory_Read(char Size,int AReg,char *Flags,int Mask)
 			 switch (Size)
 			 {
 				 case 66 :
-					fprintf(fp, "\t\t call  [%sa68k_memory_intf+4]\n", PREF);
+					CallMemoryIntf(1);
 					break;
 
 				 case 87 :
-					fprintf(fp, "\t\t call  [%sa68k_memory_intf+8]\n", PREF);
+					CallMemoryIntf(2);
 					break;
 
 				 case 76 :
-					fprintf(fp, "\t\t call  [%sa68k_memory_intf+12]\n", PREF);
+					CallMemoryIntf(3);
 					break;
 			 }
 			 break;
@@ -1050,15 +1117,15 @@ void Memory_Read(char Size,int AReg,char *Flags,int Mask)
 			 switch (Size)
 			 {
 				 case 66 :
-					 fprintf(fp, "\t\t call  [%sa68k_memory_intf+32]\n", PREF);
+					 CallMemoryIntf(8);
 					 break;
 
 				 case 87 :
-					 fprintf(fp, "\t\t call  [%sa68k_memory_intf+36]\n", PREF);
+					 CallMemoryIntf(9);
 					 break;
 
 				 case 76 :
-					 fprintf(fp, "\t\t call  [%sa68k_memory_intf+40]\n", PREF);
+					 CallMemoryIntf(10);
 					 break;
 			 }
 			 break;
@@ -1071,15 +1138,15 @@ void Memory_Read(char Size,int AReg,char *Flags,int Mask)
 	switch (Size)
 	{
 		case 66 :
-			fprintf(fp, "\t\t call  [%sa68k_memory_intf+4]\n", PREF);
+			CallMemoryIntf(1);
 			break;
 
 		case 87 :
-			fprintf(fp, "\t\t call  [%sa68k_memory_intf+8]\n", PREF);
+			CallMemoryIntf(2);
 			break;
 
 		case 76 :
-			fprintf(fp, "\t\t call  [%sa68k_memory_intf+12]\n", PREF);
+			CallMemoryIntf(3);
 			break;
 	}
 #endif
@@ -1101,6 +1168,11 @@ void Memory_Read(char Size,int AReg,char *Flags,int Mask)
 		fprintf(fp, "\t\t pop   EDI\n");
 	}
 
+#ifdef X86_64
+	fprintf(fp, "\t\t mov   rdi,r13\n");
+	fprintf(fp, "\t\t mov   ESI,[%s]\n",REG_PC);
+#endif
+
 	if ((Flags[ECX] != '-') && (SavedRegs[ECX] == '-'))
 	{
 		fprintf(fp, "\t\t pop   ECX\n");
@@ -1111,10 +1183,12 @@ void Memory_Read(char Size,int AReg,char *Flags,int Mask)
 		fprintf(fp, "\t\t pop   EBX\n");
 	}
 
+#ifndef X86_64
 	if ((Flags[ESI] != '-') && (SavedRegs[ESI] == '-'))
 	{
 		fprintf(fp, "\t\t mov   ESI,[%s]\n",REG_PC);
 	}
+#endif
 
 	if ((Flags[EDX] != '-') && (SavedRegs[EDX] == '-'))
 	{
@@ -1170,9 +1244,21 @@ void Memory_Write(char Size,int AReg,int DReg,char *Flags,int Mask)
 
 #ifdef FASTCALL
 
+#ifdef X86_64
+	fprintf(fp, "\t\t mov   r13,rdi\n");
+#endif
 	fprintf(fp, "\t\t mov   %s,%s\n",FASTCALL_SECOND_REG,regnameslong[DReg]);
 	fprintf(fp, "\t\t mov   %s,%s\n",FASTCALL_FIRST_REG,regnameslong[AReg]);
 
+#ifdef X86_64
+	/* The compiler may expect narrow arguments to be zero extended */
+
+	if (Size == 'B')
+		fprintf(fp, "\t\t and   %s,0FFh\n",FASTCALL_SECOND_REG);
+	else if (Size == 'W')
+		fprintf(fp, "\t\t and   %s,0FFFFh\n",FASTCALL_SECOND_REG);
+#endif
+
 	/* ASG - no longer need to mask addresses here */
 /*	if (Mask == 1)
 		fprintf(fp, "\t\t and   %s,0FFFFFFh\n",FASTCALL_FIRST_REG);*/
@@ -1212,15 +1298,15 @@ void Memory_Write(char Size,int AReg,int DReg,char *Flags,int Mask)
 	switch (Size)
 	{
 		case 66 :
-			fprintf(fp, "\t\t call  [%sa68k_memory_intf+16]\n", PREF);
+			CallMemoryIntf(4);
 			break;
 
 		case 87 :
-			fprintf(fp, "\t\t call  [%sa68k_memory_intf+20]\n", PREF);
+			CallMemoryIntf(5);
 			break;
 
 		case 76 :
-			fprintf(fp, "\t\t call  [%sa68k_memory_intf+24]\n", PREF);
+			CallMemoryIntf(6);
 			break;
 	}
 
@@ -1241,6 +1327,11 @@ void Memory_Write(char Size,int AReg,int DReg,char *Flags,int Mask)
 		fprintf(fp, "\t\t pop   EDI\n");
 	}
 
+#ifdef X86_64
+	fprintf(fp, "\t\t mov   rdi,r13\n");
+	fprintf(fp, "\t\t mov   ESI,[%s]\n",REG_PC);
+#endif
+
 	if ((Flags[ECX] != '-') && (SavedRegs[ECX] == '-'))
 	{
 		fprintf(fp, "\t\t pop   ECX\n");
@@ -1261,10 +1352,12 @@ void Memory_Write(char Size,int AReg,int DReg,char *Flags,int Mask)
 		fprintf(fp, "\t\t mov   EDX,[%s]\n",REG_CCR);
 	}
 
+#ifndef X86_64
 	if ((Flags[ESI] != '-') && (SavedRegs[ESI] == '-'))
 	{
 		fprintf(fp, "\t\t mov   ESI,[%s]\n",REG_PC);
 	}
+#endif
 
 	if ((Flags[EBP] != '-') && (SavedRegs[EBP] == '-'))
 	{
@@ -3805,14 +3898,14 @@ void addx_subx(void)
 							fprintf(fp, "\t\t shr   ecx, byte 9\n");
 							fprintf(fp, "\t\t and   ecx, byte 7\n");
 
-							/* Get Source */
+							/* Get Source, keeping EDX for the old Z flag */
 
-							EffectiveAddressRead(mode+ModeModX,Size,EBX,EBX,"--CDS-B",FALSE);
+							EffectiveAddressRead(mode+ModeModX,Size,EBX,EBX,"--CDS-B",TRUE);
 
 							/* Get Destination (if needed) */
 
 							if (mode == 4)
-								EffectiveAddressRead(mode+ModeModY,Size,ECX,EAX,"-BCDSDB",FALSE);
+								EffectiveAddressRead(mode+ModeModY,Size,ECX,EAX,"-BCDSDB",TRUE);
 
 							/* Copy the X flag into the Carry Flag */
 
@@ -4612,13 +4705,17 @@ void not(void)
 
 									fprintf(fp, "\t\t mov   ebx,edx\n");
 
+									/* 0 - src - X as ~src + !X, adding X to the source */
+									/* before a NEG loses the carry when it is -1       */
+
+									fprintf(fp, "\t\t not   %s\n", Regname ) ;
 									CopyX();
+									fprintf(fp, "\t\t cmc\n");
 									fprintf(fp, "\t\t adc   %s,byte 0\n", Regname ) ;
-									fprintf(fp, "\t\t neg   %s\n", Regname ) ;
 
 									/* Set the Flags */
 
-									SetFlags(Size,EAX,FALSE,TRUE,FALSE);
+									SetFlags(Size,EAX,FALSE,FALSE,FALSE);
 
 									/* Handle the Z flag */
 
@@ -4631,6 +4728,11 @@ void not(void)
 									fprintf(fp, "\t\t or    edx,ebx       ; Copy across\n\n");
 									fprintf(fp, "%s:\n",Label);
 
+									/* The borrow is the inverse of the Intel carry */
+
+									fprintf(fp, "\t\t xor   edx,byte 1\n");
+									fprintf(fp, "\t\t mov   [%s],edx\n",REG_X);
+
 									break;
 
 								case 1: /* clr */
@@ -4764,7 +4866,9 @@ void chk(void)
 							if (Dest < 7)
 								fprintf(fp, "\t\t and   ecx,byte 7\n");
 
-							EffectiveAddressRead(Dest,(size == 0) ? 'W' : 'L',ECX,EAX,"----S-B",FALSE);
+							/* The flags survive unless it traps, so keep EDX */
+
+							EffectiveAddressRead(Dest,(size == 0) ? 'W' : 'L',ECX,EAX,"----S-B",TRUE);
 
 							if (size == 0)	/* word */
 							{
@@ -4968,6 +5072,7 @@ void nbcd(void)
 {
 	int	Opcode, BaseCode ;
 	int	sreg,mode,Dest ;
+	char * Label ;
 	char allow[] = "0-2345678-------" ;
 
 	for (mode = 0 ; mode < 8 ; mode++)
@@ -5009,17 +5114,31 @@ void nbcd(void)
 
 					fprintf(fp, "\t\t and   ecx, byte 7\n");
 
-					EffectiveAddressRead(Dest,'B',ECX,EBX,"--C-SDB",FALSE);
+					EffectiveAddressRead(Dest,'B',ECX,EBX,"--C-SDB",TRUE);
 
 					ClearRegister(EAX);
 					CopyX();
 
 					fprintf(fp, "\t\t sbb   al,bl\n");
-					fprintf(fp, "\t\t das\n");
+					DecimalAdjust(TRUE);
 
-					SetFlags('B',EAX,FALSE,TRUE,TRUE);
+					/* Should only clear Zero flag if not zero, as ABCD and SBCD */
 
-					EffectiveAddressWrite(Dest,'B',ECX,EAX,"----S-B",FALSE);
+					Label = GenerateLabel(0,1);
+
+					fprintf(fp, "\t\t mov   ebx,edx\n");
+					fprintf(fp, "\t\t setc  dl\n");
+
+					fprintf(fp, "\t\t jnz   short %s\n\n",Label);
+
+					/* Keep original Zero flag */
+					fprintf(fp, "\t\t and   bl,40h        ; Mask out Old Z\n");
+					fprintf(fp, "\t\t or    dl,bl         ; Copy across\n\n");
+
+					fprintf(fp, "%s:\n",Label);
+					fprintf(fp, "\t\t mov   [%s],edx\n",REG_X);
+
+					EffectiveAddressWrite(Dest,'B',ECX,EAX,"---DS-B",TRUE);
 					Completed();
 				}
 				OpcodeArray[Opcode] = BaseCode ;
@@ -5650,8 +5769,13 @@ void reset(void)
 #endif
 		}
 
+#ifdef X86_64
+		fprintf(fp, "\t\t mov  rax,[%s]\n", REG_RESET_CALLBACK);
+		fprintf(fp, "\t\t test rax,rax\n");
+#else
 		fprintf(fp, "\t\t mov  eax,dword [%s]\n", REG_RESET_CALLBACK);
 		fprintf(fp, "\t\t test eax,eax\n");
+#endif
 		fprintf(fp, "\t\t jz   near OP%d_%4.4x_END\n",CPU,BaseCode);
 
 		/* Callback for Reset */
@@ -5660,7 +5784,14 @@ void reset(void)
 		fprintf(fp, "\t\t mov   [%s],edx\n",REG_CCR);
 		fprintf(fp, "\t\t push  ECX\n");
 
+#ifdef X86_64
+		fprintf(fp, "\t\t mov   r12,rsp\n");
+		fprintf(fp, "\t\t and   rsp,byte -16\n");
+		fprintf(fp, "\t\t call  rax\n");
+		fprintf(fp, "\t\t mov   rsp,r12\n");
+#else
 		fprintf(fp, "\t\t call  eax\n");
+#endif
 
 		fprintf(fp, "\t\t mov   ESI,[%s]\n",REG_PC);
 		fprintf(fp, "\t\t mov   edx,[%s]\n",REG_CCR);
@@ -5811,7 +5942,11 @@ void trapv(void)
 
 		fprintf(fp, "\t\t test  dh,08h\n");
 		fprintf(fp, "\t\t jz    near OP%d_%4.4x_Clear\n",CPU,BaseCode);
-		Exception(7,BaseCode);
+
+		/* Like CHK, the exception stacks the address after the TRAPV */
+		fprintf(fp, "\t\t mov   al,7\n");
+		Exception(-1,BaseCode);
+		Completed();
 
 		fprintf(fp, "OP%d_%4.4x_Clear:\n",CPU,BaseCode);
 		Completed();
@@ -5826,6 +5961,9 @@ void illegal_opcode(void)
 	fprintf(fp, "\t\t mov [%sillegal_op],ecx\n", PREF);
 	fprintf(fp, "\t\t mov [%sillegal_pc],esi\n", PREF);
 
+	/* ESI is still on the opcode, the exception stacks its address */
+	fprintf(fp, "\t\t add   esi,byte 2\n");
+
 #if 0
 #ifdef MAME_DEBUG
 	fprintf(fp, "\t\t jmp ecx\n");
@@ -6291,6 +6429,9 @@ void movesr(void)
 						if ((Dest >= 2) && (Dest <=10))
 							SavePreviousPC();
 
+						/* 68010 Command ? */
+						if (type==1) CheckCPUtype(1);
+
 						fprintf(fp, "\t\t add   esi,byte 2\n\n");
 
 						if (type > 1) /* move to */
@@ -6313,10 +6454,6 @@ void movesr(void)
 							fprintf(fp, "\t\t je    near %s\n\n",TrueLabel);
 						}
 
-						/* 68010 Command ? */
-						if (type==1) CheckCPUtype(1);
-
-
 						if (mode < 7)
 						{
 							fprintf(fp, "\t\t and   ecx,byte 7\n");
@@ -6427,12 +6564,12 @@ void abcd_sbcd(void)
 						if (type == 0)
 						{
 							fprintf(fp, "\t\t sbb   al,bl\n");
-							fprintf(fp, "\t\t das\n");
+							DecimalAdjust(TRUE);
 						}
 						else
 						{
 							fprintf(fp, "\t\t adc   al,bl\n");
-							fprintf(fp, "\t\t daa\n");
+							DecimalAdjust(FALSE);
 						}
 
 						/* Should only clear Zero flag if not zero */
@@ -6547,6 +6684,18 @@ void rol_ror(void)
 							fprintf(fp, "\t\t add   edx,edx\n");
 							fprintf(fp, "\t\t sub   dword [%s],edx\n",ICOUNT);
 
+							/* x86 masks the count to 5 bits, so 32 would leave C alone */
+							/* two rotates by 16 come back round and set it instead     */
+
+							if (ir == 1)
+							{
+								fprintf(fp, "\t\t test  cl,32\n");
+								fprintf(fp, "\t\t jz    short %s_32\n",Label);
+								fprintf(fp, "\t\t %s   %s,16\n",dr == 0 ? "ror" : "rol",Regname);
+								fprintf(fp, "\t\t %s   %s,16\n",dr == 0 ? "ror" : "rol",Regname);
+								fprintf(fp, "%s_32:\n",Label);
+							}
+
 							if (dr == 0)
 								fprintf(fp, "\t\t ror   %s,cl\n",Regname);
 							else
@@ -6891,7 +7040,28 @@ void roxl_roxr(void)
 							/* move X into C so RCR & RCL can be used */
 							/* RCR & RCL only set the carry flag		*/
 
-							CopyX();
+							if (ir == 0)
+							{
+								CopyX();
+							}
+							else
+							{
+								/* RCR & RCL only use the low 5 bits of CL */
+								/* so rotate 32 first for bigger counts	 */
+
+								char Label32[16];
+
+								sprintf(Label32, "%s", GenerateLabel(0,1));
+								fprintf(fp, "\t\t test  cl,32\n");
+								fprintf(fp, "\t\t jz    short %s\n",Label32);
+								CopyX();
+								fprintf(fp, "\t\t %s   %s,16\n",(dr == 0) ? "rcr" : "rcl",Regname);
+								fprintf(fp, "\t\t %s   %s,16\n",(dr == 0) ? "rcr" : "rcl",Regname);
+								fprintf(fp, "\t\t jmp   short %s_r\n",Label32);
+								fprintf(fp, "%s:\n",Label32);
+								CopyX();
+								fprintf(fp, "%s_r:\n",Label32);
+							}
 
 							if (dr == 0)
 								fprintf(fp, "\t\t rcr   %s,cl\n",Regname);
@@ -7085,11 +7255,16 @@ void asl_asr(void)
 
 								/* ASG: on the 68k, the shift count is mod 64; on the x86, the */
 								/* shift count is mod 32; we need to check for shifts of 32-63 */
-								/* and effectively shift 31 */
-								fprintf(fp, "\t\t shrd  edx,ecx,6\n");
-								fprintf(fp, "\t\t sar   edx,31\n");
-								fprintf(fp, "\t\t and   edx,31\n");
-								fprintf(fp, "\t\t or    ecx,edx\n");
+								/* and shift by 32 first, in two halves like LSR, as a shift   */
+								/* of 31 would leave bit 30 rather than the sign in the carry  */
+								if (ir == 1)
+								{
+									fprintf(fp, "\t\t test  cl,0x20\n");
+									fprintf(fp, "\t\t jz    short %s_32\n",Label);
+									fprintf(fp, "\t\t sar   %s,16\n",Regname);
+									fprintf(fp, "\t\t sar   %s,16\n",Regname);
+									fprintf(fp, "%s_32:\n",Label);
+								}
 
 								fprintf(fp, "\t\t sar   %s,cl\n",Regname);
 
@@ -7116,6 +7291,14 @@ void asl_asr(void)
 
 								fprintf(fp,"\t\t mov   edi,eax\t\t; Save It\n");
 
+								/* x86 only shifts by 0-31, shifts of 32-63 clear every size */
+
+								if (ir==1)
+								{
+									fprintf(fp,"\t\t test  cl,0x20\n");
+									fprintf(fp,"\t\t jnz   near %s_32\n\n",Label);
+								}
+
 								ClearRegister(EDX);
 								fprintf(fp,"\t\t stc\n");
 								fprintf(fp,"\t\t rcr   %s,1\t\t; d=1xxxx\n",RegnameEDX);
@@ -7123,7 +7306,18 @@ void asl_asr(void)
 								fprintf(fp,"\t\t and   eax,edx\n");
 								fprintf(fp,"\t\t jz    short %s_V\t\t; No Overflow\n",Label);
 								fprintf(fp,"\t\t cmp   eax,edx\n");
-								fprintf(fp,"\t\t je    short %s_V\t\t; No Overflow\n",Label);
+
+								/* All ones only keeps its sign while a bit is left */
+
+								if ((leng==0) || ((ir==1) && (leng==1)))
+								{
+									fprintf(fp,"\t\t jne   short %s_SV\n",Label);
+									fprintf(fp,"\t\t cmp   cl,%d\n",leng==0 ? 8 : 16);
+									fprintf(fp,"\t\t jb    short %s_V\t\t; No Overflow\n",Label);
+									fprintf(fp,"%s_SV:\n",Label);
+								}
+								else
+									fprintf(fp,"\t\t je    short %s_V\t\t; No Overflow\n",Label);
 
 								/* Set Overflow */
 								fprintf(fp,"\t\t mov   edx,0x800\n");
@@ -7134,14 +7328,6 @@ void asl_asr(void)
 
 								fprintf(fp,"%s_OV:\n",Label);
 
-								/* more than 31 shifts and long */
-
-								if ((ir==1) && (leng==2))
-								{
-									fprintf(fp,"\t\t test  cl,0x20\n");
-									fprintf(fp,"\t\t jnz   short %s_32\n\n",Label);
-								}
-
 								fprintf(fp,"\t\t mov   eax,edi\t\t; Restore It\n");
 
 								fprintf(fp, "\t\t sal   %s,cl\n",Regname);
@@ -7166,23 +7352,32 @@ void asl_asr(void)
 								}
 								else
 								{
-									/* ASL - Keep existing Carry flag, Clear V */
-									fprintf(fp, "\t\t mov   ebx,edx\n");
-									fprintf(fp, "\t\t and   ebx,byte 1\n");
+									/* ASL - Test clears V and C too */
 									SetFlags(Size,EAX,TRUE,FALSE,FALSE);
-									fprintf(fp, "\t\t or    edx,ebx\n");
+									Completed();
 
-									if (leng==2)
-									{
-										Completed();
+									/* > 31 Shifts, V if any bit was set, C and X only */
+									/* from a long shifted by exactly 32               */
 
-										/* > 31 Shifts */
+									fprintf(fp, "%s_32:\n",Label);
+									fprintf(fp, "\t\t mov   edx,40h\n");	 // Zero flag
+									fprintf(fp, "\t\t test  %s,%s\n",Regname,Regname);
+									fprintf(fp, "\t\t jz    short %s_32Z\n",Label);
+									fprintf(fp, "\t\t or    edx,0x800\n");
+									fprintf(fp, "%s_32Z:\n",Label);
 
-										fprintf(fp, "%s_32:\n",Label);
-										fprintf(fp, "\t\t mov   dl,40h\n");	 // Zero flag
-										ClearRegister(EAX);
-										EffectiveAddressWrite(0,Size,EBX,EAX,"----S-B",TRUE);
+									if (leng==2)
+									{
+										fprintf(fp, "\t\t cmp   cl,32\n");
+										fprintf(fp, "\t\t jne   short %s_32C\n",Label);
+										fprintf(fp, "\t\t and   eax,byte 1\n");
+										fprintf(fp, "\t\t or    edx,eax\n");
+										fprintf(fp, "%s_32C:\n",Label);
 									}
+
+									ClearRegister(EAX);
+									EffectiveAddressWrite(0,Size,EBX,EAX,"---DS-B",TRUE);
+									fprintf(fp, "\t\t mov   [%s],edx\n",REG_X);
 								}
 
 								Completed();
@@ -7429,6 +7624,10 @@ void divides(void)
 							/* Correct cycle counter for error */
 
 							fprintf(fp, "\t\t add   dword [%s],byte %d\n",ICOUNT,95 + (type * 17));
+
+							/* The source read may have used EDX */
+
+							fprintf(fp, "\t\t mov   edx,[%s]\n",REG_CCR);
 							fprintf(fp, "\t\t mov   al,5\n");
 							Exception(-1,BaseCode);
 							Completed();
@@ -7584,7 +7783,11 @@ void JumpTable(void)
 {
 	int Opcode,l,op;
 
+	/* Reference point (x86-64 can't use an absolute address, see RESET) */
+
+#ifndef X86_64
 	fprintf(fp, "DD OP%d_1000\n",CPU);
+#endif
 
 	l = 0 ;
 	for (Opcode=0x0;Opcode<0x10000;)
@@ -7630,7 +7833,12 @@ void CodeSegmentBegin(void)
 
 /* Needed code to make it work! */
 
+#ifdef X86_64
+	fprintf(fp, "\t\t BITS 64\n");
+	fprintf(fp, "\t\t DEFAULT REL\n\n");
+#else
 	fprintf(fp, "\t\t BITS 32\n\n");
+#endif
 
 	fprintf(fp, "\t\t GLOBAL %s_RUN\n",CPUtype);
 	fprintf(fp, "\t\t GLOBAL %s_RESET\n",CPUtype);
@@ -7671,6 +7879,46 @@ void CodeSegmentBegin(void)
 
 	fprintf(fp, "%s_RESET:\n",CPUtype);
 
+#ifdef X86_64
+
+	/* The table holds 64 bit pointers, built from offsets to OP?_1000 */
+
+	fprintf(fp, "\t\t push  rbp\n\n");
+
+	fprintf(fp, "; Build Jump Table (not optimised!)\n\n");
+
+	fprintf(fp, "\t\t lea   rdi,[%s_OPCODETABLE]\t\t; Jump Table\n", CPUtype);
+	fprintf(fp, "\t\t lea   rsi,[%s_COMPTABLE]\t\t; RLE Compressed Table\n", CPUtype);
+	fprintf(fp, "\t\t lea   rbp,[OP%d_1000]\t\t; Reference Point\n", CPU);
+
+	fprintf(fp, "RESET0:\n");
+	fprintf(fp, "\t\t mov   eax,[rsi]\n");
+	fprintf(fp, "\t\t mov   ecx,eax\n");
+	fprintf(fp, "\t\t and   eax,0xffffff\n");
+	fprintf(fp, "\t\t add   rax,rbp\n");
+	fprintf(fp, "\t\t add   rsi,byte 4\n");
+
+	/* if count is zero, then it's a word RLE length */
+
+	fprintf(fp, "\t\t shr   ecx,24\n");
+	fprintf(fp, "\t\t jne   short RESET1\n");
+	fprintf(fp, "\t\t movzx ecx,word [rsi]\t\t; Repeats\n");
+	fprintf(fp, "\t\t add   rsi,byte 2\n");
+	fprintf(fp, "\t\t jecxz RESET2\t\t; Finished!\n");
+
+	fprintf(fp, "RESET1:\n");
+	fprintf(fp, "\t\t mov   [rdi],rax\n");
+	fprintf(fp, "\t\t add   rdi,byte 8\n");
+	fprintf(fp, "\t\t dec   ecx\n");
+	fprintf(fp, "\t\t jnz   short RESET1\n");
+	fprintf(fp, "\t\t jmp   short RESET0\n");
+
+	fprintf(fp, "RESET2:\n");
+	fprintf(fp, "\t\t pop   rbp\n");
+	fprintf(fp, "\t\t ret\n\n");
+
+#else
+
 	fprintf(fp, "\t\t pushad\n\n");
 
 	fprintf(fp, "; Build Jump Table (not optimised!)\n\n");
@@ -7716,13 +7964,30 @@ void CodeSegmentBegin(void)
 	fprintf(fp, "\t\t popad\n");
 	fprintf(fp, "\t\t ret\n\n");
 
+#endif
+
 /* Emulation Entry Point */
 
 	Align();
 
 	fprintf(fp, "%s_RUN:\n",CPUtype);
 
+#ifdef X86_64
+
+	/* R14 = jump table, R15 = register structure, R12 and R13 used around C calls */
+
+	fprintf(fp, "\t\t push  rbx\n");
+	fprintf(fp, "\t\t push  rbp\n");
+	fprintf(fp, "\t\t push  r12\n");
+	fprintf(fp, "\t\t push  r13\n");
+	fprintf(fp, "\t\t push  r14\n");
+	fprintf(fp, "\t\t push  r15\n");
+	fprintf(fp, "\t\t lea   r14,[%s_OPCODETABLE]\n", CPUtype);
+	fprintf(fp, "\t\t lea   r15,[%s_regs]\n", CPUtype);
+
+#else
 	fprintf(fp, "\t\t pushad\n");
+#endif
 	fprintf(fp, "\t\t mov   esi,[%s]\n",REG_PC);
 	fprintf(fp, "\t\t mov   edx,[%s]\n",REG_CCR);
 	fprintf(fp, "\t\t mov   ebp,dword [%sOP_ROM]\n", PREF);
@@ -7794,7 +8059,16 @@ void CodeSegmentBegin(void)
 
 #endif
 
+#ifdef X86_64
+	fprintf(fp, "\t\t pop   r15\n");
+	fprintf(fp, "\t\t pop   r14\n");
+	fprintf(fp, "\t\t pop   r13\n");
+	fprintf(fp, "\t\t pop   r12\n");
+	fprintf(fp, "\t\t pop   rbp\n");
+	fprintf(fp, "\t\t pop   rbx\n");
+#else
 	fprintf(fp, "\t\t popad\n");
+#endif
 	fprintf(fp, "\t\t ret\n");
 
 /* Check for Pending Interrupts */
@@ -7851,7 +8125,13 @@ void CodeSegmentBegin(void)
 
 /* ----- Win32 uses FASTCALL (By Kenjo)----- */
 
-#ifdef FASTCALL
+#if defined X86_64
+	fprintf(fp, "\t\t mov   %s, eax\t\t; irq line #\n",FASTCALL_FIRST_REG);
+	fprintf(fp, "\t\t mov   r12,rsp\n");
+	fprintf(fp, "\t\t and   rsp,byte -16\n");
+	fprintf(fp, "\t\t call  [%s]\t; get the IRQ level\n", REG_IRQ_CALLBACK);
+	fprintf(fp, "\t\t mov   rsp,r12\n");
+#elif defined FASTCALL
 	fprintf(fp, "\t\t mov   %s, eax\t\t; irq line #\n",FASTCALL_FIRST_REG);
 	fprintf(fp, "\t\t call  dword [%s]\t; get the IRQ level\n", REG_IRQ_CALLBACK);
 #else
@@ -7955,13 +8235,90 @@ void CodeSegmentBegin(void)
 
 	fprintf(fp, "\t\t ret\n");
 
+#ifdef X86_64
+
+/* DAA / DAS replacements, only AL and the flags are changed */
+
+	Align();
+	fprintf(fp, "DecimalAdjustAdd:\n");
+	fprintf(fp, "\t\t push  rcx\n");
+	fprintf(fp, "\t\t push  rdx\n");
+	fprintf(fp, "\t\t pushfq\n");
+	fprintf(fp, "\t\t pop   rcx\t\t; CF in bit 0, AF in bit 4\n");
+	fprintf(fp, "\t\t mov   dl,al\n");
+	fprintf(fp, "\t\t test  cl,10h\n");
+	fprintf(fp, "\t\t jnz   short DAA1\n");
+	fprintf(fp, "\t\t mov   ch,al\n");
+	fprintf(fp, "\t\t and   ch,0Fh\n");
+	fprintf(fp, "\t\t cmp   ch,9\n");
+	fprintf(fp, "\t\t jbe   short DAA2\n");
+	fprintf(fp, "DAA1:\n");
+	fprintf(fp, "\t\t add   al,6\n");
+	fprintf(fp, "DAA2:\n");
+	fprintf(fp, "\t\t cmp   dl,99h\n");
+	fprintf(fp, "\t\t ja    short DAA3\n");
+	fprintf(fp, "\t\t test  cl,1\n");
+	fprintf(fp, "\t\t jz    short DAA4\n");
+	fprintf(fp, "DAA3:\n");
+	fprintf(fp, "\t\t add   al,60h\n");
+	fprintf(fp, "\t\t test  al,al\n");
+	fprintf(fp, "\t\t stc\n");
+	fprintf(fp, "\t\t jmp   short DAA5\n");
+	fprintf(fp, "DAA4:\n");
+	fprintf(fp, "\t\t test  al,al\n");
+	fprintf(fp, "DAA5:\n");
+	fprintf(fp, "\t\t pop   rdx\n");
+	fprintf(fp, "\t\t pop   rcx\n");
+	fprintf(fp, "\t\t ret\n");
+
+	Align();
+	fprintf(fp, "DecimalAdjustSub:\n");
+	fprintf(fp, "\t\t push  rcx\n");
+	fprintf(fp, "\t\t push  rdx\n");
+	fprintf(fp, "\t\t pushfq\n");
+	fprintf(fp, "\t\t pop   rcx\t\t; CF in bit 0, AF in bit 4\n");
+	fprintf(fp, "\t\t mov   dl,al\n");
+	fprintf(fp, "\t\t mov   dh,cl\n");
+	fprintf(fp, "\t\t and   dh,1\t\t; Carry out\n");
+	fprintf(fp, "\t\t test  cl,10h\n");
+	fprintf(fp, "\t\t jnz   short DAS1\n");
+	fprintf(fp, "\t\t mov   ch,al\n");
+	fprintf(fp, "\t\t and   ch,0Fh\n");
+	fprintf(fp, "\t\t cmp   ch,9\n");
+	fprintf(fp, "\t\t jbe   short DAS2\n");
+	fprintf(fp, "DAS1:\n");
+	fprintf(fp, "\t\t sub   al,6\n");
+	fprintf(fp, "\t\t adc   dh,0\n");
+	fprintf(fp, "DAS2:\n");
+	fprintf(fp, "\t\t cmp   dl,99h\n");
+	fprintf(fp, "\t\t ja    short DAS3\n");
+	fprintf(fp, "\t\t test  cl,1\n");
+	fprintf(fp, "\t\t jz    short DAS4\n");
+	fprintf(fp, "DAS3:\n");
+	fprintf(fp, "\t\t sub   al,60h\n");
+	fprintf(fp, "\t\t mov   dh,1\n");
+	fprintf(fp, "DAS4:\n");
+	fprintf(fp, "\t\t test  dh,dh\n");
+	fprintf(fp, "\t\t jz    short DAS5\n");
+	fprintf(fp, "\t\t test  al,al\n");
+	fprintf(fp, "\t\t stc\n");
+	fprintf(fp, "\t\t jmp   short DAS6\n");
+	fprintf(fp, "DAS5:\n");
+	fprintf(fp, "\t\t test  al,al\n");
+	fprintf(fp, "DAS6:\n");
+	fprintf(fp, "\t\t pop   rdx\n");
+	fprintf(fp, "\t\t pop   rcx\n");
+	fprintf(fp, "\t\t ret\n");
+
+#endif
+
 #ifdef FBA_DEBUG
 
 	fprintf(fp,"\n; Call FBA debugging callback\n\n");
 	fprintf(fp, "FBADebugActive:");
 	fprintf(fp, "\t\t mov   [%s],ESI\n",REG_PC);
 	fprintf(fp, "\t\t mov   [%s],EDX\n",REG_CCR);
-	fprintf(fp, "\t\t call  [%sa68k_memory_intf+0]\n", PREF);
+	CallMemoryIntf(0);
 	if (SavedRegs[EDX] == '-')
 	{
 		fprintf(fp, "\t\t mov   EDX,[%s]\n",REG_CCR);
@@ -8026,12 +8383,29 @@ void CodeSegmentEnd(void)
 	fprintf(fp, "R_IRQ\t DD 0\t\t\t ; IRQ Request Level\n\n");
 	fprintf(fp, "R_SR\t DD 0\t\t\t ; Motorola Format SR\n\n");
 
+#ifdef X86_64
+
+	/* Pointers are 64 bit, as in struct A68KContext (m68000_intf.h) */
+
+	fprintf(fp, "\t\t DD 0\n");
+	fprintf(fp, "R_IRQ_CALLBACK\t DQ 0\t\t\t ; irq callback (get vector)\n\n");
+
+	fprintf(fp, "R_PPC\t DD 0\t\t\t ; Previous Program Counter\n");
+	fprintf(fp, "\t\t DD 0\n");
+
+	fprintf(fp, "R_RESET_CALLBACK\t DQ 0\t\t\t ; Reset Callback\n");
+	fprintf(fp, "\t\t DQ 0,0\t\t\t ; RTE and CMP Callbacks\n");
+
+#else
+
 	fprintf(fp, "R_IRQ_CALLBACK\t DD 0\t\t\t ; irq callback (get vector)\n\n");
 
 	fprintf(fp, "R_PPC\t DD 0\t\t\t ; Previous Program Counter\n");
 
 	fprintf(fp, "R_RESET_CALLBACK\t DD 0\t\t\t ; Reset Callback\n");
 
+#endif
+
 	fprintf(fp, "R_SFC\t DD 0\t\t\t ; Source Function Call\n");
 	fprintf(fp, "R_DFC\t DD 0\t\t\t ; Destination Function Call\n");
 	fprintf(fp, "R_USP\t DD 0\t\t\t ; User Stack\n");
@@ -8086,7 +8460,13 @@ void CodeSegmentEnd(void)
 
 
 /* If using Windows, put the table area in .data section (Kenjo) */
-#ifdef WIN32
+#if defined X86_64
+
+	fprintf(fp, "\t\t SECTION .bss\n");
+	fprintf(fp, "\t\t ALIGN 16\n");
+	fprintf(fp, "%s_OPCODETABLE\tRESQ  65536\n\n", CPUtype);
+
+#elif defined WIN32
 
 	fprintf(fp, "%s_OPCODETABLE\tTIMES  65536  DD 0\n\n", CPUtype);
 
@@ -8102,6 +8482,9 @@ void CodeSegmentEnd(void)
 
 #endif
 
+#if defined X86_64 && defined __ELF__
+	fprintf(fp, "\t\t SECTION .note.GNU-stack noalloc noexec nowrite progbits\n");
+#endif
 }
 
 void EmitCode(void)
@@ -8175,6 +8558,256 @@ void EmitCode(void)
 	CodeSegmentEnd();
 }
 
+#ifdef X86_64
+
+/*
+ * x86-64 conversion
+ *
+ * The code is generated as for 32 bit and widened a line at a time :-
+ *
+ * Registers used in addresses become 64 bit		[esi+ebp] -> [rsi+rbp]
+ * Indexed data is addressed from R15, which points to the register
+ * structure (the tables are in the same section)	[R_D0+ecx*4] -> [r15+rcx*4+(R_D0-M68000_regs)]
+ * The jump table holds 64 bit pointers and is addressed from R14
+ * Any other data is RIP relative (DEFAULT REL)
+ * Push and pop save whole registers, EBP is loaded with the 64 bit OP_ROM
+ *
+ * Anything else that doesn't exist in 64 bit mode stops the generator.
+ */
+
+static char *X64Reg32[] = { "eax","ebx","ecx","edx","esi","edi","ebp","esp" };
+static char *X64Reg64[] = { "rax","rbx","rcx","rdx","rsi","rdi","rbp","rsp" };
+
+static char *X64Invalid[] = { "pushad","popad","pusha","popa","daa","das","aaa","aas","aam","aad","into","bound","lds","les",NULL };
+
+int X64Match(const char *Text, const char *Name, int Len)
+{
+	int i;
+
+	if ((int)strlen(Name) != Len)
+		return FALSE;
+
+	for (i = 0; i < Len; i++)
+		if (tolower((unsigned char)Text[i]) != Name[i])
+			return FALSE;
+
+	return TRUE;
+}
+
+/* Number of the 32 bit register named, -1 if none */
+
+int X64Register(const char *Text, int Len)
+{
+	int Reg;
+
+	for (Reg = 0; Reg < 8; Reg++)
+		if (X64Match(Text, X64Reg32[Reg], Len))
+			return Reg;
+
+	return -1;
+}
+
+/* Replace Len characters at Pos with New */
+
+void X64Replace(char *Pos, int Len, const char *New)
+{
+	int NewLen = strlen(New);
+
+	memmove(Pos + NewLen, Pos + Len, strlen(Pos + Len) + 1);
+	memcpy(Pos, New, NewLen);
+}
+
+void X64Error(int Number, const char *Line)
+{
+	fprintf(stderr, "Can't convert line %d to x86-64 : %s", Number, Line);
+	exit(1);
+}
+
+/* Widen the inside of a memory reference */
+
+void X64Address(char *Out, const char *In, int Number, const char *Line)
+{
+	char Symbol[64] = "";
+	char Terms[128] = "";
+	char Table[64];
+	const char *Pos = In;
+	int  Regs = 0;
+
+	while (*Pos)
+	{
+		const char *Term;
+		char Sign = 0;
+		int  Len, Reg;
+
+		if (*Pos == '+' || *Pos == '-')
+			Sign = *Pos++;
+
+		Term = Pos;
+		while (*Pos && *Pos != '+' && *Pos != '-')
+			Pos++;
+
+		for (Len = 0; Term + Len < Pos && Term[Len] != '*'; Len++);
+
+		Reg = X64Register(Term, Len);
+
+		if ((Reg < 0) && (isalpha((unsigned char)*Term) || *Term == '_'))
+		{
+			/* Label, only one and never subtracted */
+
+			if (Symbol[0] || Sign == '-' || Len >= (int)sizeof(Symbol))
+				X64Error(Number, Line);
+
+			memcpy(Symbol, Term, Len);
+			Symbol[Len] = 0;
+			continue;
+		}
+
+		if (Sign && Terms[0])
+			sprintf(Terms + strlen(Terms), "%c", Sign);
+		else if (Sign == '-')
+			strcat(Terms, "-");
+
+		if (Reg >= 0)
+		{
+			Regs++;
+			strcat(Terms, X64Reg64[Reg]);
+			strncat(Terms, Term + Len, Pos - Term - Len);
+		}
+		else
+			strncat(Terms, Term, Pos - Term);
+	}
+
+	sprintf(Table, "%s_OPCODETABLE", CPUtype);
+
+	if (Regs == 0)
+	{
+		/* Just a label, RIP relative */
+
+		strcpy(Out, In);
+	}
+	else if (Symbol[0] == 0)
+	{
+		strcpy(Out, Terms);
+	}
+	else if (strcmp(Symbol, Table) == 0)
+	{
+		/* Jump table, 8 bytes per entry */
+
+		int Len = strlen(Terms);
+
+		if ((Regs != 1) || (Len < 3) || strcmp(Terms + Len - 2, "*4"))
+			X64Error(Number, Line);
+
+		Terms[Len - 1] = '8';
+		sprintf(Out, "r14+%s", Terms);
+	}
+	else
+	{
+		if (Regs != 1)
+			X64Error(Number, Line);
+
+		sprintf(Out, "r15+%s+(%s-%s_regs)", Terms, Symbol, CPUtype);
+	}
+}
+
+void X64Line(FILE *out, char *Line, int Number)
+{
+	char Code[512], Address[256];
+	char *Mnemonic, *Operand, *Open, *Close, *Tail;
+	int  Len, Reg, i;
+
+	/* Only instructions need converting, comments stay as they are */
+
+	if (Line[0] != ' ' && Line[0] != '\t')
+	{
+		fputs(Line, out);
+		return;
+	}
+
+	Tail = Line + strcspn(Line, ";\n");
+	if (Tail - Line >= (int)sizeof(Code) - 64)
+		X64Error(Number, Line);
+
+	memcpy(Code, Line, Tail - Line);
+	Code[Tail - Line] = 0;
+
+	Mnemonic = Code + strspn(Code, " \t");
+	Len = strcspn(Mnemonic, " \t");
+	Operand = Mnemonic + Len + strspn(Mnemonic + Len, " \t");
+
+	for (i = 0; X64Invalid[i]; i++)
+		if (X64Match(Mnemonic, X64Invalid[i], Len))
+			X64Error(Number, Line);
+
+	if (X64Match(Mnemonic, "pushf", Len) || X64Match(Mnemonic, "pushfd", Len))
+		X64Replace(Mnemonic, Len, "pushfq");
+
+	if (X64Match(Mnemonic, "popf", Len) || X64Match(Mnemonic, "popfd", Len))
+		X64Replace(Mnemonic, Len, "popfq");
+
+	if (X64Match(Mnemonic, "push", Len) || X64Match(Mnemonic, "pop", Len))
+	{
+		Len = strcspn(Operand, " \t");
+		Reg = X64Register(Operand, Len);
+
+		if (Reg >= 0)
+			X64Replace(Operand, Len, X64Reg64[Reg]);
+	}
+
+	/* EBP holds OP_ROM */
+
+	if (X64Match(Mnemonic, "mov", Len) && X64Match(Operand, "ebp", 3) && Operand[3] == ',' && strchr(Operand, '['))
+	{
+		char *Size = strstr(Operand, "dword ");
+
+		if (Size)
+			X64Replace(Size, 6, "");
+
+		X64Replace(Operand, 3, "rbp");
+	}
+
+	Open = strchr(Code, '[');
+	if (Open)
+	{
+		Close = strchr(Open, ']');
+		if (Close == NULL || strchr(Close, '[') || Close - Open > 128)
+			X64Error(Number, Line);
+
+		*Close = 0;
+		X64Address(Address, Open + 1, Number, Line);
+		*Close = ']';
+
+		X64Replace(Open + 1, Close - Open - 1, Address);
+	}
+
+	fputs(Code, out);
+	fputs(Tail, out);
+}
+
+/* Widen the generated code into the output file */
+
+void X64Convert(char *Name)
+{
+	char Line[512];
+	int  Number = 0;
+	FILE *out = fopen(Name, "w");
+
+	if (!out)
+	{
+		fprintf(stderr, "Can't open %s for writing\n", Name);
+		exit(1);
+	}
+
+	rewind(fp);
+
+	while (fgets(Line, sizeof(Line), fp))
+		X64Line(out, Line, ++Number);
+
+	fclose(out);
+}
+
+#endif
+
 int main(int argc, char **argv)
 {
 	int dwLoop;
@@ -8201,7 +8834,11 @@ int main(int argc, char **argv)
 	}
 
 	/* Emit the code */
+#ifdef X86_64
+	fp = tmpfile();					/* Widened into argv[1] by X64Convert */
+#else
 	fp = fopen(argv[1], "w");
+#endif
 	if (!fp)
 	{
 		fprintf(stderr, "Can't open %s for writing\n", argv[1]);
@@ -8224,6 +8861,10 @@ int main(int argc, char **argv)
 
 	EmitCode();
 
+#ifdef X86_64
+	X64Convert(argv[1]);
+#endif
+
 	fclose(fp);
 
 	printf("\n%d Unique Opcodes\n",Opcount);
@@ -35,7 +35,7 @@ static struct { UINT32 address; INT32 id; } BreakpointFetch[9] = { { 0, 0 }, };
 #if defined (EMU_A68K)
 static void UpdateA68KContext()
 {
-	if (M68000_regs.srh & 20) {		// Supervisor mode
+	if (M68000_regs.srh & 0x20) {	// Supervisor mode
 		M68000_regs.isp = M68000_regs.a[7];
 	} else {						// User mode
 		M68000_regs.usp = M68000_regs.a[7];
@@ -71,6 +71,55 @@ static UINT32 GetA68KUSP()
 }
 #endif
 
+// Decoded opcodes for one page, valid while pSrc is mapped there
+struct SekCodePage {
+	UINT8* pSrc;
+	struct M68KCodeEntry Entry[SEK_PAGE_SIZE >> 1];
+};
+
+// Forget the cached fetch page after the memory map or the active CPU changes
+inline static void SekFlushFetch()
+{
+#ifdef EMU_M68K
+	M68KFetchPage = ~0U;
+	M68KCodePageAddr = ~0U;
+#endif
+}
+
+// Drop the decoded opcodes of all pages mapped to nLen bytes at pData
+static void SekInvalidateCode(UINT8* pData, UINT32 nLen)
+{
+	for (INT32 i = 0; i < pSekExt->nCodePages; i++) {
+		struct SekCodePage* pc = pSekExt->CodePage[pSekExt->CodePageList[i]];
+
+		if (pc->pSrc && pData < pc->pSrc + SEK_PAGE_SIZE && pData + nLen > pc->pSrc) {
+			pc->pSrc = NULL;
+		}
+	}
+
+	SekFlushFetch();
+}
+
+// Pages mapped again are decoded again, even if the memory is the same
+static void SekRemapCode(UINT32 nStart, UINT32 nEnd)
+{
+	if (pSekExt->nCodePages == 0) {
+		return;
+	}
+
+	for (UINT32 i = nStart >> SEK_SHIFT; i <= (nEnd >> SEK_SHIFT) && i < SEK_PAGE_COUNT; i++) {
+		if (pSekExt->CodePage[i]) {
+			pSekExt->CodePage[i]->pSrc = NULL;
+		}
+	}
+}
+
+// Forget the loops found not to be idle on the active CPU
+static void SekIdleFlush()
+{
+	memset(pSekExt->IdleBusy, 0xFF, sizeof(pSekExt->IdleBusy));
+}
+
 #if defined (FBA_DEBUG)
 
 inline static void CheckBreakpoint_R(UINT32 a, const UINT32 m)
@@ -577,7 +626,266 @@ unsigned int __fastcall M68KReadLong(unsigned int a) { return               Read
 
 unsigned int __fastcall M68KFetchByte(unsigned int a) { return (unsigned int)FetchByte(a); }
 unsigned int __fastcall M68KFetchWord(unsigned int a) { return (unsigned int)FetchWord(a); }
-unsigned int __fastcall M68KFetchLong(unsigned int a) { return               FetchLong(a); }
+
+#if M68K_FETCH_PAGE_BITS != SEK_BITS
+ #error M68K_FETCH_PAGE_BITS must match SEK_BITS
+#endif
+
+UINT32 M68KFetchPage = ~0U;
+UINT8* M68KFetchPtr = NULL;
+
+// Remember the page for M68KFetchLongPage, unless it is handled by functions
+unsigned int __fastcall M68KFetchLong(unsigned int a)
+{
+	UINT8* pr;
+
+	a &= 0xFFFFFF;
+
+	pr = FIND_F(a);
+	if ((uintptr_t)pr >= SEK_MAXHANDLER) {
+		M68KFetchPage = a & ~SEK_PAGEM;
+		M68KFetchPtr = pr;
+	}
+
+	return FetchLong(a);
+}
+
+UINT32 M68KCodePageAddr = ~0U;
+struct M68KCodeEntry* M68KCode = NULL;
+
+struct M68KCodeEntry* M68KCodePage(unsigned int a)
+{
+	UINT32 nPage = (a & 0xFFFFFF) >> SEK_SHIFT;
+	UINT8* pr = pSekExt->MemMap[nPage + SEK_WADD * 2];
+	struct SekCodePage* pc;
+
+	M68KCodePageAddr = a & ~SEK_PAGEM;
+	M68KCode = NULL;
+
+	// Only cache fetch memory that the CPU can't write to directly
+	if (!pSekExt->bCodeCache || (uintptr_t)pr < SEK_MAXHANDLER || (uintptr_t)pSekExt->MemMap[nPage + SEK_WADD] >= SEK_MAXHANDLER) {
+		return NULL;
+	}
+
+	pc = pSekExt->CodePage[nPage];
+	if (pc == NULL) {
+		pc = (struct SekCodePage*)malloc(sizeof(struct SekCodePage));
+		if (pc == NULL) {
+			return NULL;
+		}
+		pc->pSrc = NULL;
+
+		pSekExt->CodePage[nPage] = pc;
+		pSekExt->CodePageList[pSekExt->nCodePages++] = nPage;
+	}
+
+	// Decode again if another bank was mapped in since
+	if (pc->pSrc != pr) {
+		memset(pc->Entry, 0, sizeof(pc->Entry));
+		pc->pSrc = pr;
+	}
+
+	M68KCode = pc->Entry;
+
+	return M68KCode;
+}
+
+#if M68K_IDLE_SKIP
+// Whether nSize bytes at a can be read without calling a handler
+static INT32 SekIdleRead(UINT32 a, INT32 nSize)
+{
+	UINT32 nFirst = a & 0xFFFFFF;
+	UINT32 nLast = (a + nSize - 1) & 0xFFFFFF;
+
+	return (uintptr_t)FIND_R(nFirst) >= SEK_MAXHANDLER && (uintptr_t)FIND_R(nLast) >= SEK_MAXHANDLER;
+}
+
+// Index register of a (d8,An,Xn) or (d8,PC,Xn) operand
+static UINT32 SekIdleIndex(UINT32 nExt)
+{
+	UINT32 nIndex = m68k_get_reg(NULL, (m68k_register_t)(M68K_REG_D0 + (nExt >> 12)));
+
+	return (nExt & 0x0800) ? nIndex : (UINT32)(INT16)nIndex;
+}
+
+// Check the source operand of an instruction in an idle loop and move *pPC
+// past its extension words. Only operands that read the same memory every
+// time (through a handler only if bHandlers is set) are accepted.
+static INT32 SekIdleOperand(UINT32* pPC, INT32 nEA, INT32 nSize, INT32 bPCRelative, INT32 bHandlers)
+{
+	UINT32 pc = *pPC;
+	UINT32 a;
+
+	switch (nEA >> 3) {
+		case 0:											// Dn
+			return 1;
+		case 2:											// (An)
+			a = m68k_get_reg(NULL, (m68k_register_t)(M68K_REG_A0 + (nEA & 7)));
+			break;
+		case 5:											// (d16,An)
+			a = m68k_get_reg(NULL, (m68k_register_t)(M68K_REG_A0 + (nEA & 7))) + (INT16)FetchWord(pc);
+			*pPC += 2;
+			break;
+		case 6: {										// (d8,An,Xn)
+			UINT32 nExt = FetchWord(pc);
+			if (nExt & 0x0100) {
+				return 0;
+			}
+			a = m68k_get_reg(NULL, (m68k_register_t)(M68K_REG_A0 + (nEA & 7))) + (INT8)nExt + SekIdleIndex(nExt);
+			*pPC += 2;
+			break;
+		}
+		case 7:
+			switch (nEA & 7) {
+				case 0:									// (xxx).W
+					a = (INT16)FetchWord(pc);
+					*pPC += 2;
+					break;
+				case 1:									// (xxx).L
+					a = FetchLong(pc);
+					*pPC += 4;
+					break;
+				case 2:									// (d16,PC)
+					if (!bPCRelative) {
+						return 0;
+					}
+					a = pc + (INT16)FetchWord(pc);
+					*pPC += 2;
+					break;
+				case 3: {								// (d8,PC,Xn)
+					UINT32 nExt = FetchWord(pc);
+					if (!bPCRelative || (nExt & 0x0100)) {
+						return 0;
+					}
+					a = pc + (INT8)nExt + SekIdleIndex(nExt);
+					*pPC += 2;
+					break;
+				}
+				case 4:									// #imm
+					if (!bPCRelative) {
+						return 0;
+					}
+					*pPC += (nSize == 4) ? 4 : 2;
+					return 1;
+				default:
+					return 0;
+			}
+			break;
+		default:										// An, (An)+ and -(An)
+			return 0;
+	}
+
+	return bHandlers || SekIdleRead(a, nSize);
+}
+
+// Cycles of one pass through the loop from target to the branch back at
+// branch, or 0 if a pass may do anything but read memory. Loops found not to
+// be idle are remembered until SekSetIdleSkip or SekReset.
+int M68KIdleLoop(unsigned int branch, unsigned int target)
+{
+	UINT32* pBusy = pSekExt->IdleBusy + ((branch >> 1) & (SEK_IDLE_CACHE - 1));
+	UINT32 pc;
+	UINT32 nOp;
+	INT32 nCycles = 0;
+	INT32 bHandlers = 0;
+	INT32 nDisp;
+
+	if (*pBusy == branch) {
+		return 0;
+	}
+
+	for (INT32 i = 0; i < pSekExt->nIdleLoops; i++) {
+		if (pSekExt->IdleLoopAddress[i] == (branch & 0xFFFFFF)) {
+			if (pSekExt->IdleLoopType[i] == SEK_IDLE_NEVER) {
+				*pBusy = branch;
+				return 0;
+			}
+			bHandlers = 1;
+		}
+	}
+
+	// Reading the code mustn't have side effects either
+	{
+		UINT32 nFirst = target & 0xFFFFFF;
+		UINT32 nLast = branch & 0xFFFFFF;
+
+		if ((uintptr_t)FIND_F(nFirst) < SEK_MAXHANDLER || (uintptr_t)FIND_F(nLast) < SEK_MAXHANDLER) {
+			*pBusy = branch;
+			return 0;
+		}
+	}
+
+	pc = target;
+	while (pc < branch) {
+		INT32 nSize;
+		INT32 bIdle = 0;
+
+		nOp = FetchWord(pc);
+		nSize = 1 << ((nOp >> 6) & 3);
+		nCycles += m68k_cycles_instruction(nOp);
+		pc += 2;
+
+		if (nOp == 0x4E71) {
+			// NOP
+			bIdle = 1;
+		} else if ((nOp & 0xFF00) == 0x4A00 && (nOp & 0x00C0) != 0x00C0) {
+			// TST <ea>
+			bIdle = SekIdleOperand(&pc, nOp & 0x3F, nSize, 0, bHandlers);
+		} else if ((nOp & 0xF000) == 0xB000) {
+			// CMP <ea>,Dn and CMPA <ea>,An
+			INT32 nMode = (nOp >> 6) & 7;
+			if (nMode <= 3 || nMode == 7) {
+				nSize = (nMode == 3) ? 2 : (nMode == 7) ? 4 : nSize;
+				bIdle = SekIdleOperand(&pc, nOp & 0x3F, nSize, 1, bHandlers);
+			}
+		} else if ((nOp & 0xFF00) == 0x0C00 && (nOp & 0x00C0) != 0x00C0 && (nOp & 0xFFF8) != 0x0C80) {
+			// CMPI #,<ea>, except CMPI.L #,Dn which calls the compare callback
+			pc += (nSize == 4) ? 4 : 2;
+			bIdle = SekIdleOperand(&pc, nOp & 0x3F, nSize, 0, bHandlers);
+		} else if ((nOp & 0xFFC0) == 0x0800 && (nOp & 0x3F) != 0x3C) {
+			// BTST #,<ea>
+			pc += 2;
+			bIdle = SekIdleOperand(&pc, nOp & 0x3F, 1, 1, bHandlers);
+		} else if ((nOp & 0xF1C0) == 0x0100 && (nOp & 0x38) != 0x08 && (nOp & 0x3F) != 0x3C) {
+			// BTST Dn,<ea>
+			bIdle = SekIdleOperand(&pc, nOp & 0x3F, 1, 1, bHandlers);
+		} else if ((nOp & 0xC000) == 0x0000 && (nOp & 0x3000) && (nOp & 0x0180) == 0x0000) {
+			// MOVE <ea>,Dn and MOVEA <ea>,An
+			INT32 nMove = (nOp >> 12) & 3;
+			nSize = (nMove == 1) ? 1 : (nMove == 3) ? 2 : 4;
+			if (nSize > 1 || (nOp & 0x01C0) == 0x0000) {
+				bIdle = SekIdleOperand(&pc, nOp & 0x3F, nSize, 1, bHandlers);
+			}
+		} else if ((nOp & 0xB000) == 0x8000 && ((nOp >> 6) & 7) <= 2) {
+			// AND <ea>,Dn and OR <ea>,Dn
+			bIdle = SekIdleOperand(&pc, nOp & 0x3F, nSize, 1, bHandlers);
+		} else if ((nOp & 0xFD38) == 0x0000 && (nOp & 0x00C0) != 0x00C0) {
+			// ANDI #,Dn and ORI #,Dn
+			pc += (nSize == 4) ? 4 : 2;
+			bIdle = 1;
+		}
+
+		if (!bIdle) {
+			*pBusy = branch;
+			return 0;
+		}
+	}
+
+	// The loop has to end with a BRA or Bcc back to target
+	nOp = FetchWord(branch);
+	nDisp = (INT8)(nOp & 0xFF);
+	if (nDisp == 0) {
+		nDisp = (INT16)FetchWord(branch + 2);
+	}
+
+	if (pc != branch || (nOp & 0xF000) != 0x6000 || (nOp & 0x0F00) == 0x0100 || (nOp & 0xFF) == 0xFF || branch + 2 + nDisp != target) {
+		*pBusy = branch;
+		return 0;
+	}
+
+	return nCycles + m68k_cycles_instruction(nOp);
+}
+#endif
 
 #ifdef FBA_DEBUG
 UINT32 __fastcall M68KReadByteBP(UINT32 a) { return (UINT32)ReadByteBP(a); }
@@ -659,9 +967,26 @@ void SekWriteByte(UINT32 a, UINT8 d) { WriteByte(a, d); }
 void SekWriteWord(UINT32 a, UINT16 d) { WriteWord(a, d); }
 void SekWriteLong(UINT32 a, UINT32 d) { WriteLong(a, d); }
 
-void SekWriteByteROM(UINT32 a, UINT8 d) { WriteByteROM(a, d); }
-void SekWriteWordROM(UINT32 a, UINT16 d) { WriteWordROM(a, d); }
-void SekWriteLongROM(UINT32 a, UINT32 d) { WriteLongROM(a, d); }
+// Writes to ROM may change code that has already been decoded
+static void SekWriteROMCode(UINT32 a, UINT32 nLen)
+{
+	UINT8* pr;
+
+	if (pSekExt->nCodePages == 0) {
+		return;
+	}
+
+	a &= 0xFFFFFF;
+
+	pr = FIND_R(a);
+	if ((uintptr_t)pr >= SEK_MAXHANDLER) {
+		SekInvalidateCode(pr + (a & SEK_PAGEM & ~1), nLen);
+	}
+}
+
+void SekWriteByteROM(UINT32 a, UINT8 d) { WriteByteROM(a, d); SekWriteROMCode(a, 2); }
+void SekWriteWordROM(UINT32 a, UINT16 d) { WriteWordROM(a, d); SekWriteROMCode(a, 2); }
+void SekWriteLongROM(UINT32 a, UINT32 d) { WriteLongROM(a, d); SekWriteROMCode(a, 4); }
 
 // ----------------------------------------------------------------------------
 // Callbacks for A68K
@@ -883,6 +1208,7 @@ INT32 SekInit(INT32 nCount, INT32 nCPUType)
 		return 1;
 	}
 	memset(SekExt[nCount], 0, sizeof(struct SekExt));
+	memset(SekExt[nCount]->IdleBusy, 0xFF, sizeof(SekExt[nCount]->IdleBusy));
 
 	// Put in default memory handlers
 	ps = SekExt[nCount];
@@ -1043,12 +1369,24 @@ INT32 SekExit()
 
 		// Deallocate other context data
 		if (SekExt[i]) {
+			for (INT32 j = 0; j < SekExt[i]->nCodePages; j++) {
+				free(SekExt[i]->CodePage[SekExt[i]->CodePageList[j]]);
+			}
 			free(SekExt[i]);
 			SekExt[i] = NULL;
 		}
 	}
 
 	pSekExt = NULL;
+	SekFlushFetch();
+
+#if defined EMU_M68K && M68K_JIT_X64
+	M68KJitExit();
+#endif
+
+#if defined EMU_M68K && M68K_IDLE_SKIP
+	M68KIdleSkip = 0;
+#endif
 
 	nSekActive = -1;
 	nSekCount = -1;
@@ -1074,6 +1412,8 @@ void SekReset()
 #endif
 
 #ifdef EMU_M68K
+		SekFlushCodeCache();
+		SekIdleFlush();
 		m68k_pulse_reset();
 #endif
 
@@ -1099,6 +1439,7 @@ void SekOpen(const INT32 i)
 		nSekActive = i;
 
 		pSekExt = SekExt[nSekActive];						// Point to cpu context
+		SekFlushFetch();
 
 #ifdef EMU_A68K
 		if (nSekCPUType[nSekActive] == 0) {
@@ -1109,6 +1450,9 @@ void SekOpen(const INT32 i)
 
 #ifdef EMU_M68K
 			m68k_set_context(SekM68KContext[nSekActive]);
+#if M68K_IDLE_SKIP
+			M68KIdleSkip = pSekExt->bIdleSkip;
+#endif
 #endif
 
 #ifdef EMU_A68K
@@ -1489,6 +1833,11 @@ INT32 SekMapMemory(UINT8* pMemory, UINT32 nStart, UINT32 nEnd, INT32 nType)
 	UINT8* Ptr = pMemory - nStart;
 	UINT8** pMemMap = pSekExt->MemMap + (nStart >> SEK_SHIFT);
 
+	SekFlushFetch();
+	if (nType & SM_FETCH) {
+		SekRemapCode(nStart, nEnd);
+	}
+
 	// Special case for ROM banks
 	if (nType == SM_ROM) {
 		for (UINT32 i = (nStart & ~SEK_PAGEM); i <= nEnd; i += SEK_PAGE_SIZE, pMemMap++) {
@@ -1524,6 +1873,11 @@ INT32 SekMapHandler(uintptr_t nHandler, UINT32 nStart, UINT32 nEnd, INT32 nType)
 
 	UINT8** pMemMap = pSekExt->MemMap + (nStart >> SEK_SHIFT);
 
+	SekFlushFetch();
+	if (nType & SM_FETCH) {
+		SekRemapCode(nStart, nEnd);
+	}
+
 	// Add to memory map
 	for (UINT32 i = (nStart & ~SEK_PAGEM); i <= nEnd; i += SEK_PAGE_SIZE, pMemMap++) {
 
@@ -1578,6 +1932,73 @@ INT32 SekSetIrqCallback(pSekIrqCallback pCallback)
 	return 0;
 }
 
+// Enable the opcode cache for the active CPU (Musashi only)
+INT32 SekSetCodeCache(INT32 bEnable)
+{
+#if defined FBA_DEBUG
+	if (!DebugCPU_SekInitted) bprintf(PRINT_ERROR, _T("SekSetCodeCache called without init\n"));
+	if (nSekActive == -1) bprintf(PRINT_ERROR, _T("SekSetCodeCache called when no CPU open\n"));
+#endif
+
+	pSekExt->bCodeCache = bEnable;
+	SekFlushFetch();
+
+	return 0;
+}
+
+// Drop the decoded opcodes of all CPUs, e.g. after ROM data was changed
+void SekFlushCodeCache()
+{
+	for (INT32 i = 0; i <= nSekCount; i++) {
+		if (SekExt[i]) {
+			for (INT32 j = 0; j < SekExt[i]->nCodePages; j++) {
+				SekExt[i]->CodePage[SekExt[i]->CodePageList[j]]->pSrc = NULL;
+			}
+		}
+	}
+
+	SekFlushFetch();
+}
+
+// Skip idle loops on the active CPU (Musashi only)
+INT32 SekSetIdleSkip(INT32 bEnable)
+{
+#if defined FBA_DEBUG
+	if (!DebugCPU_SekInitted) bprintf(PRINT_ERROR, _T("SekSetIdleSkip called without init\n"));
+	if (nSekActive == -1) bprintf(PRINT_ERROR, _T("SekSetIdleSkip called when no CPU open\n"));
+#endif
+
+	pSekExt->bIdleSkip = bEnable;
+	SekIdleFlush();
+
+#if defined EMU_M68K && M68K_IDLE_SKIP
+	M68KIdleSkip = bEnable;
+#endif
+
+	return 0;
+}
+
+// Override the idle loop detection for the loop branching back at nAddress
+INT32 SekSetIdleLoop(UINT32 nAddress, INT32 nType)
+{
+#if defined FBA_DEBUG
+	if (!DebugCPU_SekInitted) bprintf(PRINT_ERROR, _T("SekSetIdleLoop called without init\n"));
+	if (nSekActive == -1) bprintf(PRINT_ERROR, _T("SekSetIdleLoop called when no CPU open\n"));
+#endif
+
+	if (pSekExt->nIdleLoops >= SEK_IDLE_LOOPS) {
+		return 1;
+	}
+
+	pSekExt->IdleLoopAddress[pSekExt->nIdleLoops] = nAddress & 0xFFFFFF;
+	pSekExt->IdleLoopType[pSekExt->nIdleLoops] = nType;
+	pSekExt->nIdleLoops++;
+
+	SekIdleFlush();
+
+	return 0;
+}
+
 INT32 SekSetCmpCallback(pSekCmpCallback pCallback)
 {
 #if defined FBA_DEBUG
@@ -2002,7 +2423,7 @@ INT32 SekScan(INT32 nAction)
 #ifdef EMU_A68K
 		if (nSekCPUType[i] == 0) {
 			ba.Data = SekRegs[i];
-			ba.nLen = sizeof(A68KContext);
+			ba.nLen = sizeof(struct A68KContext);
 			ba.szName = szName;
 
 			if (nAction & ACB_READ) {
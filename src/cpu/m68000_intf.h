@@ -31,6 +31,8 @@ extern "C" {
 #define SEK_WADD		(SEK_PAGE_COUNT)		// Value to add for write section = Number of pages
 #define SEK_MASK		(SEK_WADD - 1)
 #define SEK_MAXHANDLER	(10)						// Max. number of handlers for memory access
+#define SEK_IDLE_CACHE	(256)					// Loops remembered as not idle
+#define SEK_IDLE_LOOPS	(16)					// Max. number of idle loop overrides
 
 #if SEK_MAXHANDLER < 1
  #error At least one set of handlers for memory access must be used.
@@ -54,19 +56,19 @@ void __cdecl M68000_RESET(void);
 	UINT32 sfc, dfc, usp, vbr;
 	UINT32 nAsmBank, nCpuVersion;
  };
- struct A68KContext M68000_regs;
+ extern     struct A68KContext M68000_regs;				// Defined in a68k.asm
  extern     struct A68KContext* SekRegs[SEK_MAX];
 
- UINT8* OP_ROM;
- UINT8* OP_RAM;
+ extern UINT8* OP_ROM;
+ extern UINT8* OP_RAM;
 
  void __fastcall AsekChangePc(UINT32 pc);
 #endif
 
 #ifdef EMU_M68K
- INT32 nSekM68KContextSize[SEK_MAX];
- INT8* SekM68KContext[SEK_MAX];
- INT32 m68k_ICount;
+ extern INT32 nSekM68KContextSize[SEK_MAX];
+ extern INT8* SekM68KContext[SEK_MAX];
+ extern INT32 m68k_ICount;
 #endif
 
 typedef UINT8 (__fastcall *pSekReadByteHandler)(UINT32 a);
@@ -101,6 +103,19 @@ struct SekExt {
 	pSekRTECallback RTECallback;
 	pSekIrqCallback IrqCallback;
 	pSekCmpCallback CmpCallback;
+
+	// Decoded opcodes of the ROM pages code was run from (see SekSetCodeCache)
+	INT32 bCodeCache;
+	INT32 nCodePages;
+	struct SekCodePage* CodePage[SEK_PAGE_COUNT];
+	UINT16 CodePageList[SEK_PAGE_COUNT];
+
+	// Idle loop detection (see SekSetIdleSkip)
+	INT32 bIdleSkip;
+	UINT32 IdleBusy[SEK_IDLE_CACHE];
+	INT32 nIdleLoops;
+	UINT32 IdleLoopAddress[SEK_IDLE_LOOPS];
+	INT32 IdleLoopType[SEK_IDLE_LOOPS];
 };
 
 #define SEK_DEF_READ_WORD(i, a) { UINT16 d; d = (UINT16)(pSekExt->ReadByte[i](a) << 8); d |= (UINT16)(pSekExt->ReadByte[i]((a) + 1)); return d; }
@@ -232,6 +247,23 @@ INT32 SekSetRTECallback(pSekRTECallback pCallback);
 INT32 SekSetIrqCallback(pSekIrqCallback pCallback);
 INT32 SekSetCmpCallback(pSekCmpCallback pCallback);
 
+// Cache decoded opcodes for code run from ROM (pages not written directly).
+// Drivers that change ROM data in other ways than SekWrite*ROM must call
+// SekFlushCodeCache afterwards.
+INT32 SekSetCodeCache(INT32 bEnable);
+void SekFlushCodeCache();
+
+// Fast-forward short loops that only wait for something to change memory, up
+// to the end of the timeslice (Musashi only). Only loops of tests, compares
+// and loads reading memory without handlers are skipped, and only whole
+// passes that leave the CPU unchanged, so the results stay the same.
+// SekSetIdleLoop overrides this for the loop branching back at nAddress.
+#define SEK_IDLE_NEVER		(0)				// Never skip the loop
+#define SEK_IDLE_ALWAYS		(1)				// Also skip it if it reads through handlers (e.g. status registers)
+
+INT32 SekSetIdleSkip(INT32 bEnable);
+INT32 SekSetIdleLoop(UINT32 nAddress, INT32 nType);
+
 // Get a CPU's PC
 INT32 SekGetPC(INT32 n);
 
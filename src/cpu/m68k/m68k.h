@@ -299,6 +299,7 @@ int m68k_execute(int num_cycles);
  */
 int m68k_cycles_run(void);              /* Number of cycles run so far */
 int m68k_cycles_remaining(void);        /* Number of cycles left */
+int m68k_cycles_instruction(unsigned int ir); /* Base cycles of an opcode */
 void m68k_modify_timeslice(int cycles); /* Modify cycles left */
 void m68k_end_timeslice(void);          /* End timeslice now */
 
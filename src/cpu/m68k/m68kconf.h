@@ -196,6 +196,75 @@ unsigned int __fastcall M68KFetchByte(unsigned int a);
 unsigned int __fastcall M68KFetchWord(unsigned int a);
 unsigned int __fastcall M68KFetchLong(unsigned int a);
 
+/* The page instructions are currently fetched from. M68KFetchLong fills it in,
+ * SekOpen, SekMapMemory and SekMapHandler clear it again (M68KFetchPage = ~0).
+ */
+#define M68K_FETCH_PAGE_BITS	(10)					/* Must match SEK_BITS */
+#define M68K_FETCH_PAGE_MASK	((1 << M68K_FETCH_PAGE_BITS) - 1)
+
+extern unsigned int M68KFetchPage;
+extern unsigned char* M68KFetchPtr;
+
+/* If ON, m68k_execute keeps the decoded opcodes of code in ROM pages, so
+ * loops run from the cache instead of decoding every instruction again.
+ * M68KCodePage returns the entries for the page holding an address (one per
+ * word), or NULL if the page can't be cached. M68KCodePageAddr is the page
+ * it was last called for, the same calls that clear M68KFetchPage clear it.
+ */
+#define M68K_CODE_CACHE				OPT_ON
+
+/* If ON, code that keeps being run from the opcode cache is translated into
+ * x86-64 code calling the opcode handlers (see m68kjit.c). Build with M68K_JIT
+ * defined to use it.
+ */
+#if defined M68K_JIT && defined __x86_64__ && !defined _WIN32 && !defined FBA_DEBUG
+#define M68K_JIT_X64				OPT_ON
+#else
+#define M68K_JIT_X64				OPT_OFF
+#endif
+
+#define M68K_JIT_THRESHOLD			(32)		/* Runs before an entry is translated */
+
+struct M68KCodeEntry {
+	void (*handler)(void);
+	unsigned short ir;
+	unsigned char cycles;
+#if M68K_JIT_X64
+	unsigned char hits;
+	unsigned int next;							/* PC after the last run */
+	void (*block)(void);						/* Translated code starting here */
+#endif
+};
+
+extern unsigned int M68KCodePageAddr;
+extern struct M68KCodeEntry* M68KCode;
+
+struct M68KCodeEntry* M68KCodePage(unsigned int a);
+
+#if M68K_JIT_X64
+void M68KJitCompile(struct M68KCodeEntry* entry, unsigned int pc);
+void M68KJitExit(void);
+void SekFlushCodeCache();
+#endif
+
+/* If ON, a taken branch back to a loop at most M68K_IDLE_LENGTH bytes long
+ * asks M68KIdleLoop (while M68KIdleSkip is set) how many cycles a pass through
+ * it takes, or 0 if the loop may do more than read memory. When such a pass
+ * left the CPU as it found it, the following passes up to the end of the
+ * timeslice are skipped (see m68ki_idle_loop).
+ */
+#if !defined FBA_DEBUG
+#define M68K_IDLE_SKIP				OPT_ON
+#else
+#define M68K_IDLE_SKIP				OPT_OFF
+#endif
+
+#define M68K_IDLE_LENGTH			(32)
+
+extern unsigned int M68KIdleSkip;
+
+int M68KIdleLoop(unsigned int branch, unsigned int target);
+
 extern unsigned int (*SekDbgFetchByteDisassembler)(unsigned int);
 extern unsigned int (*SekDbgFetchWordDisassembler)(unsigned int);
 extern unsigned int (*SekDbgFetchLongDisassembler)(unsigned int);
@@ -230,8 +299,23 @@ void __fastcall M68KWriteLong(unsigned int a, unsigned int d);
 #define m68k_read_pcrelative_32(address) M68KFetchLong(address)
 
 /* Read data immediately following the PC */
+#ifndef MSB_FIRST
+/* Straight-line code stays in the cached page, so it is read directly */
+INLINE unsigned int M68KFetchLongPage(unsigned int address)
+{
+	if ((address & (0xFFFFFF & ~M68K_FETCH_PAGE_MASK)) == M68KFetchPage) {
+		unsigned int r = *((unsigned int*)(M68KFetchPtr + (address & M68K_FETCH_PAGE_MASK)));
+		return (r >> 16) | (r << 16);
+	}
+	return M68KFetchLong(address);
+}
+
+#define m68k_read_immediate_16(address) M68KFetchWord(address)
+#define m68k_read_immediate_32(address) M68KFetchLongPage(address)
+#else
 #define m68k_read_immediate_16(address) M68KFetchWord(address)
 #define m68k_read_immediate_32(address) M68KFetchLong(address)
+#endif
 
 /* Memory access for the disassembler */
 #define m68k_read_disassembler_8(address) SekDbgFetchByteDisassembler(address)
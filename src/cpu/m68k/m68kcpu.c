@@ -677,6 +677,64 @@ void m68k_set_cpu_type(unsigned int cpu_type)
 	m68ki_build_opcode_table(CPU_TYPE_IS_000(CPU_TYPE));
 }
 
+#if M68K_IDLE_SKIP
+unsigned int M68KIdleSkip = 0;
+
+/* Where the CPU was the last time a loop branch was taken in this timeslice */
+static uint m68ki_idle_branch = ~0U;
+static sint m68ki_idle_cycles;
+static uint m68ki_idle_state[23];
+
+static void m68ki_idle_get_state(uint* state)
+{
+	int i;
+
+	for(i = 0; i < 16; i++)
+		state[i] = REG_DA[i];
+	state[16] = FLAG_X;
+	state[17] = FLAG_N;
+	state[18] = FLAG_Z;
+	state[19] = FLAG_V;
+	state[20] = FLAG_C;
+	state[21] = FLAG_S | FLAG_M;
+	state[22] = FLAG_INT_MASK;
+}
+
+/* Called when a branch back to a short loop is taken, before its cycles are
+ * used. A pass through a loop M68KIdleLoop accepts only reads memory, so if the
+ * last pass (run in this timeslice, without leaving the loop) left the CPU as
+ * it found it, so will every pass after it until something outside the CPU
+ * changes memory, which can't happen before the timeslice ends. Those passes
+ * are skipped, as long as the cycles left don't run out in the middle of one,
+ * so the timeslice ends at the same point and in the same state as it would
+ * have without skipping.
+ */
+void m68ki_idle_loop(void)
+{
+	uint state[23];
+	uint same = 1;
+	sint pass = M68KIdleLoop(REG_PPC, REG_PC);
+	int i;
+
+	if(pass <= 0)
+		return;
+
+	m68ki_idle_get_state(state);
+	for(i = 0; i < 23; i++)
+	{
+		same &= state[i] == m68ki_idle_state[i];
+		m68ki_idle_state[i] = state[i];
+	}
+
+	/* Anything but a single pass through the loop takes longer than this */
+	if(same && m68ki_idle_branch == REG_PPC && m68ki_idle_cycles - GET_CYCLES() == pass && GET_CYCLES() > pass)
+		USE_CYCLES(((GET_CYCLES() - 1) / pass) * pass);
+
+	m68ki_idle_branch = REG_PPC;
+	m68ki_idle_cycles = GET_CYCLES();
+}
+#endif /* M68K_IDLE_SKIP */
+
 /* Execute some instructions until we use up num_cycles clock cycles */
 /* ASG: removed per-instruction interrupt checks */
 int m68k_execute(int num_cycles)
@@ -692,6 +750,11 @@ int m68k_execute(int num_cycles)
 		USE_CYCLES(CPU_INT_CYCLES);
 		CPU_INT_CYCLES = 0;
 
+#if M68K_IDLE_SKIP
+		/* Memory may have changed since the last timeslice */
+		m68ki_idle_branch = ~0U;
+#endif /* M68K_IDLE_SKIP */
+
 		/* Return point if we had an address error */
 		m68ki_set_address_error_trap(); /* auto-disable (see m68kcpu.h) */
 
@@ -710,10 +773,66 @@ int m68k_execute(int num_cycles)
 			/* Record previous program counter */
 			REG_PPC = REG_PC;
 
-			/* Read an instruction and call its handler */
-			REG_IR = m68ki_read_imm_16();
-			m68ki_instruction_jump_table[REG_IR]();
-			USE_CYCLES(CYC_INSTRUCTION[REG_IR]);
+#if M68K_CODE_CACHE
+			/* Use the decoded instruction if this page is cached */
+			if((REG_PC & ~M68K_FETCH_PAGE_MASK) != M68KCodePageAddr)
+				M68KCodePage(REG_PC);
+
+			if(M68KCode && !(REG_PC & 1))
+			{
+				struct M68KCodeEntry* entry = M68KCode + ((REG_PC & M68K_FETCH_PAGE_MASK) >> 1);
+				void (*handler)(void) = entry->handler;
+				uint cycles = entry->cycles;
+
+#if M68K_JIT_X64
+				uint pc = REG_PC;
+
+				/* Translated code runs until it leaves the block or the cycles run out */
+				if(entry->block)
+				{
+					entry->block();
+					continue;
+				}
+#endif /* M68K_JIT_X64 */
+
+				if(handler == NULL)
+				{
+					REG_IR = m68ki_read_imm_16();
+					handler = m68ki_instruction_jump_table[REG_IR];
+					cycles = CYC_INSTRUCTION[REG_IR];
+
+					entry->ir = REG_IR;
+					entry->cycles = cycles;
+					entry->handler = handler;
+				}
+				else
+				{
+					REG_IR = entry->ir;
+					REG_PC += 2;
+				}
+
+				/* The handler may remap the page, so don't use entry after this */
+				handler();
+				USE_CYCLES(cycles);
+
+#if M68K_JIT_X64
+				/* Unless the page is still the same, the entry will be cleared anyway */
+				if((pc & ~M68K_FETCH_PAGE_MASK) == M68KCodePageAddr)
+				{
+					entry->next = REG_PC;
+					if(++entry->hits == M68K_JIT_THRESHOLD)
+						M68KJitCompile(entry, pc);
+				}
+#endif /* M68K_JIT_X64 */
+			}
+			else
+#endif /* M68K_CODE_CACHE */
+			{
+				/* Read an instruction and call its handler */
+				REG_IR = m68ki_read_imm_16();
+				m68ki_instruction_jump_table[REG_IR]();
+				USE_CYCLES(CYC_INSTRUCTION[REG_IR]);
+			}
 
 			/* Trace m68k_exception, if necessary */
 			m68ki_exception_if_trace(); /* auto-disable (see m68kcpu.h) */
@@ -748,6 +867,12 @@ int m68k_cycles_remaining(void)
 	return GET_CYCLES();
 }
 
+/* Base cycles of an instruction on the current CPU type */
+int m68k_cycles_instruction(unsigned int ir)
+{
+	return CYC_INSTRUCTION[ir & 0xffff];
+}
+
 /* Change the timeslice */
 void m68k_modify_timeslice(int cycles)
 {
@@ -486,6 +486,13 @@
 	#define m68ki_pc_changed(A)
 #endif /* M68K_MONITOR_PC */
 
+/* Let the idle loop detection look at branches back into short loops */
+#if M68K_IDLE_SKIP
+	#define m68ki_idle_check() if(M68KIdleSkip && REG_PC < REG_PPC && REG_PPC - REG_PC <= M68K_IDLE_LENGTH) m68ki_idle_loop()
+#else
+	#define m68ki_idle_check()
+#endif /* M68K_IDLE_SKIP */
+
 
 /* Enable or disable function code emulation */
 #if M68K_EMULATE_FC
@@ -966,6 +973,9 @@ INLINE void m68ki_branch_8(uint offset);
 INLINE void m68ki_branch_16(uint offset);
 INLINE void m68ki_branch_32(uint offset);
 
+/* Skip passes through an idle loop (see m68kcpu.c) */
+void m68ki_idle_loop(void);
+
 /* Status register operations. */
 INLINE void m68ki_set_s_flag(uint value);            /* Only bit 2 of value should be set (i.e. 4 or 0) */
 INLINE void m68ki_set_sm_flag(uint value);           /* only bits 1 and 2 of value should be set */
@@ -1380,11 +1390,13 @@ INLINE void m68ki_jump_vector(uint vector)
 INLINE void m68ki_branch_8(uint offset)
 {
 	REG_PC += MAKE_INT_8(offset);
+	m68ki_idle_check(); /* auto-disable (see m68kcpu.h) */
 }
 
 INLINE void m68ki_branch_16(uint offset)
 {
 	REG_PC += MAKE_INT_16(offset);
+	m68ki_idle_check(); /* auto-disable (see m68kcpu.h) */
 }
 
 INLINE void m68ki_branch_32(uint offset)
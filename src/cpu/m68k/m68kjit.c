@@ -0,0 +1,228 @@
+/* ======================================================================== */
+/* ========================== x86-64 TRANSLATION ========================== */
+/* ======================================================================== */
+/*
+ * Runs of instructions from the opcode cache (M68K_CODE_CACHE) are translated
+ * into x86-64 code once their first instruction has been run
+ * M68K_JIT_THRESHOLD times by m68k_execute. The code calls the same opcode
+ * handlers the interpreter does, so the emulation itself is unchanged; what
+ * goes away is the decoding and dispatching around them.
+ *
+ * For every instruction a block sets REG_PPC, REG_IR and REG_PC, calls the
+ * handler and takes its cycles. It only goes on to the next instruction while
+ * cycles remain, the page is still mapped as it was (M68KCodePageAddr is
+ * cleared by every SekMapMemory, SekMapHandler and ROM write) and REG_PC is
+ * where the instruction went the last time it was interpreted. So a block
+ * follows the path the interpreter saw, a branch back into the block becomes
+ * a jump, and anything else (another branch, an exception or interrupt, a
+ * bankswitch, the end of the timeslice) returns to m68k_execute.
+ */
+
+#include "m68kcpu.h"
+
+#if M68K_JIT_X64
+
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#define JIT_CODE_SIZE		(16 << 20)
+#define JIT_BLOCK_MAX		(64)				/* Instructions per block */
+#define JIT_INSTR_SIZE		(80)				/* Most bytes of code per instruction */
+#define JIT_BLOCK_SIZE		(64 + JIT_BLOCK_MAX * JIT_INSTR_SIZE)
+
+static unsigned char* jit_code = NULL;
+static uint jit_used = 0;
+static uint jit_failed = 0;
+
+static unsigned char* jit_ptr;
+
+static void jit_byte(uint b)
+{
+	*jit_ptr++ = (unsigned char)b;
+}
+
+static void jit_u32(uint v)
+{
+	memcpy(jit_ptr, &v, 4);
+	jit_ptr += 4;
+}
+
+static void jit_u64(uintptr_t v)
+{
+	unsigned long long d = v;
+
+	memcpy(jit_ptr, &d, 8);
+	jit_ptr += 8;
+}
+
+/* jmp/jcc rel32, op2 is the second opcode byte for jcc (0 for jmp) */
+static void jit_jump(uint op2, unsigned char* target)
+{
+	if(op2)
+	{
+		jit_byte(0x0F);
+		jit_byte(op2);
+	}
+	else
+		jit_byte(0xE9);
+
+	jit_u32((uint)(target - (jit_ptr + 4)));
+}
+
+#define JIT_JMP		0x00
+#define JIT_JNE		0x85
+#define JIT_JLE		0x8E
+
+/* Registers held over the handler calls:
+ *   rbx = &REG_PC, r12 = &m68k_ICount, r13 = &M68KCodePageAddr,
+ *   r14 = &REG_IR, r15 = &REG_PPC
+ */
+static void jit_prologue(void)
+{
+	jit_byte(0x53);								/* push rbx */
+	jit_byte(0x41); jit_byte(0x54);				/* push r12 */
+	jit_byte(0x41); jit_byte(0x55);				/* push r13 */
+	jit_byte(0x41); jit_byte(0x56);				/* push r14 */
+	jit_byte(0x41); jit_byte(0x57);				/* push r15 */
+
+	jit_byte(0x48); jit_byte(0xBB); jit_u64((uintptr_t)&REG_PC);			/* mov rbx, imm64 */
+	jit_byte(0x49); jit_byte(0xBC); jit_u64((uintptr_t)&m68k_ICount);		/* mov r12, imm64 */
+	jit_byte(0x49); jit_byte(0xBD); jit_u64((uintptr_t)&M68KCodePageAddr);	/* mov r13, imm64 */
+	jit_byte(0x49); jit_byte(0xBE); jit_u64((uintptr_t)&REG_IR);			/* mov r14, imm64 */
+	jit_byte(0x49); jit_byte(0xBF); jit_u64((uintptr_t)&REG_PPC);			/* mov r15, imm64 */
+}
+
+static void jit_epilogue(void)
+{
+	jit_byte(0x41); jit_byte(0x5F);				/* pop r15 */
+	jit_byte(0x41); jit_byte(0x5E);				/* pop r14 */
+	jit_byte(0x41); jit_byte(0x5D);				/* pop r13 */
+	jit_byte(0x41); jit_byte(0x5C);				/* pop r12 */
+	jit_byte(0x5B);								/* pop rbx */
+	jit_byte(0xC3);								/* ret */
+}
+
+/* Run one instruction the way m68k_execute does for a cached entry */
+static void jit_instruction(struct M68KCodeEntry* entry, uint pc, unsigned char* exit)
+{
+	jit_byte(0x41); jit_byte(0xC7); jit_byte(0x07); jit_u32(pc);			/* mov dword [r15], pc */
+	jit_byte(0x41); jit_byte(0xC7); jit_byte(0x06); jit_u32(entry->ir);	/* mov dword [r14], ir */
+	jit_byte(0xC7); jit_byte(0x03); jit_u32(pc + 2);						/* mov dword [rbx], pc + 2 */
+
+	jit_byte(0x48); jit_byte(0xB8); jit_u64((uintptr_t)entry->handler);	/* mov rax, handler */
+	jit_byte(0xFF); jit_byte(0xD0);											/* call rax */
+
+	jit_byte(0x41); jit_byte(0x81); jit_byte(0x2C); jit_byte(0x24); jit_u32(entry->cycles);	/* sub dword [r12], cycles */
+	jit_jump(JIT_JLE, exit);
+}
+
+/* Only carry on if nothing was remapped and the instruction went to next again */
+static void jit_guard(uint page, uint next, unsigned char* exit)
+{
+	jit_byte(0x41); jit_byte(0x81); jit_byte(0x7D); jit_byte(0x00); jit_u32(page);	/* cmp dword [r13], page */
+	jit_jump(JIT_JNE, exit);
+
+	jit_byte(0x81); jit_byte(0x3B); jit_u32(next);							/* cmp dword [rbx], next */
+	jit_jump(JIT_JNE, exit);
+}
+
+/* Translate the run of instructions starting at pc, which is in the page
+ * M68KCode currently points to
+ */
+void M68KJitCompile(struct M68KCodeEntry* entry, unsigned int pc)
+{
+	uint page = pc & ~M68K_FETCH_PAGE_MASK;
+	uint block_pc[JIT_BLOCK_MAX];
+	unsigned char* label[JIT_BLOCK_MAX];
+	unsigned char* exit;
+	unsigned char* start;
+	int count = 0;
+
+	if(jit_failed || entry->handler == NULL)
+		return;
+
+	if(jit_code == NULL)
+	{
+		void* code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(code == MAP_FAILED)
+		{
+			/* Not allowed here, keep interpreting */
+			jit_failed = 1;
+			return;
+		}
+		jit_code = (unsigned char*)code;
+		jit_used = 0;
+	}
+
+	/* When the buffer is full, start again and drop every block pointing into it */
+	if(jit_used + JIT_BLOCK_SIZE > JIT_CODE_SIZE)
+	{
+		jit_used = 0;
+		SekFlushCodeCache();
+		return;
+	}
+
+	jit_ptr = jit_code + jit_used;
+
+	exit = jit_ptr;
+	jit_epilogue();
+
+	start = jit_ptr;
+	jit_prologue();
+
+	for(;;)
+	{
+		struct M68KCodeEntry* e = M68KCode + ((pc & M68K_FETCH_PAGE_MASK) >> 1);
+		uint next = e->next;
+		int i;
+
+		label[count] = jit_ptr;
+		block_pc[count++] = pc;
+
+		jit_instruction(e, pc, exit);
+
+		/* Follow the instruction that came next last time, if it has been run */
+		if(count == JIT_BLOCK_MAX || (next & ~M68K_FETCH_PAGE_MASK) != page || (next & 1))
+			break;
+		if(M68KCode[(next & M68K_FETCH_PAGE_MASK) >> 1].handler == NULL || M68KCode[(next & M68K_FETCH_PAGE_MASK) >> 1].hits == 0)
+			break;
+
+		jit_guard(page, next, exit);
+
+		for(i = 0; i < count; i++)
+			if(block_pc[i] == next)
+				break;
+
+		if(i < count)
+		{
+			/* A loop inside the block */
+			jit_jump(JIT_JMP, label[i]);
+			break;
+		}
+
+		pc = next;
+	}
+
+	jit_jump(JIT_JMP, exit);
+
+	entry->block = (void (*)(void))start;
+
+	jit_used = (uint)(((jit_ptr - jit_code) + 15) & ~15);
+}
+
+void M68KJitExit(void)
+{
+	if(jit_code)
+		munmap(jit_code, JIT_CODE_SIZE);
+
+	jit_code = NULL;
+	jit_used = 0;
+	jit_failed = 0;
+}
+
+#endif /* M68K_JIT_X64 */
+
+/* ======================================================================== */
+/* ============================== END OF FILE ============================= */
+/* ======================================================================== */